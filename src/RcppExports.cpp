@@ -102,8 +102,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // illumina_ref_cpp
-void illumina_ref_cpp(SEXP ref_genome_ptr, const bool& paired, const bool& matepair, const std::string& out_prefix, const int& compress, const std::string& comp_method, const uint64& n_reads, const double& prob_dup, const uint64& n_threads, const bool& show_progress, const uint64& read_pool_size, const double& frag_len_shape, const double& frag_len_scale, const uint64& frag_len_min, const uint64& frag_len_max, const std::vector<std::vector<std::vector<double>>>& qual_probs1, const std::vector<std::vector<std::vector<uint8>>>& quals1, const double& ins_prob1, const double& del_prob1, const std::vector<std::vector<std::vector<double>>>& qual_probs2, const std::vector<std::vector<std::vector<uint8>>>& quals2, const double& ins_prob2, const double& del_prob2, const std::vector<std::string>& barcodes);
-RcppExport SEXP _jackalope_illumina_ref_cpp(SEXP ref_genome_ptrSEXP, SEXP pairedSEXP, SEXP matepairSEXP, SEXP out_prefixSEXP, SEXP compressSEXP, SEXP comp_methodSEXP, SEXP n_readsSEXP, SEXP prob_dupSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP, SEXP read_pool_sizeSEXP, SEXP frag_len_shapeSEXP, SEXP frag_len_scaleSEXP, SEXP frag_len_minSEXP, SEXP frag_len_maxSEXP, SEXP qual_probs1SEXP, SEXP quals1SEXP, SEXP ins_prob1SEXP, SEXP del_prob1SEXP, SEXP qual_probs2SEXP, SEXP quals2SEXP, SEXP ins_prob2SEXP, SEXP del_prob2SEXP, SEXP barcodesSEXP) {
+void illumina_ref_cpp(SEXP ref_genome_ptr, const bool& paired, const bool& matepair, const std::string& out_prefix, const int& compress, const std::string& comp_method, const std::string& rng, const uint64& n_reads, const double& prob_dup, uint64 n_threads, const bool& show_progress, uint64 read_pool_size, const double& max_memory, const double& frag_len_shape, const double& frag_len_scale, const uint64& frag_len_min, const uint64& frag_len_max, const std::vector<std::vector<std::vector<double>>>& qual_probs1, const std::vector<std::vector<std::vector<uint8>>>& quals1, const double& ins_prob1, const double& del_prob1, const std::vector<std::vector<std::vector<double>>>& qual_probs2, const std::vector<std::vector<std::vector<uint8>>>& quals2, const double& ins_prob2, const double& del_prob2, const std::vector<std::string>& barcodes, const bool& bin_quals, const bool& short_names, const bool& name_table);
+RcppExport SEXP _jackalope_illumina_ref_cpp(SEXP ref_genome_ptrSEXP, SEXP pairedSEXP, SEXP matepairSEXP, SEXP out_prefixSEXP, SEXP compressSEXP, SEXP comp_methodSEXP, SEXP rngSEXP, SEXP n_readsSEXP, SEXP prob_dupSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP, SEXP read_pool_sizeSEXP, SEXP max_memorySEXP, SEXP frag_len_shapeSEXP, SEXP frag_len_scaleSEXP, SEXP frag_len_minSEXP, SEXP frag_len_maxSEXP, SEXP qual_probs1SEXP, SEXP quals1SEXP, SEXP ins_prob1SEXP, SEXP del_prob1SEXP, SEXP qual_probs2SEXP, SEXP quals2SEXP, SEXP ins_prob2SEXP, SEXP del_prob2SEXP, SEXP barcodesSEXP, SEXP bin_qualsSEXP, SEXP short_namesSEXP, SEXP name_tableSEXP) {
 BEGIN_RCPP
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< SEXP >::type ref_genome_ptr(ref_genome_ptrSEXP);
@@ -112,11 +112,13 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const std::string& >::type out_prefix(out_prefixSEXP);
     Rcpp::traits::input_parameter< const int& >::type compress(compressSEXP);
     Rcpp::traits::input_parameter< const std::string& >::type comp_method(comp_methodSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type rng(rngSEXP);
     Rcpp::traits::input_parameter< const uint64& >::type n_reads(n_readsSEXP);
     Rcpp::traits::input_parameter< const double& >::type prob_dup(prob_dupSEXP);
-    Rcpp::traits::input_parameter< const uint64& >::type n_threads(n_threadsSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type n_threads(n_threadsSEXP);
     Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
-    Rcpp::traits::input_parameter< const uint64& >::type read_pool_size(read_pool_sizeSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type read_pool_size(read_pool_sizeSEXP);
+    Rcpp::traits::input_parameter< const double& >::type max_memory(max_memorySEXP);
     Rcpp::traits::input_parameter< const double& >::type frag_len_shape(frag_len_shapeSEXP);
     Rcpp::traits::input_parameter< const double& >::type frag_len_scale(frag_len_scaleSEXP);
     Rcpp::traits::input_parameter< const uint64& >::type frag_len_min(frag_len_minSEXP);
@@ -130,13 +132,16 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const double& >::type ins_prob2(ins_prob2SEXP);
     Rcpp::traits::input_parameter< const double& >::type del_prob2(del_prob2SEXP);
     Rcpp::traits::input_parameter< const std::vector<std::string>& >::type barcodes(barcodesSEXP);
-    illumina_ref_cpp(ref_genome_ptr, paired, matepair, out_prefix, compress, comp_method, n_reads, prob_dup, n_threads, show_progress, read_pool_size, frag_len_shape, frag_len_scale, frag_len_min, frag_len_max, qual_probs1, quals1, ins_prob1, del_prob1, qual_probs2, quals2, ins_prob2, del_prob2, barcodes);
+    Rcpp::traits::input_parameter< const bool& >::type bin_quals(bin_qualsSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type short_names(short_namesSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type name_table(name_tableSEXP);
+    illumina_ref_cpp(ref_genome_ptr, paired, matepair, out_prefix, compress, comp_method, rng, n_reads, prob_dup, n_threads, show_progress, read_pool_size, max_memory, frag_len_shape, frag_len_scale, frag_len_min, frag_len_max, qual_probs1, quals1, ins_prob1, del_prob1, qual_probs2, quals2, ins_prob2, del_prob2, barcodes, bin_quals, short_names, name_table);
     return R_NilValue;
 END_RCPP
 }
 // illumina_hap_cpp
-void illumina_hap_cpp(SEXP hap_set_ptr, const bool& paired, const bool& matepair, const std::string& out_prefix, const bool& sep_files, const int& compress, const std::string& comp_method, const uint64& n_reads, const double& prob_dup, const uint64& n_threads, const bool& show_progress, const uint64& read_pool_size, const std::vector<double>& haplotype_probs, const double& frag_len_shape, const double& frag_len_scale, const uint64& frag_len_min, const uint64& frag_len_max, const std::vector<std::vector<std::vector<double>>>& qual_probs1, const std::vector<std::vector<std::vector<uint8>>>& quals1, const double& ins_prob1, const double& del_prob1, const std::vector<std::vector<std::vector<double>>>& qual_probs2, const std::vector<std::vector<std::vector<uint8>>>& quals2, const double& ins_prob2, const double& del_prob2, const std::vector<std::string>& barcodes);
-RcppExport SEXP _jackalope_illumina_hap_cpp(SEXP hap_set_ptrSEXP, SEXP pairedSEXP, SEXP matepairSEXP, SEXP out_prefixSEXP, SEXP sep_filesSEXP, SEXP compressSEXP, SEXP comp_methodSEXP, SEXP n_readsSEXP, SEXP prob_dupSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP, SEXP read_pool_sizeSEXP, SEXP haplotype_probsSEXP, SEXP frag_len_shapeSEXP, SEXP frag_len_scaleSEXP, SEXP frag_len_minSEXP, SEXP frag_len_maxSEXP, SEXP qual_probs1SEXP, SEXP quals1SEXP, SEXP ins_prob1SEXP, SEXP del_prob1SEXP, SEXP qual_probs2SEXP, SEXP quals2SEXP, SEXP ins_prob2SEXP, SEXP del_prob2SEXP, SEXP barcodesSEXP) {
+void illumina_hap_cpp(SEXP hap_set_ptr, const bool& paired, const bool& matepair, const std::string& out_prefix, const bool& sep_files, const int& compress, const std::string& comp_method, const std::string& rng, const uint64& n_reads, const double& prob_dup, uint64 n_threads, const bool& show_progress, uint64 read_pool_size, const double& max_memory, const std::vector<double>& haplotype_probs, const double& frag_len_shape, const double& frag_len_scale, const uint64& frag_len_min, const uint64& frag_len_max, const std::vector<std::vector<std::vector<double>>>& qual_probs1, const std::vector<std::vector<std::vector<uint8>>>& quals1, const double& ins_prob1, const double& del_prob1, const std::vector<std::vector<std::vector<double>>>& qual_probs2, const std::vector<std::vector<std::vector<uint8>>>& quals2, const double& ins_prob2, const double& del_prob2, const std::vector<std::string>& barcodes, const bool& bin_quals, const bool& short_names, const bool& name_table);
+RcppExport SEXP _jackalope_illumina_hap_cpp(SEXP hap_set_ptrSEXP, SEXP pairedSEXP, SEXP matepairSEXP, SEXP out_prefixSEXP, SEXP sep_filesSEXP, SEXP compressSEXP, SEXP comp_methodSEXP, SEXP rngSEXP, SEXP n_readsSEXP, SEXP prob_dupSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP, SEXP read_pool_sizeSEXP, SEXP max_memorySEXP, SEXP haplotype_probsSEXP, SEXP frag_len_shapeSEXP, SEXP frag_len_scaleSEXP, SEXP frag_len_minSEXP, SEXP frag_len_maxSEXP, SEXP qual_probs1SEXP, SEXP quals1SEXP, SEXP ins_prob1SEXP, SEXP del_prob1SEXP, SEXP qual_probs2SEXP, SEXP quals2SEXP, SEXP ins_prob2SEXP, SEXP del_prob2SEXP, SEXP barcodesSEXP, SEXP bin_qualsSEXP, SEXP short_namesSEXP, SEXP name_tableSEXP) {
 BEGIN_RCPP
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< SEXP >::type hap_set_ptr(hap_set_ptrSEXP);
@@ -146,11 +151,13 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const bool& >::type sep_files(sep_filesSEXP);
     Rcpp::traits::input_parameter< const int& >::type compress(compressSEXP);
     Rcpp::traits::input_parameter< const std::string& >::type comp_method(comp_methodSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type rng(rngSEXP);
     Rcpp::traits::input_parameter< const uint64& >::type n_reads(n_readsSEXP);
     Rcpp::traits::input_parameter< const double& >::type prob_dup(prob_dupSEXP);
-    Rcpp::traits::input_parameter< const uint64& >::type n_threads(n_threadsSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type n_threads(n_threadsSEXP);
     Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
-    Rcpp::traits::input_parameter< const uint64& >::type read_pool_size(read_pool_sizeSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type read_pool_size(read_pool_sizeSEXP);
+    Rcpp::traits::input_parameter< const double& >::type max_memory(max_memorySEXP);
     Rcpp::traits::input_parameter< const std::vector<double>& >::type haplotype_probs(haplotype_probsSEXP);
     Rcpp::traits::input_parameter< const double& >::type frag_len_shape(frag_len_shapeSEXP);
     Rcpp::traits::input_parameter< const double& >::type frag_len_scale(frag_len_scaleSEXP);
@@ -165,23 +172,69 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const double& >::type ins_prob2(ins_prob2SEXP);
     Rcpp::traits::input_parameter< const double& >::type del_prob2(del_prob2SEXP);
     Rcpp::traits::input_parameter< const std::vector<std::string>& >::type barcodes(barcodesSEXP);
-    illumina_hap_cpp(hap_set_ptr, paired, matepair, out_prefix, sep_files, compress, comp_method, n_reads, prob_dup, n_threads, show_progress, read_pool_size, haplotype_probs, frag_len_shape, frag_len_scale, frag_len_min, frag_len_max, qual_probs1, quals1, ins_prob1, del_prob1, qual_probs2, quals2, ins_prob2, del_prob2, barcodes);
+    Rcpp::traits::input_parameter< const bool& >::type bin_quals(bin_qualsSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type short_names(short_namesSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type name_table(name_tableSEXP);
+    illumina_hap_cpp(hap_set_ptr, paired, matepair, out_prefix, sep_files, compress, comp_method, rng, n_reads, prob_dup, n_threads, show_progress, read_pool_size, max_memory, haplotype_probs, frag_len_shape, frag_len_scale, frag_len_min, frag_len_max, qual_probs1, quals1, ins_prob1, del_prob1, qual_probs2, quals2, ins_prob2, del_prob2, barcodes, bin_quals, short_names, name_table);
+    return R_NilValue;
+END_RCPP
+}
+// illumina_mux_cpp
+void illumina_mux_cpp(const List& hap_set_ptrs, const std::vector<std::string>& sample_names, const bool& paired, const bool& matepair, const std::string& out_prefix, const bool& sep_files, const int& compress, const std::string& comp_method, const std::string& rng, const uint64& n_reads, const double& prob_dup, uint64 n_threads, const bool& show_progress, uint64 read_pool_size, const double& max_memory, const std::vector<double>& haplotype_probs, const double& frag_len_shape, const double& frag_len_scale, const uint64& frag_len_min, const uint64& frag_len_max, const std::vector<std::vector<std::vector<double>>>& qual_probs1, const std::vector<std::vector<std::vector<uint8>>>& quals1, const double& ins_prob1, const double& del_prob1, const std::vector<std::vector<std::vector<double>>>& qual_probs2, const std::vector<std::vector<std::vector<uint8>>>& quals2, const double& ins_prob2, const double& del_prob2, const std::vector<std::string>& barcodes, const bool& bin_quals, const bool& short_names, const bool& name_table);
+RcppExport SEXP _jackalope_illumina_mux_cpp(SEXP hap_set_ptrsSEXP, SEXP sample_namesSEXP, SEXP pairedSEXP, SEXP matepairSEXP, SEXP out_prefixSEXP, SEXP sep_filesSEXP, SEXP compressSEXP, SEXP comp_methodSEXP, SEXP rngSEXP, SEXP n_readsSEXP, SEXP prob_dupSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP, SEXP read_pool_sizeSEXP, SEXP max_memorySEXP, SEXP haplotype_probsSEXP, SEXP frag_len_shapeSEXP, SEXP frag_len_scaleSEXP, SEXP frag_len_minSEXP, SEXP frag_len_maxSEXP, SEXP qual_probs1SEXP, SEXP quals1SEXP, SEXP ins_prob1SEXP, SEXP del_prob1SEXP, SEXP qual_probs2SEXP, SEXP quals2SEXP, SEXP ins_prob2SEXP, SEXP del_prob2SEXP, SEXP barcodesSEXP, SEXP bin_qualsSEXP, SEXP short_namesSEXP, SEXP name_tableSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const List& >::type hap_set_ptrs(hap_set_ptrsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::string>& >::type sample_names(sample_namesSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type paired(pairedSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type matepair(matepairSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type out_prefix(out_prefixSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type sep_files(sep_filesSEXP);
+    Rcpp::traits::input_parameter< const int& >::type compress(compressSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type comp_method(comp_methodSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type rng(rngSEXP);
+    Rcpp::traits::input_parameter< const uint64& >::type n_reads(n_readsSEXP);
+    Rcpp::traits::input_parameter< const double& >::type prob_dup(prob_dupSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type n_threads(n_threadsSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type read_pool_size(read_pool_sizeSEXP);
+    Rcpp::traits::input_parameter< const double& >::type max_memory(max_memorySEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type haplotype_probs(haplotype_probsSEXP);
+    Rcpp::traits::input_parameter< const double& >::type frag_len_shape(frag_len_shapeSEXP);
+    Rcpp::traits::input_parameter< const double& >::type frag_len_scale(frag_len_scaleSEXP);
+    Rcpp::traits::input_parameter< const uint64& >::type frag_len_min(frag_len_minSEXP);
+    Rcpp::traits::input_parameter< const uint64& >::type frag_len_max(frag_len_maxSEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::vector<std::vector<double>>>& >::type qual_probs1(qual_probs1SEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::vector<std::vector<uint8>>>& >::type quals1(quals1SEXP);
+    Rcpp::traits::input_parameter< const double& >::type ins_prob1(ins_prob1SEXP);
+    Rcpp::traits::input_parameter< const double& >::type del_prob1(del_prob1SEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::vector<std::vector<double>>>& >::type qual_probs2(qual_probs2SEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::vector<std::vector<uint8>>>& >::type quals2(quals2SEXP);
+    Rcpp::traits::input_parameter< const double& >::type ins_prob2(ins_prob2SEXP);
+    Rcpp::traits::input_parameter< const double& >::type del_prob2(del_prob2SEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::string>& >::type barcodes(barcodesSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type bin_quals(bin_qualsSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type short_names(short_namesSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type name_table(name_tableSEXP);
+    illumina_mux_cpp(hap_set_ptrs, sample_names, paired, matepair, out_prefix, sep_files, compress, comp_method, rng, n_reads, prob_dup, n_threads, show_progress, read_pool_size, max_memory, haplotype_probs, frag_len_shape, frag_len_scale, frag_len_min, frag_len_max, qual_probs1, quals1, ins_prob1, del_prob1, qual_probs2, quals2, ins_prob2, del_prob2, barcodes, bin_quals, short_names, name_table);
     return R_NilValue;
 END_RCPP
 }
 // pacbio_ref_cpp
-void pacbio_ref_cpp(SEXP ref_genome_ptr, const std::string& out_prefix, const int& compress, const std::string& comp_method, const uint64& n_reads, const uint64& n_threads, const bool& show_progress, const uint64& read_pool_size, const double& prob_dup, const double& scale, const double& sigma, const double& loc, const double& min_read_len, const std::vector<double>& read_probs, const std::vector<uint64>& read_lens, const uint64& max_passes, const std::vector<double>& chi2_params_n, const std::vector<double>& chi2_params_s, const std::vector<double>& sqrt_params, const std::vector<double>& norm_params, const double& prob_thresh, const double& prob_ins, const double& prob_del, const double& prob_subst);
-RcppExport SEXP _jackalope_pacbio_ref_cpp(SEXP ref_genome_ptrSEXP, SEXP out_prefixSEXP, SEXP compressSEXP, SEXP comp_methodSEXP, SEXP n_readsSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP, SEXP read_pool_sizeSEXP, SEXP prob_dupSEXP, SEXP scaleSEXP, SEXP sigmaSEXP, SEXP locSEXP, SEXP min_read_lenSEXP, SEXP read_probsSEXP, SEXP read_lensSEXP, SEXP max_passesSEXP, SEXP chi2_params_nSEXP, SEXP chi2_params_sSEXP, SEXP sqrt_paramsSEXP, SEXP norm_paramsSEXP, SEXP prob_threshSEXP, SEXP prob_insSEXP, SEXP prob_delSEXP, SEXP prob_substSEXP) {
+void pacbio_ref_cpp(SEXP ref_genome_ptr, const std::string& out_prefix, const int& compress, const std::string& comp_method, const std::string& rng, const uint64& n_reads, uint64 n_threads, const bool& show_progress, uint64 read_pool_size, const double& max_memory, const double& prob_dup, const double& scale, const double& sigma, const double& loc, const double& min_read_len, const std::vector<double>& read_probs, const std::vector<uint64>& read_lens, const uint64& max_passes, const std::vector<double>& chi2_params_n, const std::vector<double>& chi2_params_s, const std::vector<double>& sqrt_params, const std::vector<double>& norm_params, const double& prob_thresh, const double& prob_ins, const double& prob_del, const double& prob_subst);
+RcppExport SEXP _jackalope_pacbio_ref_cpp(SEXP ref_genome_ptrSEXP, SEXP out_prefixSEXP, SEXP compressSEXP, SEXP comp_methodSEXP, SEXP rngSEXP, SEXP n_readsSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP, SEXP read_pool_sizeSEXP, SEXP max_memorySEXP, SEXP prob_dupSEXP, SEXP scaleSEXP, SEXP sigmaSEXP, SEXP locSEXP, SEXP min_read_lenSEXP, SEXP read_probsSEXP, SEXP read_lensSEXP, SEXP max_passesSEXP, SEXP chi2_params_nSEXP, SEXP chi2_params_sSEXP, SEXP sqrt_paramsSEXP, SEXP norm_paramsSEXP, SEXP prob_threshSEXP, SEXP prob_insSEXP, SEXP prob_delSEXP, SEXP prob_substSEXP) {
 BEGIN_RCPP
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< SEXP >::type ref_genome_ptr(ref_genome_ptrSEXP);
     Rcpp::traits::input_parameter< const std::string& >::type out_prefix(out_prefixSEXP);
     Rcpp::traits::input_parameter< const int& >::type compress(compressSEXP);
     Rcpp::traits::input_parameter< const std::string& >::type comp_method(comp_methodSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type rng(rngSEXP);
     Rcpp::traits::input_parameter< const uint64& >::type n_reads(n_readsSEXP);
-    Rcpp::traits::input_parameter< const uint64& >::type n_threads(n_threadsSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type n_threads(n_threadsSEXP);
     Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
-    Rcpp::traits::input_parameter< const uint64& >::type read_pool_size(read_pool_sizeSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type read_pool_size(read_pool_sizeSEXP);
+    Rcpp::traits::input_parameter< const double& >::type max_memory(max_memorySEXP);
     Rcpp::traits::input_parameter< const double& >::type prob_dup(prob_dupSEXP);
     Rcpp::traits::input_parameter< const double& >::type scale(scaleSEXP);
     Rcpp::traits::input_parameter< const double& >::type sigma(sigmaSEXP);
@@ -198,13 +251,13 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const double& >::type prob_ins(prob_insSEXP);
     Rcpp::traits::input_parameter< const double& >::type prob_del(prob_delSEXP);
     Rcpp::traits::input_parameter< const double& >::type prob_subst(prob_substSEXP);
-    pacbio_ref_cpp(ref_genome_ptr, out_prefix, compress, comp_method, n_reads, n_threads, show_progress, read_pool_size, prob_dup, scale, sigma, loc, min_read_len, read_probs, read_lens, max_passes, chi2_params_n, chi2_params_s, sqrt_params, norm_params, prob_thresh, prob_ins, prob_del, prob_subst);
+    pacbio_ref_cpp(ref_genome_ptr, out_prefix, compress, comp_method, rng, n_reads, n_threads, show_progress, read_pool_size, max_memory, prob_dup, scale, sigma, loc, min_read_len, read_probs, read_lens, max_passes, chi2_params_n, chi2_params_s, sqrt_params, norm_params, prob_thresh, prob_ins, prob_del, prob_subst);
     return R_NilValue;
 END_RCPP
 }
 // pacbio_hap_cpp
-void pacbio_hap_cpp(SEXP hap_set_ptr, const std::string& out_prefix, const bool& sep_files, const int& compress, const std::string& comp_method, const uint64& n_reads, const uint64& n_threads, const bool& show_progress, const uint64& read_pool_size, const std::vector<double>& haplotype_probs, const double& prob_dup, const double& scale, const double& sigma, const double& loc, const double& min_read_len, const std::vector<double>& read_probs, const std::vector<uint64>& read_lens, const uint64& max_passes, const std::vector<double>& chi2_params_n, const std::vector<double>& chi2_params_s, const std::vector<double>& sqrt_params, const std::vector<double>& norm_params, const double& prob_thresh, const double& prob_ins, const double& prob_del, const double& prob_subst);
-RcppExport SEXP _jackalope_pacbio_hap_cpp(SEXP hap_set_ptrSEXP, SEXP out_prefixSEXP, SEXP sep_filesSEXP, SEXP compressSEXP, SEXP comp_methodSEXP, SEXP n_readsSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP, SEXP read_pool_sizeSEXP, SEXP haplotype_probsSEXP, SEXP prob_dupSEXP, SEXP scaleSEXP, SEXP sigmaSEXP, SEXP locSEXP, SEXP min_read_lenSEXP, SEXP read_probsSEXP, SEXP read_lensSEXP, SEXP max_passesSEXP, SEXP chi2_params_nSEXP, SEXP chi2_params_sSEXP, SEXP sqrt_paramsSEXP, SEXP norm_paramsSEXP, SEXP prob_threshSEXP, SEXP prob_insSEXP, SEXP prob_delSEXP, SEXP prob_substSEXP) {
+void pacbio_hap_cpp(SEXP hap_set_ptr, const std::string& out_prefix, const bool& sep_files, const int& compress, const std::string& comp_method, const std::string& rng, const uint64& n_reads, uint64 n_threads, const bool& show_progress, uint64 read_pool_size, const double& max_memory, const std::vector<double>& haplotype_probs, const double& prob_dup, const double& scale, const double& sigma, const double& loc, const double& min_read_len, const std::vector<double>& read_probs, const std::vector<uint64>& read_lens, const uint64& max_passes, const std::vector<double>& chi2_params_n, const std::vector<double>& chi2_params_s, const std::vector<double>& sqrt_params, const std::vector<double>& norm_params, const double& prob_thresh, const double& prob_ins, const double& prob_del, const double& prob_subst);
+RcppExport SEXP _jackalope_pacbio_hap_cpp(SEXP hap_set_ptrSEXP, SEXP out_prefixSEXP, SEXP sep_filesSEXP, SEXP compressSEXP, SEXP comp_methodSEXP, SEXP rngSEXP, SEXP n_readsSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP, SEXP read_pool_sizeSEXP, SEXP max_memorySEXP, SEXP haplotype_probsSEXP, SEXP prob_dupSEXP, SEXP scaleSEXP, SEXP sigmaSEXP, SEXP locSEXP, SEXP min_read_lenSEXP, SEXP read_probsSEXP, SEXP read_lensSEXP, SEXP max_passesSEXP, SEXP chi2_params_nSEXP, SEXP chi2_params_sSEXP, SEXP sqrt_paramsSEXP, SEXP norm_paramsSEXP, SEXP prob_threshSEXP, SEXP prob_insSEXP, SEXP prob_delSEXP, SEXP prob_substSEXP) {
 BEGIN_RCPP
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< SEXP >::type hap_set_ptr(hap_set_ptrSEXP);
@@ -212,10 +265,12 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const bool& >::type sep_files(sep_filesSEXP);
     Rcpp::traits::input_parameter< const int& >::type compress(compressSEXP);
     Rcpp::traits::input_parameter< const std::string& >::type comp_method(comp_methodSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type rng(rngSEXP);
     Rcpp::traits::input_parameter< const uint64& >::type n_reads(n_readsSEXP);
-    Rcpp::traits::input_parameter< const uint64& >::type n_threads(n_threadsSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type n_threads(n_threadsSEXP);
     Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
-    Rcpp::traits::input_parameter< const uint64& >::type read_pool_size(read_pool_sizeSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type read_pool_size(read_pool_sizeSEXP);
+    Rcpp::traits::input_parameter< const double& >::type max_memory(max_memorySEXP);
     Rcpp::traits::input_parameter< const std::vector<double>& >::type haplotype_probs(haplotype_probsSEXP);
     Rcpp::traits::input_parameter< const double& >::type prob_dup(prob_dupSEXP);
     Rcpp::traits::input_parameter< const double& >::type scale(scaleSEXP);
@@ -233,7 +288,7 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const double& >::type prob_ins(prob_insSEXP);
     Rcpp::traits::input_parameter< const double& >::type prob_del(prob_delSEXP);
     Rcpp::traits::input_parameter< const double& >::type prob_subst(prob_substSEXP);
-    pacbio_hap_cpp(hap_set_ptr, out_prefix, sep_files, compress, comp_method, n_reads, n_threads, show_progress, read_pool_size, haplotype_probs, prob_dup, scale, sigma, loc, min_read_len, read_probs, read_lens, max_passes, chi2_params_n, chi2_params_s, sqrt_params, norm_params, prob_thresh, prob_ins, prob_del, prob_subst);
+    pacbio_hap_cpp(hap_set_ptr, out_prefix, sep_files, compress, comp_method, rng, n_reads, n_threads, show_progress, read_pool_size, max_memory, haplotype_probs, prob_dup, scale, sigma, loc, min_read_len, read_probs, read_lens, max_passes, chi2_params_n, chi2_params_s, sqrt_params, norm_params, prob_thresh, prob_ins, prob_del, prob_subst);
     return R_NilValue;
 END_RCPP
 }
@@ -263,6 +318,24 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// read_fasta_haps
+SEXP read_fasta_haps(SEXP reference_ptr, const std::vector<std::string>& fasta_files, const std::vector<std::string>& hap_names, const bool& cut_names, const bool& remove_soft_mask, const bool& print_names, uint64 n_threads, const bool& show_progress);
+RcppExport SEXP _jackalope_read_fasta_haps(SEXP reference_ptrSEXP, SEXP fasta_filesSEXP, SEXP hap_namesSEXP, SEXP cut_namesSEXP, SEXP remove_soft_maskSEXP, SEXP print_namesSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type reference_ptr(reference_ptrSEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::string>& >::type fasta_files(fasta_filesSEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::string>& >::type hap_names(hap_namesSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type cut_names(cut_namesSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type remove_soft_mask(remove_soft_maskSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type print_names(print_namesSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type n_threads(n_threadsSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
+    rcpp_result_gen = Rcpp::wrap(read_fasta_haps(reference_ptr, fasta_files, hap_names, cut_names, remove_soft_mask, print_names, n_threads, show_progress));
+    return rcpp_result_gen;
+END_RCPP
+}
 // write_ref_fasta
 void write_ref_fasta(const std::string& out_prefix, SEXP ref_genome_ptr, const uint64& text_width, const int& compress, const std::string& comp_method, const bool& show_progress);
 RcppExport SEXP _jackalope_write_ref_fasta(SEXP out_prefixSEXP, SEXP ref_genome_ptrSEXP, SEXP text_widthSEXP, SEXP compressSEXP, SEXP comp_methodSEXP, SEXP show_progressSEXP) {
@@ -344,8 +417,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // evolve_across_trees
-SEXP evolve_across_trees(SEXP& ref_genome_ptr, const List& genome_phylo_info, const std::vector<arma::mat>& Q, const std::vector<arma::mat>& U, const std::vector<arma::mat>& Ui, const std::vector<arma::vec>& L, const double& invariant, const arma::vec& insertion_rates, const arma::vec& deletion_rates, const double& epsilon, const std::vector<double>& pi_tcag, uint64 n_threads, const bool& show_progress);
-RcppExport SEXP _jackalope_evolve_across_trees(SEXP ref_genome_ptrSEXP, SEXP genome_phylo_infoSEXP, SEXP QSEXP, SEXP USEXP, SEXP UiSEXP, SEXP LSEXP, SEXP invariantSEXP, SEXP insertion_ratesSEXP, SEXP deletion_ratesSEXP, SEXP epsilonSEXP, SEXP pi_tcagSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP) {
+SEXP evolve_across_trees(SEXP& ref_genome_ptr, const List& genome_phylo_info, const std::vector<arma::mat>& Q, const std::vector<arma::mat>& U, const std::vector<arma::mat>& Ui, const std::vector<arma::vec>& L, const double& invariant, const arma::vec& insertion_rates, const arma::vec& deletion_rates, const double& epsilon, const std::vector<double>& pi_tcag, const bool& stateless_rates, const List& rate_maps, uint64 n_threads, const bool& show_progress);
+RcppExport SEXP _jackalope_evolve_across_trees(SEXP ref_genome_ptrSEXP, SEXP genome_phylo_infoSEXP, SEXP QSEXP, SEXP USEXP, SEXP UiSEXP, SEXP LSEXP, SEXP invariantSEXP, SEXP insertion_ratesSEXP, SEXP deletion_ratesSEXP, SEXP epsilonSEXP, SEXP pi_tcagSEXP, SEXP stateless_ratesSEXP, SEXP rate_mapsSEXP, SEXP n_threadsSEXP, SEXP show_progressSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -360,9 +433,11 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const arma::vec& >::type deletion_rates(deletion_ratesSEXP);
     Rcpp::traits::input_parameter< const double& >::type epsilon(epsilonSEXP);
     Rcpp::traits::input_parameter< const std::vector<double>& >::type pi_tcag(pi_tcagSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type stateless_rates(stateless_ratesSEXP);
+    Rcpp::traits::input_parameter< const List& >::type rate_maps(rate_mapsSEXP);
     Rcpp::traits::input_parameter< uint64 >::type n_threads(n_threadsSEXP);
     Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
-    rcpp_result_gen = Rcpp::wrap(evolve_across_trees(ref_genome_ptr, genome_phylo_info, Q, U, Ui, L, invariant, insertion_rates, deletion_rates, epsilon, pi_tcag, n_threads, show_progress));
+    rcpp_result_gen = Rcpp::wrap(evolve_across_trees(ref_genome_ptr, genome_phylo_info, Q, U, Ui, L, invariant, insertion_rates, deletion_rates, epsilon, pi_tcag, stateless_rates, rate_maps, n_threads, show_progress));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -466,7 +541,7 @@ BEGIN_RCPP
 END_RCPP
 }
 // view_ref_genome_chrom
-std::string view_ref_genome_chrom(SEXP ref_genome_ptr, const uint64& chrom_ind);
+SEXP view_ref_genome_chrom(SEXP ref_genome_ptr, const uint64& chrom_ind);
 RcppExport SEXP _jackalope_view_ref_genome_chrom(SEXP ref_genome_ptrSEXP, SEXP chrom_indSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
@@ -478,7 +553,7 @@ BEGIN_RCPP
 END_RCPP
 }
 // view_hap_genome_chrom
-std::string view_hap_genome_chrom(SEXP hap_set_ptr, const uint64& hap_ind, const uint64& chrom_ind);
+SEXP view_hap_genome_chrom(SEXP hap_set_ptr, const uint64& hap_ind, const uint64& chrom_ind);
 RcppExport SEXP _jackalope_view_hap_genome_chrom(SEXP hap_set_ptrSEXP, SEXP hap_indSEXP, SEXP chrom_indSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
@@ -491,7 +566,7 @@ BEGIN_RCPP
 END_RCPP
 }
 // view_ref_genome
-std::vector<std::string> view_ref_genome(SEXP ref_genome_ptr);
+SEXP view_ref_genome(SEXP ref_genome_ptr);
 RcppExport SEXP _jackalope_view_ref_genome(SEXP ref_genome_ptrSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
@@ -502,7 +577,7 @@ BEGIN_RCPP
 END_RCPP
 }
 // view_hap_genome
-std::vector<std::string> view_hap_genome(SEXP hap_set_ptr, const uint64& hap_ind);
+SEXP view_hap_genome(SEXP hap_set_ptr, const uint64& hap_ind);
 RcppExport SEXP _jackalope_view_hap_genome(SEXP hap_set_ptrSEXP, SEXP hap_indSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
@@ -595,6 +670,59 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// view_ref_genome_memory
+NumericVector view_ref_genome_memory(SEXP ref_genome_ptr);
+RcppExport SEXP _jackalope_view_ref_genome_memory(SEXP ref_genome_ptrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type ref_genome_ptr(ref_genome_ptrSEXP);
+    rcpp_result_gen = Rcpp::wrap(view_ref_genome_memory(ref_genome_ptr));
+    return rcpp_result_gen;
+END_RCPP
+}
+// view_hap_set_memory
+NumericVector view_hap_set_memory(SEXP hap_set_ptr);
+RcppExport SEXP _jackalope_view_hap_set_memory(SEXP hap_set_ptrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type hap_set_ptr(hap_set_ptrSEXP);
+    rcpp_result_gen = Rcpp::wrap(view_hap_set_memory(hap_set_ptr));
+    return rcpp_result_gen;
+END_RCPP
+}
+// estimate_hap_set_memory
+NumericVector estimate_hap_set_memory(SEXP ref_genome_ptr, const uint64& n_haps, const double& n_muts, const double& mut_nts);
+RcppExport SEXP _jackalope_estimate_hap_set_memory(SEXP ref_genome_ptrSEXP, SEXP n_hapsSEXP, SEXP n_mutsSEXP, SEXP mut_ntsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type ref_genome_ptr(ref_genome_ptrSEXP);
+    Rcpp::traits::input_parameter< const uint64& >::type n_haps(n_hapsSEXP);
+    Rcpp::traits::input_parameter< const double& >::type n_muts(n_mutsSEXP);
+    Rcpp::traits::input_parameter< const double& >::type mut_nts(mut_ntsSEXP);
+    rcpp_result_gen = Rcpp::wrap(estimate_hap_set_memory(ref_genome_ptr, n_haps, n_muts, mut_nts));
+    return rcpp_result_gen;
+END_RCPP
+}
+// estimate_read_sim_memory
+double estimate_read_sim_memory(SEXP ref_genome_ptr, const uint64& n_haps, const uint64& read_length, const uint64& n_read_ends, const uint64& n_quals, const uint64& read_pool_size, uint64 n_threads);
+RcppExport SEXP _jackalope_estimate_read_sim_memory(SEXP ref_genome_ptrSEXP, SEXP n_hapsSEXP, SEXP read_lengthSEXP, SEXP n_read_endsSEXP, SEXP n_qualsSEXP, SEXP read_pool_sizeSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type ref_genome_ptr(ref_genome_ptrSEXP);
+    Rcpp::traits::input_parameter< const uint64& >::type n_haps(n_hapsSEXP);
+    Rcpp::traits::input_parameter< const uint64& >::type read_length(read_lengthSEXP);
+    Rcpp::traits::input_parameter< const uint64& >::type n_read_ends(n_read_endsSEXP);
+    Rcpp::traits::input_parameter< const uint64& >::type n_quals(n_qualsSEXP);
+    Rcpp::traits::input_parameter< const uint64& >::type read_pool_size(read_pool_sizeSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(estimate_read_sim_memory(ref_genome_ptr, n_haps, read_length, n_read_ends, n_quals, read_pool_size, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // set_ref_genome_chrom_names
 void set_ref_genome_chrom_names(SEXP ref_genome_ptr, const std::vector<uint64>& chrom_inds, const std::vector<std::string>& names);
 RcppExport SEXP _jackalope_set_ref_genome_chrom_names(SEXP ref_genome_ptrSEXP, SEXP chrom_indsSEXP, SEXP namesSEXP) {
@@ -753,6 +881,23 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
+// add_many_mutations
+void add_many_mutations(SEXP hap_set_ptr, const std::vector<uint64>& hap_inds, const std::vector<uint64>& chrom_inds, const std::vector<uint64>& new_pos, const std::vector<uint64>& types, const std::vector<std::string>& nucleos, const std::vector<uint64>& sizes, uint64 n_threads);
+RcppExport SEXP _jackalope_add_many_mutations(SEXP hap_set_ptrSEXP, SEXP hap_indsSEXP, SEXP chrom_indsSEXP, SEXP new_posSEXP, SEXP typesSEXP, SEXP nucleosSEXP, SEXP sizesSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type hap_set_ptr(hap_set_ptrSEXP);
+    Rcpp::traits::input_parameter< const std::vector<uint64>& >::type hap_inds(hap_indsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<uint64>& >::type chrom_inds(chrom_indsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<uint64>& >::type new_pos(new_posSEXP);
+    Rcpp::traits::input_parameter< const std::vector<uint64>& >::type types(typesSEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::string>& >::type nucleos(nucleosSEXP);
+    Rcpp::traits::input_parameter< const std::vector<uint64>& >::type sizes(sizesSEXP);
+    Rcpp::traits::input_parameter< uint64 >::type n_threads(n_threadsSEXP);
+    add_many_mutations(hap_set_ptr, hap_inds, chrom_inds, new_pos, types, nucleos, sizes, n_threads);
+    return R_NilValue;
+END_RCPP
+}
 // sub_TN93_cpp
 List sub_TN93_cpp(const double& mu, std::vector<double> pi_tcag, const double& alpha_1, const double& alpha_2, const double& beta, const double& gamma_shape, const uint32& gamma_k, const double& invariant);
 RcppExport SEXP _jackalope_sub_TN93_cpp(SEXP muSEXP, SEXP pi_tcagSEXP, SEXP alpha_1SEXP, SEXP alpha_2SEXP, SEXP betaSEXP, SEXP gamma_shapeSEXP, SEXP gamma_kSEXP, SEXP invariantSEXP) {
@@ -812,6 +957,38 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// max_threads
+int max_threads();
+RcppExport SEXP _jackalope_max_threads() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(max_threads());
+    return rcpp_result_gen;
+END_RCPP
+}
+// comp_methods
+CharacterVector comp_methods();
+RcppExport SEXP _jackalope_comp_methods() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(comp_methods());
+    return rcpp_result_gen;
+END_RCPP
+}
+// rng_unifs
+std::vector<double> rng_unifs(const uint64& n, const std::string& rng);
+RcppExport SEXP _jackalope_rng_unifs(SEXP nSEXP, SEXP rngSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uint64& >::type n(nSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type rng(rngSEXP);
+    rcpp_result_gen = Rcpp::wrap(rng_unifs(n, rng));
+    return rcpp_result_gen;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
     {"_jackalope_merge_all_chromosomes_cpp", (DL_FUNC) &_jackalope_merge_all_chromosomes_cpp, 1},
@@ -821,19 +998,21 @@ static const R_CallMethodDef CallEntries[] = {
     {"_jackalope_create_genome_cpp", (DL_FUNC) &_jackalope_create_genome_cpp, 5},
     {"_jackalope_rando_chroms", (DL_FUNC) &_jackalope_rando_chroms, 5},
     {"_jackalope_add_ssites_cpp", (DL_FUNC) &_jackalope_add_ssites_cpp, 8},
-    {"_jackalope_illumina_ref_cpp", (DL_FUNC) &_jackalope_illumina_ref_cpp, 24},
-    {"_jackalope_illumina_hap_cpp", (DL_FUNC) &_jackalope_illumina_hap_cpp, 26},
-    {"_jackalope_pacbio_ref_cpp", (DL_FUNC) &_jackalope_pacbio_ref_cpp, 24},
-    {"_jackalope_pacbio_hap_cpp", (DL_FUNC) &_jackalope_pacbio_hap_cpp, 26},
+    {"_jackalope_illumina_ref_cpp", (DL_FUNC) &_jackalope_illumina_ref_cpp, 29},
+    {"_jackalope_illumina_hap_cpp", (DL_FUNC) &_jackalope_illumina_hap_cpp, 31},
+    {"_jackalope_illumina_mux_cpp", (DL_FUNC) &_jackalope_illumina_mux_cpp, 32},
+    {"_jackalope_pacbio_ref_cpp", (DL_FUNC) &_jackalope_pacbio_ref_cpp, 26},
+    {"_jackalope_pacbio_hap_cpp", (DL_FUNC) &_jackalope_pacbio_hap_cpp, 28},
     {"_jackalope_read_fasta_noind", (DL_FUNC) &_jackalope_read_fasta_noind, 3},
     {"_jackalope_read_fasta_ind", (DL_FUNC) &_jackalope_read_fasta_ind, 3},
+    {"_jackalope_read_fasta_haps", (DL_FUNC) &_jackalope_read_fasta_haps, 8},
     {"_jackalope_write_ref_fasta", (DL_FUNC) &_jackalope_write_ref_fasta, 6},
     {"_jackalope_write_haps_fasta", (DL_FUNC) &_jackalope_write_haps_fasta, 7},
     {"_jackalope_read_ms_trees_", (DL_FUNC) &_jackalope_read_ms_trees_, 1},
     {"_jackalope_coal_file_sites", (DL_FUNC) &_jackalope_coal_file_sites, 1},
     {"_jackalope_read_vcf_cpp", (DL_FUNC) &_jackalope_read_vcf_cpp, 3},
     {"_jackalope_write_vcf_cpp", (DL_FUNC) &_jackalope_write_vcf_cpp, 5},
-    {"_jackalope_evolve_across_trees", (DL_FUNC) &_jackalope_evolve_across_trees, 13},
+    {"_jackalope_evolve_across_trees", (DL_FUNC) &_jackalope_evolve_across_trees, 15},
     {"_jackalope_print_ref_genome", (DL_FUNC) &_jackalope_print_ref_genome, 1},
     {"_jackalope_print_hap_set", (DL_FUNC) &_jackalope_print_hap_set, 1},
     {"_jackalope_make_ref_genome", (DL_FUNC) &_jackalope_make_ref_genome, 1},
@@ -853,6 +1032,10 @@ static const R_CallMethodDef CallEntries[] = {
     {"_jackalope_view_hap_set_gc_content", (DL_FUNC) &_jackalope_view_hap_set_gc_content, 5},
     {"_jackalope_view_ref_genome_nt_content", (DL_FUNC) &_jackalope_view_ref_genome_nt_content, 5},
     {"_jackalope_view_hap_set_nt_content", (DL_FUNC) &_jackalope_view_hap_set_nt_content, 6},
+    {"_jackalope_view_ref_genome_memory", (DL_FUNC) &_jackalope_view_ref_genome_memory, 1},
+    {"_jackalope_view_hap_set_memory", (DL_FUNC) &_jackalope_view_hap_set_memory, 1},
+    {"_jackalope_estimate_hap_set_memory", (DL_FUNC) &_jackalope_estimate_hap_set_memory, 4},
+    {"_jackalope_estimate_read_sim_memory", (DL_FUNC) &_jackalope_estimate_read_sim_memory, 7},
     {"_jackalope_set_ref_genome_chrom_names", (DL_FUNC) &_jackalope_set_ref_genome_chrom_names, 3},
     {"_jackalope_clean_ref_genome_chrom_names", (DL_FUNC) &_jackalope_clean_ref_genome_chrom_names, 1},
     {"_jackalope_set_hap_set_hap_names", (DL_FUNC) &_jackalope_set_hap_set_hap_names, 3},
@@ -866,14 +1049,20 @@ static const R_CallMethodDef CallEntries[] = {
     {"_jackalope_add_substitution", (DL_FUNC) &_jackalope_add_substitution, 5},
     {"_jackalope_add_insertion", (DL_FUNC) &_jackalope_add_insertion, 5},
     {"_jackalope_add_deletion", (DL_FUNC) &_jackalope_add_deletion, 5},
+    {"_jackalope_add_many_mutations", (DL_FUNC) &_jackalope_add_many_mutations, 8},
     {"_jackalope_sub_TN93_cpp", (DL_FUNC) &_jackalope_sub_TN93_cpp, 8},
     {"_jackalope_sub_GTR_cpp", (DL_FUNC) &_jackalope_sub_GTR_cpp, 6},
     {"_jackalope_sub_UNREST_cpp", (DL_FUNC) &_jackalope_sub_UNREST_cpp, 5},
     {"_jackalope_using_openmp", (DL_FUNC) &_jackalope_using_openmp, 0},
+    {"_jackalope_max_threads", (DL_FUNC) &_jackalope_max_threads, 0},
+    {"_jackalope_comp_methods", (DL_FUNC) &_jackalope_comp_methods, 0},
+    {"_jackalope_rng_unifs", (DL_FUNC) &_jackalope_rng_unifs, 2},
     {NULL, NULL, 0}
 };
 
+void init_lazy_seqs(DllInfo* dll);
 RcppExport void R_init_jackalope(DllInfo *dll) {
     R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
+    init_lazy_seqs(dll);
 }
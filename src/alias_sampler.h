@@ -18,6 +18,7 @@
 #include <vector>
 #include <deque>
 #include <string>
+#include <array>
 #include <pcg/pcg_random.hpp> // pcg prng
 
 #include "jackalope_types.h" // integer types
@@ -48,9 +49,20 @@ public:
     // Copy constructor
     AliasSampler(const AliasSampler& other)
         : Prob(other.Prob), Alias(other.Alias), n(other.n) {}
+    AliasSampler& operator=(const AliasSampler& other) = default;
+    AliasSampler(AliasSampler&& other) noexcept
+        : Prob(std::move(other.Prob)), Alias(std::move(other.Alias)),
+          n(other.n) {}
+    AliasSampler& operator=(AliasSampler&& other) noexcept {
+        Prob = std::move(other.Prob);
+        Alias = std::move(other.Alias);
+        n = other.n;
+        return *this;
+    }
 
     // Actual alias sampling
-    inline uint64 sample(pcg64& eng) const {
+    template <typename E>
+    inline uint64 sample(E& eng) const {
         // Fair dice roll from n-sided die
         uint64 i = runif_01(eng) * n;
         // uniform in range (0,1)
@@ -109,13 +121,148 @@ private:
 
 
 
+/*
+ Alias sampling of integer lengths from a table: `probs[i]` is the probability of
+ length `start + i`, and `tail_prob` is that of all lengths past the table.
+ Distributions with long upper tails are tabulated up to where the tail is rare,
+ and `sample` returns false when the tail is chosen, so the caller can draw
+ those lengths some slower way.
+ */
+class LengthSampler {
+public:
+    // Where tables for long-tailed distributions end, and their largest size:
+    static constexpr double tail_thresh = 1e-8;
+    static constexpr uint64 max_size = 65536;
+
+    LengthSampler() : sampler(), start(0), n_table(0) {};
+    LengthSampler(const uint64& start_,
+                  std::vector<double> probs,
+                  const double& tail_prob)
+        : sampler(), start(start_), n_table(probs.size()) {
+        if (tail_prob > 0) probs.push_back(tail_prob);
+        sampler = AliasSampler(probs);
+    }
+
+    // Sets `len` and returns true, unless it's in the tail:
+    template <typename E>
+    inline bool sample(E& eng, uint64& len) const {
+        uint64 i = sampler.sample(eng);
+        if (i >= n_table) return false;
+        len = start + i;
+        return true;
+    };
+
+private:
+    AliasSampler sampler;
+    uint64 start;
+    uint64 n_table;
+};
+
+
+
+
+/*
+ Alias sampling for a number of items that's known at compile time
+ (e.g., 4 for nucleotides).
+ Tables are stored in `std::array`s, so nothing is allocated on the heap, and
+ each sample uses a single 64-bit draw: its high bits (after multiplying by `N`)
+ pick the column and its low bits decide between the column and its alias.
+ */
+template <uint64 N>
+class FixedAliasSampler {
+    static_assert(N > 0 && N <= 256, "FixedAliasSampler needs 0 < N <= 256");
+public:
+    FixedAliasSampler() {
+        for (uint64 i = 0; i < N; i++) {
+            Prob[i] = max_prob;
+            Alias[i] = i;
+        }
+    }
+    FixedAliasSampler(const std::vector<double>& probs) {
+        if (probs.size() != N) stop("FixedAliasSampler needs exactly N probabilities.");
+        std::array<double, N> p;
+        for (uint64 i = 0; i < N; i++) p[i] = probs[i];
+        construct(p);
+    }
+    FixedAliasSampler(const arma::rowvec& probs) {
+        if (probs.n_elem != N) stop("FixedAliasSampler needs exactly N probabilities.");
+        std::array<double, N> p;
+        for (uint64 i = 0; i < N; i++) p[i] = probs(i);
+        construct(p);
+    }
+
+    template <typename E>
+    inline uint64 sample(E& eng) const {
+        uint128 x = static_cast<uint128>(static_cast<uint64>(eng())) * N;
+        uint64 i = static_cast<uint64>(x >> 64);
+        uint64 u = static_cast<uint64>(x);
+        if (u < Prob[i]) return i;
+        return Alias[i];
+    }
+
+private:
+    // Probabilities of keeping each column, scaled to 64-bit integers:
+    std::array<uint64, N> Prob;
+    std::array<uint8, N> Alias;
+
+    static constexpr uint64 max_prob = ~static_cast<uint64>(0);
+
+    // Same as `AliasSampler::construct` but with fixed-size stacks:
+    void construct(std::array<double, N>& p) {
+
+        double total = 0;
+        for (const double& x : p) total += x;
+        for (double& x : p) x *= (static_cast<double>(N) / total);
+
+        std::array<uint8, N> Small;
+        std::array<uint8, N> Large;
+        uint64 n_small = 0, n_large = 0;
+        for (uint64 i = 0; i < N; i++) {
+            Alias[i] = i;
+            if (p[i] < 1) {
+                Small[n_small++] = i;
+            } else Large[n_large++] = i;
+        }
+
+        while (n_small > 0 && n_large > 0) {
+            uint8 l = Small[--n_small];
+            uint8 g = Large[--n_large];
+            Prob[l] = to_prob(p[l]);
+            Alias[l] = g;
+            p[g] = (p[g] + p[l]) - 1;
+            if (p[g] < 1) {
+                Small[n_small++] = g;
+            } else Large[n_large++] = g;
+        }
+        while (n_large > 0) Prob[Large[--n_large]] = max_prob;
+        while (n_small > 0) Prob[Small[--n_small]] = max_prob;
+
+        return;
+    }
+
+    static inline uint64 to_prob(const double& p) {
+        if (p <= 0) return 0;
+        // (2^64 as a double)
+        double x = p * 18446744073709551616.0;
+        if (x >= 18446744073709551616.0) return max_prob;
+        return static_cast<uint64>(x);
+    }
+};
+
+template <uint64 N>
+constexpr uint64 FixedAliasSampler<N>::max_prob;
+
+
+
+
 /*
  Class template for table sampling a string, using an underlying AliasSampler object.
  `chars_in` should be the characters to sample from, `probs` the probabilities of
  sampling those characters.
  `T` can be `std::string` or `RefChrom`. Others may work, but are not guaranteed.
+ `S` can be `FixedAliasSampler<N>` when there are always `N` characters.
  */
-template <typename T>
+template <typename T, typename S = AliasSampler>
 class AliasStringSampler {
 public:
 
@@ -133,24 +280,39 @@ public:
     AliasStringSampler(const AliasStringSampler& other)
         : characters(other.characters), uint_sampler(other.uint_sampler),
           n(other.n) {}
+    AliasStringSampler& operator=(const AliasStringSampler& other) = default;
+    AliasStringSampler(AliasStringSampler&& other) noexcept
+        : characters(std::move(other.characters)),
+          uint_sampler(std::move(other.uint_sampler)), n(other.n) {}
+    AliasStringSampler& operator=(AliasStringSampler&& other) noexcept {
+        characters = std::move(other.characters);
+        uint_sampler = std::move(other.uint_sampler);
+        n = other.n;
+        return *this;
+    }
 
-    void sample(std::string& str, pcg64& eng) const {
+    template <typename E>
+    void sample(std::string& str, E& eng) const {
         for (uint64 i = 0; i < str.size(); i++) {
             uint64 k = uint_sampler.sample(eng);
             str[i] = characters[k];
         }
         return;
     }
-    char sample(pcg64& eng) const {
+    template <typename E>
+    char sample(E& eng) const {
         uint64 k = uint_sampler.sample(eng);
         return characters[k];
     }
 
 private:
-    AliasSampler uint_sampler;
+    S uint_sampler;
     uint64 n;
 };
 
+// For sampling nucleotides from "TCAG":
+typedef AliasStringSampler<std::string, FixedAliasSampler<4>> NucleoSampler;
+
 
 
 
@@ -21,7 +21,8 @@
 #include "ref_classes.h"  // Ref* classes
 #include "jackalope_types.h"  // integer types
 #include "alias_sampler.h"  // alias string sampler
-#include "util.h"  // clear_memory, thread_check, jlp_shuffle
+#include "util.h"  // clear_memory, thread_check, jlp_shuffle, chrom_batches
+#include "lazy_seqs.h"  // detach_lazy_chroms
 
 
 using namespace Rcpp;
@@ -45,6 +46,7 @@ using namespace Rcpp;
 void merge_all_chromosomes_cpp(SEXP ref_genome_ptr) {
 
     XPtr<RefGenome> ref_genome(ref_genome_ptr);
+    detach_lazy_chroms(ref_genome_ptr);
     std::deque<RefChrom>& chroms(ref_genome->chromosomes);
 
     pcg64 eng = seeded_pcg();
@@ -81,6 +83,7 @@ void merge_chromosomes_cpp(SEXP ref_genome_ptr,
                            std::deque<uint64> chrom_inds) {
 
     XPtr<RefGenome> ref_genome(ref_genome_ptr);
+    detach_lazy_chroms(ref_genome_ptr);
     std::deque<RefChrom>& chroms(ref_genome->chromosomes);
 
     // Merging the back chromosomes to the first one:
@@ -147,6 +150,7 @@ void filter_chromosomes_cpp(SEXP ref_genome_ptr,
                           const double& out_chrom_prop = 0) {
 
     XPtr<RefGenome> ref_genome(ref_genome_ptr);
+    detach_lazy_chroms(ref_genome_ptr);
     std::deque<RefChrom>& chroms(ref_genome->chromosomes);
 
     // Checking for sensible inputs
@@ -231,6 +235,7 @@ void replace_Ns_cpp(SEXP ref_genome_ptr,
                     const bool& show_progress) {
 
     XPtr<RefGenome> ref_genome(ref_genome_ptr);
+    detach_lazy_chroms(ref_genome_ptr);
 
     // Check that # threads isn't too high and change to 1 if not using OpenMP:
     thread_check(n_threads);
@@ -238,7 +243,10 @@ void replace_Ns_cpp(SEXP ref_genome_ptr,
     // Generate seeds for random number generators (1 RNG per thread)
     const std::vector<std::vector<uint64>> seeds = mt_seeds(n_threads);
 
-    const uint64 n_chroms = ref_genome->size();
+    // Batches of chromosomes to do together:
+    const std::vector<uint64> batches = chrom_batches(ref_genome->chrom_sizes(),
+                                                      n_threads);
+    const uint64 n_batches = batches.size() - 1;
 
     // Progress bar
     Progress prog_bar(ref_genome->total_size, show_progress);
@@ -261,18 +269,20 @@ void replace_Ns_cpp(SEXP ref_genome_ptr,
     pcg64 eng = seeded_pcg(active_seeds);
 
     // Samples for nucleotides:
-    AliasStringSampler<std::string> sampler("TCAG", pi_tcag);
+    NucleoSampler sampler("TCAG", pi_tcag);
 
 #ifdef _OPENMP
 #pragma omp for schedule(static)
 #endif
-    for (uint64 i = 0; i < n_chroms; i++) {
+    for (uint64 b = 0; b < n_batches; b++) {
         if (prog_bar.is_aborted() || prog_bar.check_abort()) continue;
-        RefChrom& chrom(ref_genome->chromosomes[i]);
-        for (char& c : chrom.nucleos) {
-            if (c == 'N') c = sampler.sample(eng);
+        for (uint64 i = batches[b]; i < batches[b+1]; i++) {
+            RefChrom& chrom(ref_genome->chromosomes[i]);
+            for (char& c : chrom.nucleos) {
+                if (c == 'N') c = sampler.sample(eng);
+            }
+            prog_bar.increment(chrom.size());
         }
-        prog_bar.increment(chrom.size());
     }
 
 #ifdef _OPENMP
@@ -23,8 +23,8 @@
 #include "jackalope_types.h"  // integer types
 #include "ref_classes.h"  // Ref* classes
 #include "alias_sampler.h" // alias sampling
-#include "pcg.h" // pcg::max, mt_seeds, seeded_pcg
-#include "util.h" // thread_check
+#include "pcg.h" // mt_seeds, xoshiro256pp_x4
+#include "util.h" // thread_check, chrom_batches
 
 using namespace Rcpp;
 
@@ -72,11 +72,16 @@ OuterClass create_chromosomes_(const uint64& n_chroms,
     Progress prog_bar(n_chroms, false); // just use as way to check for abort
 
     // Alias-sampling object
-    const AliasSampler sampler(pi_tcag);
+    const FixedAliasSampler<4> sampler(pi_tcag);
 
     // Creating output object
     OuterClass chroms_out(n_chroms);
 
+    // Batches of chromosomes to create together (all have the same expected length):
+    const std::vector<uint64> batches = chrom_batches(std::vector<uint64>(n_chroms, 1),
+                                                      n_threads);
+    const uint64 n_batches = batches.size() - 1;
+
     // parameters for creating the gamma distribution
     const double gamma_shape = (len_mean * len_mean) / (len_sd * len_sd);
     const double gamma_scale = (len_sd * len_sd) / len_mean;
@@ -97,7 +102,8 @@ OuterClass create_chromosomes_(const uint64& n_chroms,
     active_seeds = seeds[0];
     #endif
 
-    pcg64 engine = seeded_pcg(active_seeds);
+    // (Block engine because each base takes one draw)
+    xoshiro256pp_x4 engine(active_seeds);
     // Gamma distribution to be used for size selection (doi: 10.1093/molbev/msr011):
     std::gamma_distribution<double> distr;
     if (len_sd > 0) {
@@ -110,23 +116,26 @@ OuterClass create_chromosomes_(const uint64& n_chroms,
     #ifdef _OPENMP
     #pragma omp for schedule(static)
     #endif
-    for (uint64 i = 0; i < n_chroms; i++) {
+    for (uint64 b = 0; b < n_batches; b++) {
 
         if (prog_bar.is_aborted() || prog_bar.check_abort()) continue;
 
-        InnerClass& chrom(chroms_out[i]);
-
-        // Get length of output chromosome:
-        uint64 len;
-        if (len_sd > 0) {
-            len = static_cast<uint64>(distr(engine));
-            if (len < 1) len = 1;
-        } else len = len_mean;
-        // Sample chromosome:
-        chrom.reserve(len);
-        for (uint64 j = 0; j < len; j++) {
-            uint64 k = sampler.sample(engine);
-            chrom.push_back(bases_[k]);
+        for (uint64 i = batches[b]; i < batches[b+1]; i++) {
+
+            InnerClass& chrom(chroms_out[i]);
+
+            // Get length of output chromosome:
+            uint64 len;
+            if (len_sd > 0) {
+                len = static_cast<uint64>(distr(engine));
+                if (len < 1) len = 1;
+            } else len = len_mean;
+            // Sample chromosome:
+            chrom.reserve(len);
+            for (uint64 j = 0; j < len; j++) {
+                uint64 k = sampler.sample(engine);
+                chrom.push_back(bases_[k]);
+            }
         }
     }
 
@@ -18,10 +18,12 @@
 #include <string>  // string class
 #include <cstring> // for std::strcpy
 #include <deque>  // deque class
+#include <type_traits>  // is_nothrow_move_*
 
 #include "jackalope_types.h"  // integer types
 #include "ref_classes.h"  // Ref* classes
 #include "util.h"  // clear_memory
+#include "memory_usage.h"  // MemoryUsage
 
 using namespace Rcpp;
 
@@ -124,6 +126,30 @@ struct AllMutations {
         }
         return *this;
     }
+    /*
+     Moving takes ownership of the nucleotide strings without copying them.
+     Moving a deque can allocate (e.g., in libstdc++), so these are only noexcept
+     when the deques' moves are.
+     */
+    AllMutations(AllMutations&& other)
+        noexcept(std::is_nothrow_move_constructible<std::deque<uint64>>::value &&
+                 std::is_nothrow_move_constructible<std::deque<char*>>::value)
+        : old_pos(std::move(other.old_pos)),
+          new_pos(std::move(other.new_pos)),
+          nucleos(std::move(other.nucleos)) {
+        other.nucleos.clear();
+    }
+    AllMutations& operator=(AllMutations&& other)
+        noexcept(std::is_nothrow_move_assignable<std::deque<uint64>>::value &&
+                 std::is_nothrow_move_assignable<std::deque<char*>>::value) {
+        if (this == &other) return *this;
+        for (uint64 i = 0; i < nucleos.size(); i++) delete [] nucleos[i];
+        old_pos = std::move(other.old_pos);
+        new_pos = std::move(other.new_pos);
+        nucleos = std::move(other.nucleos);
+        other.nucleos.clear();
+        return *this;
+    }
 
     ~AllMutations() {
         for (uint64 i = 0; i < nucleos.size(); i++) {
@@ -231,6 +257,22 @@ struct AllMutations {
         return;
     }
 
+    // Heap memory used by mutation information
+    MemoryUsage memory_usage() const {
+        MemoryUsage out;
+        out.add_deque<uint64>(old_pos, out.positions);
+        out.add_deque<uint64>(new_pos, out.positions);
+        // Pointers themselves are overhead; only the strings are nucleotides
+        out.add_deque<char*>(nucleos, out.overhead);
+        for (const char* nts : nucleos) {
+            if (nts == nullptr) continue;
+            uint64 n = std::strlen(nts);
+            out.nucleos += n;
+            out.overhead += mem_usage::malloc_chunk(n + 1) - n;
+        }
+        return out;
+    }
+
 
 private:
 
@@ -293,15 +335,21 @@ public:
     const RefChrom* ref_chrom;  // pointer to const RefChrom
     AllMutations mutations;
     uint64 chrom_size;
-    std::string name;
 
     // Constructors
     HapChrom() : ref_chrom(nullptr) {};
     HapChrom(const RefChrom& ref)
         : ref_chrom(&ref),
           mutations(),
-          chrom_size(ref.size()),
-          name(ref.name) {};
+          chrom_size(ref.size()) {};
+
+    /*
+     The name is the reference chromosome's. It isn't copied because genomes can
+     have many thousands of contigs and haplotypes.
+     */
+    const std::string& name() const {
+        return ref_chrom->name;
+    }
 
     /*
      Since all other classes have a size() method, I'm including this here:
@@ -310,6 +358,11 @@ public:
         return chrom_size;
     }
 
+    // Heap memory used by this chromosome (the reference chromosome isn't included)
+    MemoryUsage memory_usage() const {
+        return mutations.memory_usage();
+    }
+
     // Size modifier for a mutation
     sint64 size_modifier(const uint64& ind) const {
 
@@ -486,17 +539,13 @@ public:
     HapGenome() {};
     HapGenome(const RefGenome& ref) {
         name = "";
-        for (uint64 i = 0; i < ref.size(); i++) {
-            HapChrom hap_chrom(ref[i]);
-            chromosomes.push_back(hap_chrom);
-        }
+        chromosomes.reserve(ref.size());
+        for (uint64 i = 0; i < ref.size(); i++) chromosomes.emplace_back(ref[i]);
     };
     HapGenome(const std::string& name_, const RefGenome& ref) {
         name = name_;
-        for (uint64 i = 0; i < ref.size(); i++) {
-            HapChrom hap_chrom(ref[i]);
-            chromosomes.push_back(hap_chrom);
-        }
+        chromosomes.reserve(ref.size());
+        for (uint64 i = 0; i < ref.size(); i++) chromosomes.emplace_back(ref[i]);
     };
 
     // For easily outputting a reference to a HapChrom
@@ -519,6 +568,18 @@ public:
         for (uint64 i = 0; i < out.size(); i++) out[i] = chromosomes[i].size();
         return out;
     }
+    // Name of one chromosome
+    const std::string& chrom_name(const uint64& idx) const {
+        return chromosomes[idx].name();
+    }
+    // Heap memory used by this haplotype
+    MemoryUsage memory_usage() const {
+        MemoryUsage out;
+        out.add_string(name, out.names);
+        out.add_vector<HapChrom>(chromosomes, out.overhead);
+        for (const HapChrom& hc : chromosomes) out += hc.memory_usage();
+        return out;
+    }
 
 private:
 
@@ -605,6 +666,18 @@ public:
         return;
     }
 
+    /*
+     Memory used by all haplotypes.
+     The reference genome is shared with other objects, so it's not included here.
+     */
+    MemoryUsage memory_usage() const {
+        MemoryUsage out;
+        out.overhead += sizeof(HapSet);
+        out.add_vector<HapGenome>(haplotypes, out.overhead);
+        for (const HapGenome& hg : haplotypes) out += hg.memory_usage();
+        return out;
+    }
+
     // For printing output
     void print() const noexcept;
 
@@ -17,7 +17,7 @@
 #include "hap_classes.h"  // Hap* classes
 #include "pcg.h"  // pcg seeding
 #include "alias_sampler.h"  // alias method of sampling
-#include "util.h"  // thread_check
+#include "util.h"  // thread_check, chrom_batches
 
 using namespace Rcpp;
 
@@ -62,7 +62,7 @@ void add_one_chrom_ssites(HapSet& hap_set,
                         const uint64& chrom_i,
                         const arma::mat& ss_i,
                         MutationTypeSampler& type_sampler,
-                        AliasStringSampler<std::string>& insert_sampler,
+                        NucleoSampler& insert_sampler,
                         pcg64& eng) {
 
     uint64 pos;
@@ -130,12 +130,16 @@ SEXP add_ssites_cpp(SEXP& ref_genome_ptr,
     const uint64 n_haps = seg_sites[0].n_cols - 1;
 
     // Initialize new HapSet object
-    XPtr<HapSet> hap_set(new HapSet(*ref_genome, n_haps), true);
+    XPtr<HapSet> hap_set(new HapSet(*ref_genome, n_haps), true, R_NilValue,
+                         ref_genome_ptr);
 
     // Check that # threads isn't too high and change to 1 if not using OpenMP:
     thread_check(n_threads);
 
-    const uint64 n_chroms = ref_genome->size();
+    // Batches of chromosomes to add sites to together:
+    const std::vector<uint64> batches = chrom_batches(ref_genome->chrom_sizes(),
+                                                      n_threads);
+    const uint64 n_batches = batches.size() - 1;
     const uint64 total_chrom = ref_genome->total_size;
 
     Progress prog_bar(total_chrom, show_progress);
@@ -152,7 +156,7 @@ SEXP add_ssites_cpp(SEXP& ref_genome_ptr,
     // Type and insertion samplers:
     MutationTypeSampler type = make_type_sampler(Q, pi_tcag, insertion_rates,
                                                  deletion_rates);
-    AliasStringSampler<std::string> insert("TCAG", pi_tcag);
+    NucleoSampler insert("TCAG", pi_tcag);
 
     std::vector<uint64> active_seeds;
 
@@ -171,14 +175,16 @@ SEXP add_ssites_cpp(SEXP& ref_genome_ptr,
 #ifdef _OPENMP
 #pragma omp for schedule(static)
 #endif
-    for (uint64 i = 0; i < n_chroms; i++) {
+    for (uint64 b = 0; b < n_batches; b++) {
 
         if (prog_bar.is_aborted() || prog_bar.check_abort()) status_code = -1;
         if (status_code != 0) continue;
 
-        add_one_chrom_ssites(*hap_set, *ref_genome, i, seg_sites[i], type, insert, eng);
-
-        prog_bar.increment((*ref_genome)[i].size());
+        for (uint64 i = batches[b]; i < batches[b+1]; i++) {
+            add_one_chrom_ssites(*hap_set, *ref_genome, i, seg_sites[i], type, insert,
+                                 eng);
+            prog_bar.increment((*ref_genome)[i].size());
+        }
 
     }
 
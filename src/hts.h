@@ -13,7 +13,7 @@
 #include <progress.hpp>  // for the progress bar
 
 
-// for bgzip_file
+// for compress_file
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -22,8 +22,12 @@
 #include "jackalope_types.h"  // uint64
 #include "pcg.h"  // ruinf_01
 #include "util.h"  // str_stop, thread_check, split_int
+#include "progress_monitor.h"  // ProgressMonitor
 #include "io.h"  // File* types
 #include "alias_sampler.h"  // Alias sampler
+#include "ref_classes.h"  // Ref* classes
+#include "hap_classes.h"  // Hap* classes
+#include "memory_usage.h"  // mem_usage namespace
 
 
 using namespace Rcpp;
@@ -51,35 +55,43 @@ const std::vector<std::string> mm_nucleos = {"CAG", "TAG", "TCG", "TCA", "NNN"};
 
 /*
  Samples for # reads per group (e.g., per haplotype, per chromosome).
- It uses binomial distribution for a `n_reads` that decreases each iteration and a
- `probs` vector whose values go up.
+ It uses binomial distribution for a `n_reads` that decreases each iteration and
+ probabilities relative to the groups not yet sampled.
  This is ~600x faster than doing separate samples (via AliasSampler) for every read.
+ Keeping track of the remaining probability (rather than re-scaling all later groups
+ each iteration) makes this linear in the number of groups, which matters for
+ assemblies with many contigs.
  */
 inline std::vector<uint64> reads_per_group(uint64 n_reads,
-                                           std::vector<double> probs) {
+                                           const std::vector<double>& probs) {
 
     std::vector<uint64> out(probs.size(), 0.0);
     if (n_reads == 0 || probs.size() == 0) return out;
 
     pcg64 eng = seeded_pcg();
 
-    double sum_probs = std::accumulate(probs.begin(), probs.end(), 0.0);
-    for (double& p : probs) p /= sum_probs;
+    double remaining = std::accumulate(probs.begin(), probs.end(), 0.0);
 
     std::binomial_distribution<uint64> distr(n_reads, 0.5);
 
-    for (uint64 i = 0; i < (probs.size() - 1); i++) {
+    // Whatever's left goes to the last group that can be sampled:
+    uint64 last = probs.size() - 1;
+    while (last > 0 && probs[last] == 0) last--;
 
-        if (probs[i] >= 1) {
+    for (uint64 i = 0; i < last; i++) {
+
+        if (probs[i] == 0) continue;
+
+        double prob = probs[i] / remaining;
+
+        if (prob >= 1) {
             out[i] = n_reads;
             return out;
         }
 
-        if (probs[i] == 0) continue;
-
         // Update distribution:
         distr.param(std::binomial_distribution<uint64>::param_type(
-                n_reads, probs[i]));
+                n_reads, prob));
 
         // Sample from binomial distribution:
         out[i] = distr(eng);
@@ -89,14 +101,11 @@ inline std::vector<uint64> reads_per_group(uint64 n_reads,
         // If `n_reads` is zero, we can stop now:
         if (n_reads == 0) break;
 
-        // Increase probabilities:
-        sum_probs = 1 - probs[i];
-        for (uint64 j = (i+1); j < probs.size(); j++) {
-            probs[j] /= sum_probs;
-        }
+        // Remove this group's probability from the ones left:
+        remaining -= probs[i];
     }
 
-    out.back() = n_reads;
+    out[last] = n_reads;
 
     return out;
 
@@ -104,6 +113,41 @@ inline std::vector<uint64> reads_per_group(uint64 n_reads,
 
 
 
+/*
+ Number of reads for one chromosome on one haplotype.
+ Classes making reads from haplotypes only store these for chromosomes that get reads,
+ so their tables don't scale with (# haplotypes) * (# chromosomes).
+ */
+struct ChromReads {
+    uint64 hap;
+    uint64 chrom;
+    uint64 n;
+    ChromReads(const uint64& hap_, const uint64& chrom_, const uint64& n_)
+        : hap(hap_), chrom(chrom_), n(n_) {}
+};
+
+/*
+ Add # reads for chromosomes on haplotype `hap` to `chrom_reads`, weighted by
+ chromosome size.
+ If `n_read_ends` > 1, reads are split as pairs, then converted back to # reads.
+ */
+inline void add_chrom_reads(std::vector<ChromReads>& chrom_reads,
+                            const uint64& hap,
+                            const uint64& n_reads,
+                            const std::vector<uint64>& chrom_sizes,
+                            const uint64& n_read_ends = 1) {
+    if (n_reads == 0) return;
+    std::vector<double> chrom_probs(chrom_sizes.begin(), chrom_sizes.end());
+    std::vector<uint64> reads = reads_per_group(n_reads, chrom_probs);
+    for (uint64 i = 0; i < reads.size(); i++) {
+        if (reads[i] > 0) chrom_reads.emplace_back(hap, i, reads[i] * n_read_ends);
+    }
+    return;
+}
+
+
+
+
 // Fill read from string rather than haplotype chromosome
 
 inline void fill_read__(const std::string& chrom,
@@ -133,16 +177,19 @@ inline void fill_read__(const std::string& chrom,
 
 
 
-//' bgzip a file, potentially using multiple threads.
+//' Compress a file, potentially using multiple threads.
+//'
+//' `F` should be `FileBGZF` or `FileZstd`.
 //'
 //' @noRd
 //'
-inline int bgzip_file(const std::string& file_name,
-                      const int& n_threads,
-                      const int& compress) {
+template <typename F>
+inline int compress_file(const std::string& file_name,
+                         const int& n_threads,
+                         const int& compress) {
 
     // Make writer object:
-    FileBGZF bgzf(file_name, n_threads, compress);
+    F comp_file(file_name, n_threads, compress);
     // Others used below:
     void *buffer;
     int c;
@@ -154,11 +201,11 @@ inline int bgzip_file(const std::string& file_name,
 
     // Checking source file:
     if (stat(file_name.c_str(), &sbuf) < 0) {
-        str_stop({"\nIn bgzip step, file ", file_name,
+        str_stop({"\nIn compression step, file ", file_name,
                  " had non-zero status: ", strerror(errno), "."});
     }
     if ((f_src = open(file_name.c_str(), O_RDONLY)) < 0) {
-        str_stop({"\nIn bgzip step, file ", file_name, " could not be opened."});
+        str_stop({"\nIn compression step, file ", file_name, " could not be opened."});
     }
 
     // Create buffer of info to pass between:
@@ -168,10 +215,10 @@ inline int bgzip_file(const std::string& file_name,
 #endif
     // Writing info from one to another
     while ((c = read(f_src, buffer, WINDOW_SIZE)) > 0) {
-        bgzf.write(buffer, c);
+        comp_file.write(buffer, c);
     }
 
-    bgzf.close();
+    comp_file.close();
     unlink(file_name.c_str());
     free(buffer);
     close(f_src);
@@ -187,7 +234,7 @@ inline int bgzip_file(const std::string& file_name,
 Info for making reads and writing them, for one thread.
 
 `T` can be `[Illumina/PacBio]Reference` or `[Illumina/PacBio]Haplotypes`.
- `F` should be `FileUncomp`, `FileGZ`, or `FileBGZF`.
+ `F` should be `FileUncomp`, `FileGZ`, `FileBGZF`, or `FileZstd`.
 */
 
 template <typename T, typename F>
@@ -209,7 +256,8 @@ public:
                         const uint64& n_reads_,
                         const uint64& read_pool_size_,
                         const double& prob_dup_,
-                        const uint64& n_read_ends_)
+                        const uint64& n_read_ends_,
+                        const uint64& n_pools)
         : read_filler(&read_filler_),
           n_reads(n_reads_),
           read_pool_size(read_pool_size_),
@@ -218,7 +266,7 @@ public:
           do_write(false),
           prob_dup(prob_dup_),
           n_read_ends(n_read_ends_),
-          fastq_pools(n_read_ends_) {};
+          fastq_pools(n_pools) {};
 
 
     // Write contents in `fastq_pools` to UNcompressed file(s).
@@ -251,7 +299,8 @@ public:
      Add new read(s) to `fastq_pools`, and update bool for whether you should
      write to file
      */
-    void create_reads(pcg64& eng) {
+    template <typename E>
+    void create_reads(E& eng) {
         bool finished  = false;
         read_filler->template one_read<std::vector<char>>(fastq_pools, finished, eng);
         // This is if something happens inside `one_read` to make sequencing finished
@@ -295,6 +344,109 @@ public:
 
 
 
+/*
+ ======================================================================================
+ ======================================================================================
+
+ Memory budget
+
+ ======================================================================================
+ ======================================================================================
+ */
+
+
+/*
+ Mean length of read names ("<genome>-<chromosome>-<position>-<R or F>[/<read end>]")
+ for a reference genome or set of haplotypes.
+ */
+inline uint64 read_name_length(const RefGenome& ref) {
+    uint64 max_name = 0;
+    for (const RefChrom& rc : ref.chromosomes) {
+        if (rc.name.size() > max_name) max_name = rc.name.size();
+    }
+    return ref.name.size() + max_name + 24ULL;
+}
+inline uint64 read_name_length(const HapSet& hap_set) {
+    uint64 max_hap = 0;
+    for (uint64 i = 0; i < hap_set.size(); i++) {
+        if (hap_set[i].name.size() > max_hap) max_hap = hap_set[i].name.size();
+    }
+    const RefGenome& ref(*(hap_set.reference));
+    return read_name_length(ref) - ref.name.size() + max_hap;
+}
+
+/*
+ Bytes of sequence each thread stores on its own.
+ Haplotype read fillers keep one full haplotype chromosome per thread;
+ reference ones read straight from the shared reference.
+ */
+inline uint64 thread_chrom_bytes(const RefGenome& ref) {
+    return 0ULL;
+}
+inline uint64 thread_chrom_bytes(const HapSet& hap_set) {
+    uint64 max_chrom = 0;
+    for (uint64 i = 0; i < hap_set.size(); i++) {
+        for (const HapChrom& hc : hap_set[i].chromosomes) {
+            if (hc.size() > max_chrom) max_chrom = hc.size();
+        }
+    }
+    return max_chrom;
+}
+
+
+/*
+ Adjust the number of threads and the read-pool size so that simulating reads
+ should use no more than `max_memory` bytes (it does nothing if `max_memory <= 0`).
+
+ `shared_bytes` is memory used by all threads together (e.g., sampler tables),
+ `thread_bytes` is fixed memory used by each thread, and
+ `read_bytes` is the memory used by each read stored in a pool.
+
+ The read-pool size is reduced first (to no fewer than 100 reads), then the
+ number of threads.
+ If one thread still doesn't fit, the pool shrinks further, and it's an error if
+ even a pool of one read (pair) doesn't fit.
+ */
+inline void fit_memory_budget(const double& max_memory,
+                              const uint64& shared_bytes,
+                              const uint64& thread_bytes,
+                              const uint64& read_bytes,
+                              const uint64& n_read_ends,
+                              uint64& n_threads,
+                              uint64& read_pool_size) {
+
+    if (max_memory <= 0) return;
+
+    thread_check(n_threads);
+
+    uint64 min_bytes = shared_bytes + thread_bytes +
+        mem_usage::read_pool(n_read_ends, read_bytes);
+    if (max_memory < static_cast<double>(min_bytes)) {
+        str_stop({"\nThe memory budget (max_memory = ",
+                 std::to_string(static_cast<uint64>(max_memory)),
+                 " bytes) is too small to simulate these reads. ",
+                 "At least ", std::to_string(min_bytes), " bytes are needed."});
+    }
+    uint64 available = static_cast<uint64>(max_memory) - shared_bytes;
+
+    uint64 min_pool = std::min(read_pool_size, static_cast<uint64>(100));
+    uint64 min_thread = thread_bytes + mem_usage::read_pool(min_pool, read_bytes);
+    while (n_threads > 1 && n_threads * min_thread > available) n_threads--;
+
+    // Largest pool that fits with this many threads:
+    uint64 max_pool = (available / n_threads - thread_bytes) / (2ULL * read_bytes);
+    if (max_pool < n_read_ends) max_pool = n_read_ends;
+    if (max_pool < read_pool_size) read_pool_size = max_pool;
+
+    return;
+}
+
+
+
+
+
+
+
 /*
  ======================================================================================
  ======================================================================================
@@ -315,12 +467,16 @@ public:
  This should only be called inside that function.
 
  `T` should be `[Illumina|PacBio]Reference` or `[Illumina|PacBio]Haplotypes`.
- `T` should have an `add_n_reads` method.
+ `T` should have `add_n_reads`, `set_first_id`, and `n_extra_pools` methods.
+ An extra pool is for a table of read IDs, which is written to
+ `<out_prefix>_names.tsv`.
+
+ `F` should be `FileUncomp`, `FileGZ`, `FileBGZF`, or `FileZstd`.
 
- `F` should be `FileUncomp`, `FileGZ`, or `FileBGZF`.
+ `E` is the RNG engine type (see `seeded_engine`).
 
  */
-template <typename T, typename F>
+template <typename T, typename F, typename E>
 inline void write_reads_one_filetype_(const T& read_filler_base,
                                       const std::string& out_prefix,
                                       uint64 n_reads,
@@ -339,19 +495,27 @@ inline void write_reads_one_filetype_(const T& read_filler_base,
     const std::vector<std::vector<uint64>> seeds = mt_seeds(n_threads);
 
     // Create and open files:
-    std::vector<F> files(n_read_ends);
+    const uint64 n_files = n_read_ends + read_filler_base.n_extra_pools();
+    std::vector<F> files(n_files);
     for (uint64 i = 0; i < n_read_ends; i++) {
         std::string file_name = out_prefix + "_R" + std::to_string(i+1) + ".fq";
         files[i].set(file_name, compress);
     }
+    if (n_files > n_read_ends) files.back().set(out_prefix + "_names.tsv", compress);
 
-    // Create read filler for each thread:
+    // Create read filler for each thread (with its own range of read IDs):
     std::vector<T> read_fillers;
+    read_fillers.reserve(n_threads);
+    uint64 first_id = 0;
     for (uint64 i = 0; i < n_threads; i++) {
         read_fillers.push_back(read_filler_base);
         read_fillers.back().add_n_reads(reads_per_thread[i]);
+        read_fillers.back().set_first_id(first_id);
+        first_id += reads_per_thread[i] / n_read_ends;
     }
 
+    // Threads only update counters; the master thread updates the progress bar
+    ProgressMonitor monitor(prog_bar, n_threads);
 
 #ifdef _OPENMP
 #pragma omp parallel num_threads(n_threads) default(shared) if (n_threads > 1)
@@ -368,35 +532,25 @@ inline void write_reads_one_filetype_(const T& read_filler_base,
 #endif
     active_seeds = seeds[active_thread];
 
-    pcg64 eng = seeded_pcg(active_seeds);
+    E eng = seeded_engine<E>(active_seeds);
 
     uint64 reads_this_thread = reads_per_thread[active_thread];
 
     ReadWriterOneThread<T,F> writer(read_fillers[active_thread], reads_this_thread,
-                                    read_pool_size, prob_dup, n_read_ends);
+                                    read_pool_size, prob_dup, n_read_ends, n_files);
 
     uint64 reads_written;
-    uint64 old_reads = 0;
-    uint64 new_reads = 0;
 
     while (writer.reads_made < reads_this_thread) {
 
-        old_reads = writer.pool_size();
-
         writer.create_reads(eng);
 
-        new_reads += (writer.pool_size() - old_reads);
-
         /*
-         Every 10,000 characters created, check that the user hasn't
-         interrupted the process.
-         (Doing it this way makes the check approximately the same between
-          illumina and pacbio.)
+         Check that the user hasn't interrupted the process.
+         This only reads a flag (and, for the master thread, a clock),
+         so it's cheap enough to do after every read.
          */
-        if (new_reads > 10000) {
-            if (prog_bar.check_abort()) break;
-            new_reads = 0;
-        }
+        if (monitor.check_abort()) break;
 
         if (writer.do_write) {
             // Save info for progress bar:
@@ -411,11 +565,13 @@ inline void write_reads_one_filetype_(const T& read_filler_base,
 }
 #endif
             // Increment progress bar
-            prog_bar.increment(reads_written);
+            monitor.increment(reads_written);
 
         }
     }
 
+    monitor.finish();
+
 #ifdef _OPENMP
 }
 #endif
@@ -432,14 +588,14 @@ inline void write_reads_one_filetype_(const T& read_filler_base,
 
 
 /*
- For one sequencing-filler type, make reads and write them to file(s).
+ For one sequencing-filler type and RNG engine, make reads and write them to file(s).
 
  `T` should be `[Illumina|PacBio]Reference` or `[Illumina|PacBio]Haplotypes`.
 
  */
 
-template <typename T>
-inline void write_reads_cpp_(const T& read_filler_base,
+template <typename T, typename E>
+inline void write_reads_engine_(const T& read_filler_base,
                              std::string out_prefix,
                              const uint64& n_reads,
                              const double& prob_dup,
@@ -460,11 +616,16 @@ inline void write_reads_cpp_(const T& read_filler_base,
     if (compress > 0 && n_threads == 1) {
 
         if (comp_method == "gzip") {
-            write_reads_one_filetype_<T, FileGZ>(
+            write_reads_one_filetype_<T, FileGZ, E>(
                     read_filler_base, out_prefix, n_reads, prob_dup,
                     read_pool_size, n_read_ends, n_threads, compress, prog_bar);
         } else if (comp_method == "bgzip") {
-            write_reads_one_filetype_<T, FileBGZF>(
+            write_reads_one_filetype_<T, FileBGZF, E>(
+                    read_filler_base, out_prefix, n_reads, prob_dup,
+                    read_pool_size, n_read_ends, n_threads, compress, prog_bar);
+        } else if (comp_method == "zstd") {
+            check_zstd();
+            write_reads_one_filetype_<T, FileZstd, E>(
                     read_filler_base, out_prefix, n_reads, prob_dup,
                     read_pool_size, n_read_ends, n_threads, compress, prog_bar);
         } else stop("\nUnrecognized compression method.");
@@ -473,24 +634,40 @@ inline void write_reads_cpp_(const T& read_filler_base,
      Compressed output run in parallel.
      The only way I've found to make this actually have a speed advantage over
      running serially is to make it first write to uncompressed output in parallel,
-     then do the compression using `BGZF` also in parallel.
+     then do the compression (in blocks) also in parallel.
      */
     } else if (compress > 0 && n_threads > 1) {
 
+        if (comp_method != "bgzip" && comp_method != "zstd") {
+            stop("\nOnly bgzip or zstd compression can be done in parallel.");
+        }
+        if (comp_method == "zstd") check_zstd();
+
         // First do it uncompressed:
-        write_reads_one_filetype_<T, FileUncomp>(
+        write_reads_one_filetype_<T, FileUncomp, E>(
                 read_filler_base, out_prefix, n_reads, prob_dup,
                 read_pool_size, n_read_ends, n_threads, compress, prog_bar);
+        std::vector<std::string> file_names;
         for (uint64 i = 0; i < n_read_ends; i++) {
-            std::string file_name = out_prefix + "_R" + std::to_string(i+1)+ ".fq";
-            bgzip_file(file_name, static_cast<int>(n_threads),
-                       static_cast<int>(compress));
+            file_names.push_back(out_prefix + "_R" + std::to_string(i+1)+ ".fq");
+        }
+        if (read_filler_base.n_extra_pools() > 0) {
+            file_names.push_back(out_prefix + "_names.tsv");
+        }
+        for (uint64 i = 0; i < file_names.size(); i++) {
+            if (comp_method == "zstd") {
+                compress_file<FileZstd>(file_names[i], static_cast<int>(n_threads),
+                                        static_cast<int>(compress));
+            } else {
+                compress_file<FileBGZF>(file_names[i], static_cast<int>(n_threads),
+                                        static_cast<int>(compress));
+            }
             // For progress bar, I assume compression takes half as long:
-            prog_bar.increment(n_reads / (n_read_ends * 2));
+            if (i < n_read_ends) prog_bar.increment(n_reads / (n_read_ends * 2));
         }
     // Uncompressed output run in serial or parallel
     } else {
-        write_reads_one_filetype_<T, FileUncomp>(
+        write_reads_one_filetype_<T, FileUncomp, E>(
                 read_filler_base, out_prefix, n_reads, prob_dup,
                 read_pool_size, n_read_ends, n_threads, compress, prog_bar);
     }
@@ -500,17 +677,70 @@ inline void write_reads_cpp_(const T& read_filler_base,
 }
 
 
+/*
+ Same as above, but choosing the RNG engine at run time.
+ `rng` can be "pcg64", "pcg64_fast", "xoshiro256pp", or "xoshiro256pp_x4".
+ */
+template <typename T>
+inline void write_reads_cpp_(const T& read_filler_base,
+                             const std::string& out_prefix,
+                             const uint64& n_reads,
+                             const double& prob_dup,
+                             const uint64& read_pool_size,
+                             const uint64& n_read_ends,
+                             const uint64& n_threads,
+                             const int& compress,
+                             const std::string& comp_method,
+                             const std::string& rng,
+                             Progress& prog_bar) {
+
+    if (rng == "pcg64") {
+        write_reads_engine_<T, pcg64>(
+            read_filler_base, out_prefix, n_reads, prob_dup, read_pool_size,
+            n_read_ends, n_threads, compress, comp_method, prog_bar);
+    } else if (rng == "pcg64_fast") {
+        write_reads_engine_<T, pcg64_fast>(
+            read_filler_base, out_prefix, n_reads, prob_dup, read_pool_size,
+            n_read_ends, n_threads, compress, comp_method, prog_bar);
+    } else if (rng == "xoshiro256pp") {
+        write_reads_engine_<T, xoshiro256pp>(
+            read_filler_base, out_prefix, n_reads, prob_dup, read_pool_size,
+            n_read_ends, n_threads, compress, comp_method, prog_bar);
+    } else if (rng == "xoshiro256pp_x4") {
+        write_reads_engine_<T, xoshiro256pp_x4>(
+            read_filler_base, out_prefix, n_reads, prob_dup, read_pool_size,
+            n_read_ends, n_threads, compress, comp_method, prog_bar);
+    } else stop("\nUnrecognized RNG engine.");
+
+    return;
+}
+
+
 
 
 
 /*
- Same as above, but for when you want a separate file per haplotype.
+ Same as above, but for when you want separate files for groups of haplotypes
+ (e.g., samples in a multiplexed lane).
+ Haplotype `i` goes to the files for group `file_inds[i]`, whose names end with
+ `file_names[file_inds[i]]`.
+
+ Groups are done one after another, each making only its own share of the reads
+ (haplotypes outside the group get zero reads), so every read is still made
+ exactly once and the total work is the same as writing one set of files.
+ Read fillers already make reads one haplotype and chromosome at a time rather
+ than sampling a haplotype for each read, so doing groups in turn doesn't change
+ which reads are made. It just lets each group use the regular writer (including
+ parallel compression) without every thread keeping pools for every group.
+ Each group's reads are made using the same `read_filler_base`, so samplers
+ are only made once.
 
  So `T` should be `[Illumina|PacBio]Haplotypes`.
  */
 
 template <typename T>
-inline void write_reads_cpp_sep_files_(const HapSet& hap_set,
+inline void write_reads_cpp_sep_files_(const std::vector<std::string>& file_names,
+                                       const std::vector<uint64>& file_inds,
                                        const std::vector<double>& haplotype_probs,
                                        T read_filler_base,
                                        const std::string& out_prefix,
@@ -521,35 +751,71 @@ inline void write_reads_cpp_sep_files_(const HapSet& hap_set,
                                        const uint64& n_threads,
                                        const int& compress,
                                        const std::string& comp_method,
+                                       const std::string& rng,
                                        Progress& prog_bar) {
 
     // Sample for reads per file:
+    std::vector<double> file_probs(file_names.size(), 0.0);
+    for (uint64 i = 0; i < file_inds.size(); i++) {
+        file_probs[file_inds[i]] += haplotype_probs[i];
+    }
     std::vector<uint64> reads_per_file = reads_per_group(n_reads / n_read_ends,
-                                                         haplotype_probs);
+                                                         file_probs);
     if (n_read_ends > 1) for (uint64& rpf : reads_per_file) rpf *= n_read_ends;
 
-    // Now do each haplotype as separate file:
-    std::vector<double> hap_probs_(hap_set.size(), 0.0);
+    // Now do each group as separate file:
+    std::vector<double> hap_probs_(file_inds.size());
 
-    for (uint64 i = 0; i < hap_set.size(); i++) {
+    for (uint64 i = 0; i < file_names.size(); i++) {
 
         if (prog_bar.check_abort()) break;
 
-        hap_probs_[i] = 1;
+        for (uint64 j = 0; j < file_inds.size(); j++) {
+            hap_probs_[j] = (file_inds[j] == i) ? haplotype_probs[j] : 0;
+        }
         read_filler_base.hap_probs = hap_probs_;
 
-        std::string out_prefix_ = out_prefix + '_' + hap_set[i].name;
+        std::string out_prefix_ = out_prefix + '_' + file_names[i];
 
         write_reads_cpp_<T>(
             read_filler_base, out_prefix_, reads_per_file[i], prob_dup,
             read_pool_size, n_read_ends, n_threads, compress, comp_method,
-            prog_bar);
+            rng, prog_bar);
 
-        hap_probs_[i] = 0;
     }
 
     return;
 }
+// One file per haplotype:
+template <typename T>
+inline void write_reads_cpp_sep_files_(const HapSet& hap_set,
+                                       const std::vector<double>& haplotype_probs,
+                                       const T& read_filler_base,
+                                       const std::string& out_prefix,
+                                       const uint64& n_reads,
+                                       const double& prob_dup,
+                                       const uint64& read_pool_size,
+                                       const uint64& n_read_ends,
+                                       const uint64& n_threads,
+                                       const int& compress,
+                                       const std::string& comp_method,
+                                       const std::string& rng,
+                                       Progress& prog_bar) {
+
+    std::vector<std::string> file_names(hap_set.size());
+    std::vector<uint64> file_inds(hap_set.size());
+    for (uint64 i = 0; i < hap_set.size(); i++) {
+        file_names[i] = hap_set[i].name;
+        file_inds[i] = i;
+    }
+
+    write_reads_cpp_sep_files_<T>(
+        file_names, file_inds, haplotype_probs, read_filler_base, out_prefix,
+        n_reads, prob_dup, read_pool_size, n_read_ends, n_threads, compress,
+        comp_method, rng, prog_bar);
+
+    return;
+}
 
 
 
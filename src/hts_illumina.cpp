@@ -2,9 +2,10 @@
 #include "jackalope_config.h" // controls debugging and diagnostics output
 
 #include <RcppArmadillo.h>
-#include <algorithm> // lower_bound
+#include <algorithm> // lower_bound, max
 #include <vector>  // vector class
 #include <string>  // string class
+#include <memory>  // shared_ptr
 #include <pcg/pcg_random.hpp> // pcg prng
 
 #include <fstream> // for writing FASTQ files
@@ -28,13 +29,71 @@ using namespace Rcpp;
 
 
 
+IlluminaFragLenSampler::IlluminaFragLenSampler(const double& shape_,
+                                               const double& scale_,
+                                               const uint64& min_len,
+                                               const uint64& max_len_)
+    : table(), shape(shape_), scale(scale_), max_len(max_len_),
+      tail_start(max_len_ + 1), tail_prob(0) {
+
+    if (max_len < min_len) max_len = min_len;
+
+    // Last length in the table:
+    uint64 end = max_len;
+    double q = R::qgamma(LengthSampler::tail_thresh, shape, scale, 0, 0);
+    if (q < static_cast<double>(max_len)) {
+        end = std::max(min_len, static_cast<uint64>(q));
+    }
+    if ((end - min_len) >= LengthSampler::max_size) {
+        end = min_len + LengthSampler::max_size - 1;
+    }
+
+    /*
+     Length `k` gets P(k <= X < k+1), except that the minimum also gets everything
+     below it and the maximum everything above it.
+     */
+    std::vector<double> probs(end - min_len + 1);
+    double surv = 1; // P(X >= k), where lengths below `min_len` count as `min_len`
+    for (uint64 k = min_len; k <= end; k++) {
+        double surv_next = 0;
+        if (k < max_len) {
+            surv_next = R::pgamma(static_cast<double>(k + 1), shape, scale, 0, 0);
+        }
+        probs[k - min_len] = surv - surv_next;
+        surv = surv_next;
+    }
+    if (end < max_len) {
+        tail_start = end + 1;
+        tail_prob = surv;
+    }
+
+    table = std::make_shared<LengthSampler>(min_len, probs, tail_prob);
+
+}
+
+template <typename E>
+uint64 IlluminaFragLenSampler::sample(E& eng) const {
+    uint64 len;
+    if (table->sample(eng, len)) return len;
+    // Inverting the upper tail, conditional on being at least `tail_start`:
+    double u = static_cast<double>(runif_01(eng)) * tail_prob;
+    double x = R::qgamma(u, shape, scale, 0, 0);
+    if (!(x < static_cast<double>(max_len))) return max_len;
+    len = static_cast<uint64>(x);
+    if (len < tail_start) len = tail_start;
+    return len;
+}
+
+
+
+
 
 // Sample one set of read strings (each with 4 lines: ID, chromosome, "+", quality)
 template <typename T>
-template <typename U>
+template <typename U, typename E>
 void IlluminaOneGenome<T>::one_read(std::vector<U>& fastq_pools,
                                     bool& finished,
-                                    pcg64& eng) {
+                                    E& eng) {
 
     /*
      Sample fragment info, and set the chromosome space(s) required for these read(s).
@@ -54,11 +113,11 @@ void IlluminaOneGenome<T>::one_read(std::vector<U>& fastq_pools,
 
 // Overloaded for when we input a haplotype chromosome stored as string
 template <typename T>
-template <typename U>
+template <typename U, typename E>
 void IlluminaOneGenome<T>::one_read(const std::string& chrom,
                                     const uint64& chrom_i,
                                     std::vector<U>& fastq_pools,
-                                    pcg64& eng) {
+                                    E& eng) {
 
     constr_info.chrom_ind = chrom_i;
 
@@ -78,10 +137,10 @@ void IlluminaOneGenome<T>::one_read(const std::string& chrom,
  run once before.
  */
 template <typename T>
-template <typename U>
+template <typename U, typename E>
 void IlluminaOneGenome<T>::re_read(std::vector<U>& fastq_pools,
                                    bool& finished,
-                                   pcg64& eng) {
+                                   E& eng) {
 
     // Here I'm just re-doing indels bc it's a duplicate.
     just_indels(eng);
@@ -92,11 +151,11 @@ void IlluminaOneGenome<T>::re_read(std::vector<U>& fastq_pools,
     return;
 }
 template <typename T>
-template <typename U>
+template <typename U, typename E>
 void IlluminaOneGenome<T>::re_read(const std::string& chrom,
                                    const uint64& chrom_i,
                                    std::vector<U>& fastq_pools,
-                                   pcg64& eng) {
+                                   E& eng) {
 
     constr_info.chrom_ind = chrom_i;
 
@@ -114,25 +173,41 @@ void IlluminaOneGenome<T>::re_read(const std::string& chrom,
 
 // Sample for insertion and deletion positions
 template <typename T>
-void IlluminaOneGenome<T>::sample_indels(pcg64& eng) {
+template <typename E>
+void IlluminaOneGenome<T>::sample_indels(E& eng) {
 
     const uint64& frag_len(constr_info.frag_len);
 
     for (uint64 r = 0; r < insertions.size(); r++) {
         uint64 frag_pos = 0;
         uint64 length_now = 0;
-        double u;
-        std::deque<uint64>& ins(insertions[r]);
-        std::deque<uint64>& del(deletions[r]);
+        std::vector<uint64>& ins(insertions[r]);
+        std::vector<uint64>& del(deletions[r]);
         const double& ins_prob(ins_probs[r]);
         const double& del_prob(del_probs[r]);
+        const double indel_prob = ins_prob + del_prob;
         ins.clear();
         del.clear();
+        if (indel_prob <= 0) continue;
+        /*
+         Rather than a uniform number for every position, this jumps over the
+         positions without indels.
+         The number of those before the next indel is geometric.
+         (`log(1 - indel_prob)`, or zero if every position has an indel)
+         */
+        const double log_stay = (indel_prob < 1) ? std::log1p(-indel_prob) : 0;
         while (length_now < read_length && frag_pos < frag_len) {
-            u = runif_01(eng);
-            if (u > (ins_prob + del_prob)) {
-                length_now++;
-            } else if (u > ins_prob) {
+            if (indel_prob < 1) {
+                // Positions left before reaching the read length or fragment end:
+                uint64 n_left = std::min(read_length - length_now, frag_len - frag_pos);
+                double jump = std::log(runif_01(eng)) / log_stay;
+                if (jump >= static_cast<double>(n_left)) break;
+                uint64 n_jump = static_cast<uint64>(jump);
+                length_now += n_jump;
+                frag_pos += n_jump;
+            }
+            // Which indel it is:
+            if (runif_01(eng) * indel_prob > ins_prob) {
                 del.push_back(frag_pos);
             } else {
                 if (length_now == (read_length - 1)) {
@@ -189,7 +264,8 @@ void IlluminaOneGenome<T>::adjust_chrom_spaces() {
  Lastly, it sets the chromosome spaces required for these reads.
  */
 template <typename T>
-void IlluminaOneGenome<T>::chrom_indels_frag(pcg64& eng) {
+template <typename E>
+void IlluminaOneGenome<T>::chrom_indels_frag(E& eng) {
 
     uint64& chrom_ind(constr_info.chrom_ind);
     uint64& frag_len(constr_info.frag_len);
@@ -203,9 +279,7 @@ void IlluminaOneGenome<T>::chrom_indels_frag(pcg64& eng) {
     uint64 chrom_len = (*chromosomes)[chrom_ind].size();
 
     // Sample fragment length:
-    frag_len = static_cast<uint64>(frag_lengths(eng));
-    if (frag_len < frag_len_min) frag_len = frag_len_min;
-    if (frag_len > frag_len_max) frag_len = frag_len_max;
+    frag_len = frag_lengths.sample(eng);
 
     // Sample fragment starting position:
     if (frag_len >= chrom_len) {
@@ -233,7 +307,8 @@ void IlluminaOneGenome<T>::chrom_indels_frag(pcg64& eng) {
  This is for when the chromosome is already set.
  */
 template <typename T>
-void IlluminaOneGenome<T>::indels_frag(pcg64& eng) {
+template <typename E>
+void IlluminaOneGenome<T>::indels_frag(E& eng) {
 
     uint64& chrom_ind(constr_info.chrom_ind);
     uint64& frag_len(constr_info.frag_len);
@@ -242,9 +317,7 @@ void IlluminaOneGenome<T>::indels_frag(pcg64& eng) {
     uint64 chrom_len = (*chromosomes)[chrom_ind].size();
 
     // Sample fragment length:
-    frag_len = static_cast<uint64>(frag_lengths(eng));
-    if (frag_len < frag_len_min) frag_len = frag_len_min;
-    if (frag_len > frag_len_max) frag_len = frag_len_max;
+    frag_len = frag_lengths.sample(eng);
 
     // Sample fragment starting position:
     if (frag_len >= chrom_len) {
@@ -270,7 +343,8 @@ void IlluminaOneGenome<T>::indels_frag(pcg64& eng) {
  This means skipping the chromosome and fragment info parts.
  */
 template <typename T>
-void IlluminaOneGenome<T>::just_indels(pcg64& eng) {
+template <typename E>
+void IlluminaOneGenome<T>::just_indels(E& eng) {
 
     // Sample indels:
     sample_indels(eng);
@@ -282,8 +356,36 @@ void IlluminaOneGenome<T>::just_indels(pcg64& eng) {
 }
 
 
+/*
+ Add where a read came from ("<genome>-<chromosome>-<position>-<R or F>") to a pool.
+ */
 template <typename U>
-void fill_fq_lines(U& fq_pool,
+inline void fill_origin(U& pool,
+                        const std::string& name,
+                        const std::string& chrom_name,
+                        const uint64& start,
+                        const bool& reverse) {
+    for (const char& c : name) pool.push_back(c);
+    pool.push_back('-');
+    for (const char& c : chrom_name) pool.push_back(c);
+    pool.push_back('-');
+    for (const char& c : std::to_string(start)) pool.push_back(c);
+    pool.push_back('-');
+    if (reverse) {
+        pool.push_back('R');
+    } else pool.push_back('F');
+    return;
+}
+
+
+/*
+ Add a read's 4 FASTQ lines to `fastq_pools[i]`.
+ If `short_names` is true, the ID is `read_id` instead of the read's origin, and
+ if `fastq_pools` has an extra pool at the end, a line with the ID and origin
+ (separated by a tab) is added to it.
+ */
+template <typename U>
+void fill_fq_lines(std::vector<U>& fastq_pools,
                    const std::string& name,
                    const std::string& chrom_name,
                    const std::string& read,
@@ -291,20 +393,19 @@ void fill_fq_lines(U& fq_pool,
                    const uint64& i,
                    const uint64& start,
                    const bool& paired,
-                   bool& reverse) {
+                   bool& reverse,
+                   const bool& short_names,
+                   const uint64& read_id) {
+
+    U& fq_pool(fastq_pools[i]);
+    const uint64 n_read_ends = paired ? 2 : 1;
 
     // Combine into 4 lines of output per read:
     // ID line:
     fq_pool.push_back('@');
-    for (const char& c : name) fq_pool.push_back(c);
-    fq_pool.push_back('-');
-    for (const char& c : chrom_name) fq_pool.push_back(c);
-    fq_pool.push_back('-');
-    for (const char& c : std::to_string(start)) fq_pool.push_back(c);
-    fq_pool.push_back('-');
-    if (reverse) {
-        fq_pool.push_back('R');
-    } else fq_pool.push_back('F');
+    if (short_names) {
+        for (const char& c : std::to_string(read_id)) fq_pool.push_back(c);
+    } else fill_origin<U>(fq_pool, name, chrom_name, start, reverse);
     if (paired) {
         fq_pool.push_back('/');
         for (const char& c : std::to_string(i+1)) fq_pool.push_back(c);
@@ -318,6 +419,19 @@ void fill_fq_lines(U& fq_pool,
     for (const char& c : qual) fq_pool.push_back(c);
     fq_pool.push_back('\n');
 
+    // Table of IDs and origins:
+    if (short_names && fastq_pools.size() > n_read_ends) {
+        U& table(fastq_pools.back());
+        for (const char& c : std::to_string(read_id)) table.push_back(c);
+        if (paired) {
+            table.push_back('/');
+            for (const char& c : std::to_string(i+1)) table.push_back(c);
+        }
+        table.push_back('\t');
+        fill_origin<U>(table, name, chrom_name, start, reverse);
+        table.push_back('\n');
+    }
+
     // If doing paired reads, the second one should be the reverse of the first
     reverse = !reverse;
 
@@ -335,12 +449,12 @@ void fill_fq_lines(U& fq_pool,
  That should be done outside this function.
  */
 template <typename T>
-template <typename U>
+template <typename U, typename E>
 void IlluminaOneGenome<T>::append_pools(std::vector<U>& fastq_pools,
-                                         pcg64& eng) {
+                                         E& eng) {
 
     uint64 n_read_ends = ins_probs.size();
-    if (fastq_pools.size() != n_read_ends) fastq_pools.resize(n_read_ends);
+    if (fastq_pools.size() < n_read_ends) fastq_pools.resize(n_read_ends);
 
     const std::string& barcode(constr_info.barcode);
     const std::vector<uint64>& read_chrom_spaces(constr_info.read_chrom_spaces);
@@ -391,15 +505,16 @@ void IlluminaOneGenome<T>::append_pools(std::vector<U>& fastq_pools,
         for (uint64 i = 0; i < barcode.size(); i++) read[i] = barcode[i];
 
         // Sample mapping quality and add errors to read:
-        qual_errors[i].fill_read_qual(read, qual, insertions[i], deletions[i], eng);
+        (*qual_errors)[i].fill_read_qual(read, qual, insertions[i], deletions[i], eng);
 
-        std::string chrom_name = (*chromosomes)[chrom_ind].name;
+        const std::string& chrom_name(chromosomes->chrom_name(chrom_ind));
 
         // Combine into 4 lines of output per read, and add to `fastq_pools[i]`
-        fill_fq_lines<U>(fastq_pools[i], name, chrom_name, read, qual, i, start,
-                         paired, reverse);
+        fill_fq_lines<U>(fastq_pools, name, chrom_name, read, qual, i, start,
+                         paired, reverse, short_names, read_id);
 
     }
+    read_id++;
 
     if (chrom_reads[constr_info.chrom_ind] < n_read_ends) {
         chrom_reads[constr_info.chrom_ind] = 0;
@@ -410,13 +525,13 @@ void IlluminaOneGenome<T>::append_pools(std::vector<U>& fastq_pools,
 
 // Overloaded for when a haplotype chromosome sequence is provided
 template <typename T>
-template <typename U>
+template <typename U, typename E>
 void IlluminaOneGenome<T>::append_pools(const std::string& chrom,
                                         std::vector<U>& fastq_pools,
-                                        pcg64& eng) {
+                                        E& eng) {
 
     uint64 n_read_ends = ins_probs.size();
-    if (fastq_pools.size() != n_read_ends) fastq_pools.resize(n_read_ends);
+    if (fastq_pools.size() < n_read_ends) fastq_pools.resize(n_read_ends);
 
     const std::string& barcode(constr_info.barcode);
     const std::vector<uint64>& read_chrom_spaces(constr_info.read_chrom_spaces);
@@ -468,15 +583,16 @@ void IlluminaOneGenome<T>::append_pools(const std::string& chrom,
         for (uint64 i = 0; i < barcode.size(); i++) read[i] = barcode[i];
 
         // Sample mapping quality and add errors to read:
-        qual_errors[i].fill_read_qual(read, qual, insertions[i], deletions[i], eng);
+        (*qual_errors)[i].fill_read_qual(read, qual, insertions[i], deletions[i], eng);
 
-        std::string chrom_name = (*chromosomes)[chrom_ind].name;
+        const std::string& chrom_name(chromosomes->chrom_name(chrom_ind));
 
         // Combine into 4 lines of output per read, and add to `fastq_pools[i]`
-        fill_fq_lines<U>(fastq_pools[i], name, chrom_name, read, qual, i, start,
-                         paired, reverse);
+        fill_fq_lines<U>(fastq_pools, name, chrom_name, read, qual, i, start,
+                         paired, reverse, short_names, read_id);
 
     }
+    read_id++;
 
     return;
 }
@@ -492,45 +608,37 @@ void IlluminaOneGenome<T>::append_pools(const std::string& chrom,
 
 
 // If only providing rng and id info, sample for a haplotype, then make read(s):
-template <typename U>
+template <typename U, typename E>
 void IlluminaHaplotypes::one_read(std::vector<U>& fastq_pools,
                                 bool& finished,
-                                pcg64& eng) {
+                                E& eng) {
 
-    if (hap == haplotypes->size()) {
+    if (ind == hap_chrom_reads.size()) {
         finished = true;
         return;
     }
 
-    if (n_reads_vc[hap][chr] == 0 || hap_chrom_seq.empty()) {
-
-        uint64 new_hap = hap;
-        uint64 new_chr = chr;
-        for (; new_hap < n_reads_vc.size(); new_hap++) {
-            while (n_reads_vc[new_hap][new_chr] == 0) {
-                new_chr++;
-                if (new_chr == n_reads_vc[new_hap].size()) break;
-            }
-            if (new_chr < n_reads_vc[new_hap].size()) {
-                break;
-            } else new_chr = 0;
-        }
+    if (hap_chrom_reads[ind].n == 0 || hap_chrom_seq.empty()) {
 
-        hap = new_hap;
-        chr = new_chr;
+        while (ind < hap_chrom_reads.size() && hap_chrom_reads[ind].n == 0) ind++;
 
-        if (hap == haplotypes->size())  {
+        if (ind == hap_chrom_reads.size())  {
             finished = true;
             return;
         }
 
-        hap_chrom_seq = (*haplotypes)[hap][chr].get_chrom_full();
+        const ChromReads& cr(hap_chrom_reads[ind]);
+        const HapGenome& hap(*(*haplotypes)[cr.hap]);
+        hap_chrom_seq = hap[cr.chrom].get_chrom_full();
+        read_maker.set_genome(hap, (*names)[cr.hap], (*barcodes)[cr.hap]);
     }
 
-    read_makers[hap].one_read<U>(hap_chrom_seq, chr, fastq_pools, eng);
+    ChromReads& cr(hap_chrom_reads[ind]);
+
+    read_maker.one_read<U>(hap_chrom_seq, cr.chrom, fastq_pools, eng);
 
-    n_reads_vc[hap][chr]--;
-    if (paired && n_reads_vc[hap][chr] > 0) n_reads_vc[hap][chr]--;
+    cr.n--;
+    if (paired && cr.n > 0) cr.n--;
 
     return;
 }
@@ -539,20 +647,22 @@ void IlluminaHaplotypes::one_read(std::vector<U>& fastq_pools,
  `re_read` methods (for duplicates)
  -------------
  */
-template <typename U>
+template <typename U, typename E>
 void IlluminaHaplotypes::re_read(std::vector<U>& fastq_pools,
                                bool& finished,
-                               pcg64& eng) {
+                               E& eng) {
 
-    if (hap == haplotypes->size()) {
+    if (ind == hap_chrom_reads.size()) {
         finished = true;
         return;
     }
 
-    read_makers[hap].re_read<U>(hap_chrom_seq, chr, fastq_pools, eng);
+    ChromReads& cr(hap_chrom_reads[ind]);
+
+    read_maker.re_read<U>(hap_chrom_seq, cr.chrom, fastq_pools, eng);
 
-    if (n_reads_vc[hap][chr] > 0) n_reads_vc[hap][chr]--;
-    if (paired && n_reads_vc[hap][chr] > 0) n_reads_vc[hap][chr]--;
+    if (cr.n > 0) cr.n--;
+    if (paired && cr.n > 0) cr.n--;
 
     return;
 }
@@ -592,11 +702,13 @@ void illumina_ref_cpp(SEXP ref_genome_ptr,
                       const std::string& out_prefix,
                       const int& compress,
                       const std::string& comp_method,
+                      const std::string& rng,
                       const uint64& n_reads,
                       const double& prob_dup,
-                      const uint64& n_threads,
+                      uint64 n_threads,
                       const bool& show_progress,
-                      const uint64& read_pool_size,
+                      uint64 read_pool_size,
+                      const double& max_memory,
                       const double& frag_len_shape,
                       const double& frag_len_scale,
                       const uint64& frag_len_min,
@@ -609,7 +721,10 @@ void illumina_ref_cpp(SEXP ref_genome_ptr,
                       const std::vector<std::vector<std::vector<uint8>>>& quals2,
                       const double& ins_prob2,
                       const double& del_prob2,
-                      const std::vector<std::string>& barcodes) {
+                      const std::vector<std::string>& barcodes,
+                      const bool& bin_quals,
+                      const bool& short_names,
+                      const bool& name_table) {
 
     XPtr<RefGenome> ref_genome(ref_genome_ptr);
 
@@ -634,6 +749,15 @@ void illumina_ref_cpp(SEXP ref_genome_ptr,
                               qual_probs1, quals1, ins_prob1, del_prob1,
                               barcodes[0]);
     }
+    read_filler_base.set_output_mode(bin_quals, short_names, name_table);
+
+    // Fit threads and read pools to memory budget:
+    uint64 read_bytes = mem_usage::fastq_read(read_name_length(*ref_genome),
+                                              qual_probs1[0].size());
+    fit_memory_budget(max_memory,
+                      illumina_sampler_bytes(qual_probs1, qual_probs2),
+                      thread_chrom_bytes(*ref_genome), read_bytes, n_read_ends,
+                      n_threads, read_pool_size);
 
     // For doing multithreaded compression after initial uncompressed run:
     uint64 prog_n = n_reads;
@@ -643,7 +767,7 @@ void illumina_ref_cpp(SEXP ref_genome_ptr,
 
     write_reads_cpp_<IlluminaReference>(
         read_filler_base, out_prefix, n_reads, prob_dup, read_pool_size,
-        n_read_ends, n_threads, compress, comp_method, prog_bar);
+        n_read_ends, n_threads, compress, comp_method, rng, prog_bar);
 
     return;
 }
@@ -653,40 +777,46 @@ void illumina_ref_cpp(SEXP ref_genome_ptr,
 
 
 
-//' Illumina chromosome for reference object.
-//'
-//'
-//' @noRd
-//'
-//[[Rcpp::export]]
-void illumina_hap_cpp(SEXP hap_set_ptr,
-                      const bool& paired,
-                      const bool& matepair,
-                      const std::string& out_prefix,
-                      const bool& sep_files,
-                      const int& compress,
-                      const std::string& comp_method,
-                      const uint64& n_reads,
-                      const double& prob_dup,
-                      const uint64& n_threads,
-                      const bool& show_progress,
-                      const uint64& read_pool_size,
-                      const std::vector<double>& haplotype_probs,
-                      const double& frag_len_shape,
-                      const double& frag_len_scale,
-                      const uint64& frag_len_min,
-                      const uint64& frag_len_max,
-                      const std::vector<std::vector<std::vector<double>>>& qual_probs1,
-                      const std::vector<std::vector<std::vector<uint8>>>& quals1,
-                      const double& ins_prob1,
-                      const double& del_prob1,
-                      const std::vector<std::vector<std::vector<double>>>& qual_probs2,
-                      const std::vector<std::vector<std::vector<uint8>>>& quals2,
-                      const double& ins_prob2,
-                      const double& del_prob2,
-                      const std::vector<std::string>& barcodes) {
+/*
+ Make Illumina reads from one or more `HapSet`s in one pass.
+ If `sample_names` isn't empty, each `HapSet` is a sample in a multiplexed lane:
+ `hap_samples` gives the sample for each haplotype, read IDs are prefixed with
+ sample names, and separate files are per sample instead of per haplotype.
+ */
+void illumina_hap_sets_(const std::vector<const HapSet*>& hap_sets,
+                        const std::vector<std::string>& sample_names,
+                        const std::vector<uint64>& hap_samples,
+                        const bool& paired,
+                        const bool& matepair,
+                        const std::string& out_prefix,
+                        const bool& sep_files,
+                        const int& compress,
+                        const std::string& comp_method,
+                        const std::string& rng,
+                        const uint64& n_reads,
+                        const double& prob_dup,
+                        uint64 n_threads,
+                        const bool& show_progress,
+                        uint64 read_pool_size,
+                        const double& max_memory,
+                        const std::vector<double>& haplotype_probs,
+                        const double& frag_len_shape,
+                        const double& frag_len_scale,
+                        const uint64& frag_len_min,
+                        const uint64& frag_len_max,
+                        const std::vector<std::vector<std::vector<double>>>& qual_probs1,
+                        const std::vector<std::vector<std::vector<uint8>>>& quals1,
+                        const double& ins_prob1,
+                        const double& del_prob1,
+                        const std::vector<std::vector<std::vector<double>>>& qual_probs2,
+                        const std::vector<std::vector<std::vector<uint8>>>& quals2,
+                        const double& ins_prob2,
+                        const double& del_prob2,
+                        const std::vector<std::string>& barcodes,
+                        const bool& bin_quals,
+                        const bool& short_names,
+                        const bool& name_table) {
 
-    XPtr<HapSet> hap_set(hap_set_ptr);
     IlluminaHaplotypes read_filler_base;
 
     uint64 n_read_ends;
@@ -694,7 +824,7 @@ void illumina_hap_cpp(SEXP hap_set_ptr,
     if (paired) {
 
         n_read_ends = 2;
-        read_filler_base = IlluminaHaplotypes(*hap_set, haplotype_probs,
+        read_filler_base = IlluminaHaplotypes(hap_sets, sample_names, haplotype_probs,
                                             matepair,
                                             frag_len_shape, frag_len_scale,
                                             frag_len_min, frag_len_max,
@@ -705,13 +835,29 @@ void illumina_hap_cpp(SEXP hap_set_ptr,
     } else {
 
         n_read_ends = 1;
-        read_filler_base = IlluminaHaplotypes(*hap_set, haplotype_probs,
+        read_filler_base = IlluminaHaplotypes(hap_sets, sample_names, haplotype_probs,
                                             frag_len_shape, frag_len_scale,
                                             frag_len_min, frag_len_max,
                                             qual_probs1, quals1, ins_prob1, del_prob1,
                                             barcodes);
 
     }
+    read_filler_base.set_output_mode(bin_quals, short_names, name_table);
+
+    // Fit threads and read pools to memory budget:
+    uint64 name_length = 0;
+    uint64 chrom_bytes = 0;
+    for (uint64 i = 0; i < hap_sets.size(); i++) {
+        uint64 name_i = read_name_length(*hap_sets[i]);
+        if (!sample_names.empty()) name_i += (sample_names[i].size() + 1);
+        name_length = std::max(name_length, name_i);
+        chrom_bytes = std::max(chrom_bytes, thread_chrom_bytes(*hap_sets[i]));
+    }
+    uint64 read_bytes = mem_usage::fastq_read(name_length, qual_probs1[0].size());
+    fit_memory_budget(max_memory,
+                      illumina_sampler_bytes(qual_probs1, qual_probs2),
+                      chrom_bytes, read_bytes, n_read_ends,
+                      n_threads, read_pool_size);
 
     // For doing multithreaded compression after initial uncompressed run:
     uint64 prog_n = n_reads;
@@ -719,21 +865,152 @@ void illumina_hap_cpp(SEXP hap_set_ptr,
     // Progress bar:
     Progress prog_bar(prog_n, show_progress);
 
-    if (sep_files) {
+    if (sep_files && !sample_names.empty()) {
 
         write_reads_cpp_sep_files_<IlluminaHaplotypes>(
-            *hap_set, haplotype_probs,
+            sample_names, hap_samples, haplotype_probs,
             read_filler_base, out_prefix, n_reads, prob_dup, read_pool_size,
-            n_read_ends, n_threads, compress, comp_method, prog_bar);
+            n_read_ends, n_threads, compress, comp_method, rng, prog_bar);
+
+    } else if (sep_files) {
 
+        write_reads_cpp_sep_files_<IlluminaHaplotypes>(
+            *hap_sets[0], haplotype_probs,
+            read_filler_base, out_prefix, n_reads, prob_dup, read_pool_size,
+            n_read_ends, n_threads, compress, comp_method, rng, prog_bar);
 
     } else {
 
         write_reads_cpp_<IlluminaHaplotypes>(
             read_filler_base, out_prefix, n_reads, prob_dup, read_pool_size,
-            n_read_ends, n_threads, compress, comp_method, prog_bar);
+            n_read_ends, n_threads, compress, comp_method, rng, prog_bar);
+
+    }
+
+    return;
+}
+
+
+
+
+
+//' Illumina chromosome for reference object.
+//'
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+void illumina_hap_cpp(SEXP hap_set_ptr,
+                      const bool& paired,
+                      const bool& matepair,
+                      const std::string& out_prefix,
+                      const bool& sep_files,
+                      const int& compress,
+                      const std::string& comp_method,
+                      const std::string& rng,
+                      const uint64& n_reads,
+                      const double& prob_dup,
+                      uint64 n_threads,
+                      const bool& show_progress,
+                      uint64 read_pool_size,
+                      const double& max_memory,
+                      const std::vector<double>& haplotype_probs,
+                      const double& frag_len_shape,
+                      const double& frag_len_scale,
+                      const uint64& frag_len_min,
+                      const uint64& frag_len_max,
+                      const std::vector<std::vector<std::vector<double>>>& qual_probs1,
+                      const std::vector<std::vector<std::vector<uint8>>>& quals1,
+                      const double& ins_prob1,
+                      const double& del_prob1,
+                      const std::vector<std::vector<std::vector<double>>>& qual_probs2,
+                      const std::vector<std::vector<std::vector<uint8>>>& quals2,
+                      const double& ins_prob2,
+                      const double& del_prob2,
+                      const std::vector<std::string>& barcodes,
+                      const bool& bin_quals,
+                      const bool& short_names,
+                      const bool& name_table) {
+
+    XPtr<HapSet> hap_set(hap_set_ptr);
+
+    illumina_hap_sets_({hap_set.get()}, {}, {}, paired,
+                       matepair, out_prefix, sep_files, compress,
+                       comp_method, rng, n_reads, prob_dup,
+                       n_threads, show_progress, read_pool_size,
+                       max_memory, haplotype_probs, frag_len_shape,
+                       frag_len_scale, frag_len_min, frag_len_max,
+                       qual_probs1, quals1, ins_prob1, del_prob1,
+                       qual_probs2, quals2, ins_prob2, del_prob2,
+                       barcodes, bin_quals, short_names, name_table);
+
+    return;
+}
+
+
+
 
+
+//' Illumina reads for a multiplexed lane of samples, each a set of haplotypes.
+//'
+//' `haplotype_probs` and `barcodes` are per haplotype, for all samples combined.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+void illumina_mux_cpp(const List& hap_set_ptrs,
+                      const std::vector<std::string>& sample_names,
+                      const bool& paired,
+                      const bool& matepair,
+                      const std::string& out_prefix,
+                      const bool& sep_files,
+                      const int& compress,
+                      const std::string& comp_method,
+                      const std::string& rng,
+                      const uint64& n_reads,
+                      const double& prob_dup,
+                      uint64 n_threads,
+                      const bool& show_progress,
+                      uint64 read_pool_size,
+                      const double& max_memory,
+                      const std::vector<double>& haplotype_probs,
+                      const double& frag_len_shape,
+                      const double& frag_len_scale,
+                      const uint64& frag_len_min,
+                      const uint64& frag_len_max,
+                      const std::vector<std::vector<std::vector<double>>>& qual_probs1,
+                      const std::vector<std::vector<std::vector<uint8>>>& quals1,
+                      const double& ins_prob1,
+                      const double& del_prob1,
+                      const std::vector<std::vector<std::vector<double>>>& qual_probs2,
+                      const std::vector<std::vector<std::vector<uint8>>>& quals2,
+                      const double& ins_prob2,
+                      const double& del_prob2,
+                      const std::vector<std::string>& barcodes,
+                      const bool& bin_quals,
+                      const bool& short_names,
+                      const bool& name_table) {
+
+    std::vector<const HapSet*> hap_sets;
+    std::vector<uint64> hap_samples;
+    for (uint64 i = 0; i < static_cast<uint64>(hap_set_ptrs.size()); i++) {
+        XPtr<HapSet> hap_set(static_cast<SEXP>(hap_set_ptrs[i]));
+        hap_sets.push_back(hap_set.get());
+        hap_samples.resize(hap_samples.size() + hap_set->size(), i);
     }
+    if (sample_names.size() != hap_sets.size()) {
+        stop("\nThere should be one sample name per set of haplotypes.");
+    }
+
+    illumina_hap_sets_(hap_sets, sample_names, hap_samples, paired,
+                       matepair, out_prefix, sep_files, compress,
+                       comp_method, rng, n_reads, prob_dup,
+                       n_threads, show_progress, read_pool_size,
+                       max_memory, haplotype_probs, frag_len_shape,
+                       frag_len_scale, frag_len_min, frag_len_max,
+                       qual_probs1, quals1, ins_prob1, del_prob1,
+                       qual_probs2, quals2, ins_prob2, del_prob2,
+                       barcodes, bin_quals, short_names, name_table);
 
     return;
 }
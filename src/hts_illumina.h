@@ -10,6 +10,7 @@
 #include <pcg/pcg_random.hpp> // pcg prng
 #include <random>  // distributions
 #include <fstream> // for writing FASTQ files
+#include <memory>  // shared_ptr
 #include "zlib.h"  // for writing to compressed FASTQ
 #ifdef _OPENMP
 #include <omp.h>  // omp
@@ -81,6 +82,25 @@ struct IlluminaReadConstrInfo {
           frag_len(other.frag_len), frag_start(other.frag_start),
           reads(other.reads), quals(other.quals),
           read_chrom_spaces(other.read_chrom_spaces), barcode(other.barcode) {};
+    IlluminaReadConstrInfo& operator=(const IlluminaReadConstrInfo& other) = default;
+    IlluminaReadConstrInfo(IlluminaReadConstrInfo&& other) noexcept
+        : read_length(other.read_length),
+          chrom_ind(other.chrom_ind), frag_len(other.frag_len),
+          frag_start(other.frag_start), reads(std::move(other.reads)),
+          quals(std::move(other.quals)),
+          read_chrom_spaces(std::move(other.read_chrom_spaces)),
+          barcode(std::move(other.barcode)) {}
+    IlluminaReadConstrInfo& operator=(IlluminaReadConstrInfo&& other) noexcept {
+        read_length = other.read_length;
+        chrom_ind = other.chrom_ind;
+        frag_len = other.frag_len;
+        frag_start = other.frag_start;
+        reads = std::move(other.reads);
+        quals = std::move(other.quals);
+        read_chrom_spaces = std::move(other.read_chrom_spaces);
+        barcode = std::move(other.barcode);
+        return *this;
+    }
 };
 
 
@@ -123,10 +143,20 @@ public:
         read_length = other.read_length;
         return *this;
     }
+    IllQualPos(IllQualPos&& other) noexcept
+        : samplers(std::move(other.samplers)), quals(std::move(other.quals)),
+          read_length(other.read_length) {}
+    IllQualPos& operator=(IllQualPos&& other) noexcept {
+        samplers = std::move(other.samplers);
+        quals = std::move(other.quals);
+        read_length = other.read_length;
+        return *this;
+    }
 
     // Sample for a quality
+    template <typename E>
     uint8 sample(const uint64& pos,
-                 pcg64& eng) const {
+                 E& eng) const {
         uint64 k = samplers[pos].sample(eng);
         return quals[pos][k];
     }
@@ -154,7 +184,8 @@ public:
     IlluminaQualityError(const std::vector<std::vector<std::vector<double>>>& probs_,
                          const std::vector<std::vector<std::vector<uint8>>>& quals_)
         : by_nt(),
-          qual_prob_map() {
+          qual_prob_map(),
+          qual_chars(256) {
 
         uint64 read_length(probs_[0].size());
 
@@ -186,11 +217,50 @@ public:
             qual_prob_map.push_back(prob);
         }
 
+        for (uint64 q = 0; q < qual_chars.size(); q++) {
+            qual_chars[q] = static_cast<char>(q + qual_start);
+        }
+
     }
 
     IlluminaQualityError(const IlluminaQualityError& other)
         : by_nt(other.by_nt),
-          qual_prob_map(other.qual_prob_map) {};
+          qual_prob_map(other.qual_prob_map),
+          qual_chars(other.qual_chars) {};
+    IlluminaQualityError& operator=(const IlluminaQualityError& other) = default;
+    IlluminaQualityError(IlluminaQualityError&& other) noexcept
+        : by_nt(std::move(other.by_nt)),
+          qual_prob_map(std::move(other.qual_prob_map)),
+          qual_chars(std::move(other.qual_chars)) {}
+    IlluminaQualityError& operator=(IlluminaQualityError&& other) noexcept {
+        by_nt = std::move(other.by_nt);
+        qual_prob_map = std::move(other.qual_prob_map);
+        qual_chars = std::move(other.qual_chars);
+        return *this;
+    }
+
+
+    /*
+     Use qualities in four bins like NovaSeq instruments do
+     (0-2 to 2, 3-14 to 12, 15-30 to 23, and 31+ to 37).
+     Sampled qualities are binned before their mismatch probabilities are looked up,
+     so the errors in reads match the qualities written for them.
+     */
+    void bin_quals() {
+        auto bin = [](const uint64& q) -> uint64 {
+            if (q <= 2) return 2;
+            if (q <= 14) return 12;
+            if (q <= 30) return 23;
+            return 37;
+        };
+        for (uint64 q = 0; q < qual_chars.size(); q++) {
+            qual_chars[q] = static_cast<char>(bin(q) + qual_start);
+        }
+        for (uint64 q = 0; q < qual_prob_map.size(); q++) {
+            qual_prob_map[q] = std::pow(10, static_cast<double>(bin(q)) / -10.0);
+        }
+        return;
+    }
 
 
     /*
@@ -199,11 +269,12 @@ public:
      I'm requiring it as input to this function.
      `read` should already be sized appropriately before this function.
      */
+    template <typename E>
     void fill_read_qual(std::string& read,
                         std::string& qual,
-                        std::deque<uint64>& insertions,
-                        std::deque<uint64>& deletions,
-                        pcg64& eng) const {
+                        const std::vector<uint64>& insertions,
+                        const std::vector<uint64>& deletions,
+                        E& eng) const {
 
         double mis_prob, u;
         uint8 nt_ind, qint;
@@ -211,14 +282,17 @@ public:
          Add indels:
          */
         uint64 chrom_pos = read.size() - 1ULL;
-        while (!insertions.empty() || !deletions.empty()) {
-            if (!insertions.empty() && chrom_pos == insertions.back()) {
+        // (Going backward, so these are one past the next indel to add)
+        uint64 ins_i = insertions.size();
+        uint64 del_i = deletions.size();
+        while (ins_i > 0 || del_i > 0) {
+            if (ins_i > 0 && chrom_pos == insertions[ins_i-1]) {
                 char c = jlp::bases[static_cast<uint64>(runif_01(eng) * 4.0)];
                 read.insert(chrom_pos + 1, 1, c);
-                insertions.pop_back();
-            } else if (!deletions.empty() && chrom_pos == deletions.back()) {
+                ins_i--;
+            } else if (del_i > 0 && chrom_pos == deletions[del_i-1]) {
                 read.erase(chrom_pos, 1);
-                deletions.pop_back();
+                del_i--;
             }
             if (chrom_pos == 0) break;
             chrom_pos--;
@@ -235,8 +309,8 @@ public:
              than 10. This is what ART does.
              */
             if (nt_ind > 3) {
-                qint = runif_01(eng) * 10 + qual_start;
-                qual[pos] = static_cast<char>(qint);
+                qint = runif_01(eng) * 10;
+                qual[pos] = qual_chars[qint];
                 nt = 'N';
                 continue;
             }
@@ -246,8 +320,7 @@ public:
              */
             qint = by_nt[nt_ind].sample(pos, eng);
             mis_prob = qual_prob_map[qint];
-            qint += qual_start;
-            qual[pos] = static_cast<char>(qint);
+            qual[pos] = qual_chars[qint];
             u = runif_01(eng);
             if (u < mis_prob) {
                 const std::string& mm_str(mm_nucleos[nt_ind]);
@@ -273,6 +346,8 @@ private:
      (e.g., 0 to '!'))
      */
     uint8 qual_start = static_cast<uint8>('!');
+    // Maps quality integer to the character written for it:
+    std::vector<char> qual_chars;
 
 };
 
@@ -282,6 +357,58 @@ private:
 
 
 
+/*
+ Bytes used by the quality samplers made from these profile probabilities
+ (probability and alias per quality in each `AliasSampler`, plus the quality itself).
+ For single-end reads, `qual_probs2` should be empty or have empty inner vectors.
+ */
+inline uint64 illumina_sampler_bytes(
+        const std::vector<std::vector<std::vector<double>>>& qual_probs1,
+        const std::vector<std::vector<std::vector<double>>>& qual_probs2) {
+    uint64 n_quals = 0;
+    for (const auto* qp : {&qual_probs1, &qual_probs2}) {
+        for (const std::vector<std::vector<double>>& by_pos : *qp) {
+            for (const std::vector<double>& probs : by_pos) n_quals += probs.size();
+        }
+    }
+    return n_quals * (sizeof(double) + sizeof(uint64) + sizeof(uint8));
+}
+
+
+
+
+/*
+ Samples fragment lengths from a gamma distribution, rounded down and then kept
+ between `min_len` and `max_len` (lengths outside those become the nearest bound).
+ The probability of each length is tabulated at construction, so most lengths take
+ one alias draw. Lengths in the far upper tail aren't in the table; they're rare
+ and drawn by inverting the gamma distribution's upper tail.
+ */
+class IlluminaFragLenSampler {
+public:
+    IlluminaFragLenSampler()
+        : table(), shape(1), scale(1), max_len(0), tail_start(0), tail_prob(0) {};
+    IlluminaFragLenSampler(const double& shape_,
+                           const double& scale_,
+                           const uint64& min_len,
+                           const uint64& max_len_);
+
+    template <typename E>
+    uint64 sample(E& eng) const;
+
+private:
+    // Doesn't change after construction, so copies all point to the same one:
+    std::shared_ptr<const LengthSampler> table;
+    double shape;
+    double scale;
+    uint64 max_len;
+    uint64 tail_start;      // first length not in `table`
+    double tail_prob;       // probability of lengths >= `tail_start`
+};
+
+
+
+
 /*
  Template class to combine everything for Illumina sequencing of a single genome.
  (We will need multiple of these objects to chromosome a `HapSet` class.
@@ -295,15 +422,18 @@ class IlluminaOneGenome {
 public:
 
     /* __ Samplers __ */
-    // Samples Illumina qualities and errors, one `IlluminaQualityError` for each read
-    std::vector<IlluminaQualityError> qual_errors;
+    /*
+     Samples Illumina qualities and errors, one `IlluminaQualityError` for each read.
+     These don't change after construction, so copies (i.e., one per thread and
+     haplotype) all point to the same ones.
+     */
+    std::shared_ptr<const std::vector<IlluminaQualityError>> qual_errors;
     // Samples fragment lengths:
-    std::gamma_distribution<double> frag_lengths;   // fragment lengths
+    IlluminaFragLenSampler frag_lengths;
 
 
     /* __ Info __ */
     std::vector<uint64> chrom_reads;    // # reads per chromosome
-    std::vector<uint64> chrom_lengths;  // genome-chromosome lengths
     const T* chromosomes;               // pointer to `const T`
     uint64 read_length;                 // Length of reads
     bool paired;                        // Boolean for whether to do paired-end reads
@@ -311,6 +441,9 @@ public:
     std::vector<double> ins_probs;      // Per-base prob. of an insertion, reads 1 and 2
     std::vector<double> del_probs;      // Per-base prob. of a deletion, reads 1 and 2
     std::string name;
+    bool short_names;                   // Whether read IDs are just numbers
+    bool name_table;                    // Whether to write a table of numeric IDs
+    uint64 read_id;                     // Next numeric read ID
 
     IlluminaOneGenome() : chromosomes(nullptr) {};
     // For paired-end reads:
@@ -330,9 +463,8 @@ public:
                       const double& del_prob2,
                       const std::string& barcode)
         : qual_errors(),
-          frag_lengths(frag_len_shape, frag_len_scale),
+          frag_lengths(frag_len_shape, frag_len_scale, frag_len_min_, frag_len_max_),
           chrom_reads(),
-          chrom_lengths(chrom_object.chrom_sizes()),
           chromosomes(&chrom_object),
           read_length(qual_probs1[0].size()),
           paired(true),
@@ -340,18 +472,21 @@ public:
           ins_probs(2),
           del_probs(2),
           name(chrom_object.name),
+          short_names(false),
+          name_table(false),
+          read_id(0),
           insertions(2),
           deletions(2),
-          frag_len_min(frag_len_min_),
-          frag_len_max(frag_len_max_),
           constr_info(paired, read_length, barcode) {
               if (qual_probs1[0].size() != qual_probs2[0].size()) {
                   std::string err = "In IlluminaOneGenome constr., read lengths for ";
                   err += "R1 and R2 don't match.";
                   stop(err.c_str());
               }
-              qual_errors = {IlluminaQualityError(qual_probs1, quals1),
-                                   IlluminaQualityError(qual_probs2, quals2)};
+              qual_errors = std::make_shared<std::vector<IlluminaQualityError>>(
+                  std::vector<IlluminaQualityError>{
+                      IlluminaQualityError(qual_probs1, quals1),
+                      IlluminaQualityError(qual_probs2, quals2)});
               ins_probs[0] = ins_prob1;
               ins_probs[1] = ins_prob2;
               del_probs[0] = del_prob1;
@@ -368,10 +503,11 @@ public:
                       const double& ins_prob,
                       const double& del_prob,
                       const std::string& barcode)
-        : qual_errors{IlluminaQualityError(qual_probs, quals)},
-          frag_lengths(frag_len_shape, frag_len_scale),
+        : qual_errors(std::make_shared<std::vector<IlluminaQualityError>>(
+              std::vector<IlluminaQualityError>{
+                  IlluminaQualityError(qual_probs, quals)})),
+          frag_lengths(frag_len_shape, frag_len_scale, frag_len_min_, frag_len_max_),
           chrom_reads(),
-          chrom_lengths(chrom_object.chrom_sizes()),
           chromosomes(&chrom_object),
           read_length(qual_probs[0].size()),
           paired(false),
@@ -379,10 +515,11 @@ public:
           ins_probs(1),
           del_probs(1),
           name(chrom_object.name),
+          short_names(false),
+          name_table(false),
+          read_id(0),
           insertions(1),
           deletions(1),
-          frag_len_min(frag_len_min_),
-          frag_len_max(frag_len_max_),
           constr_info(paired, read_length, barcode) {
               ins_probs[0] = ins_prob;
               del_probs[0] = del_prob;
@@ -392,7 +529,6 @@ public:
         : qual_errors(other.qual_errors),
           frag_lengths(other.frag_lengths),
           chrom_reads(other.chrom_reads),
-          chrom_lengths(other.chrom_lengths),
           chromosomes(other.chromosomes),
           read_length(other.read_length),
           paired(other.paired),
@@ -400,15 +536,50 @@ public:
           ins_probs(other.ins_probs),
           del_probs(other.del_probs),
           name(other.name),
+          short_names(other.short_names),
+          name_table(other.name_table),
+          read_id(other.read_id),
           insertions(other.insertions),
           deletions(other.deletions),
-          frag_len_min(other.frag_len_min),
-          frag_len_max(other.frag_len_max),
           constr_info(other.constr_info) {};
+    IlluminaOneGenome& operator=(const IlluminaOneGenome& other) = default;
+    IlluminaOneGenome(IlluminaOneGenome&& other) noexcept
+        : qual_errors(std::move(other.qual_errors)),
+          frag_lengths(std::move(other.frag_lengths)),
+          chrom_reads(std::move(other.chrom_reads)),
+          chromosomes(other.chromosomes),
+          read_length(other.read_length), paired(other.paired),
+          matepair(other.matepair), ins_probs(std::move(other.ins_probs)),
+          del_probs(std::move(other.del_probs)), name(std::move(other.name)),
+          short_names(other.short_names), name_table(other.name_table),
+          read_id(other.read_id),
+          insertions(std::move(other.insertions)),
+          deletions(std::move(other.deletions)),
+          constr_info(std::move(other.constr_info)) {}
+    IlluminaOneGenome& operator=(IlluminaOneGenome&& other) noexcept {
+        qual_errors = std::move(other.qual_errors);
+        frag_lengths = std::move(other.frag_lengths);
+        chrom_reads = std::move(other.chrom_reads);
+        chromosomes = other.chromosomes;
+        read_length = other.read_length;
+        paired = other.paired;
+        matepair = other.matepair;
+        ins_probs = std::move(other.ins_probs);
+        del_probs = std::move(other.del_probs);
+        name = std::move(other.name);
+        short_names = other.short_names;
+        name_table = other.name_table;
+        read_id = other.read_id;
+        insertions = std::move(other.insertions);
+        deletions = std::move(other.deletions);
+        constr_info = std::move(other.constr_info);
+        return *this;
+    }
 
 
     void add_n_reads(uint64 n_reads) {
 
+        std::vector<uint64> chrom_lengths = chromosomes->chrom_sizes();
         std::vector<double> probs_(chrom_lengths.begin(), chrom_lengths.end());
         if (paired) n_reads /= 2; // now it's pairs of reads
         chrom_reads = reads_per_group(n_reads, probs_);
@@ -418,42 +589,87 @@ public:
     }
 
 
+    /*
+     Compact output: write qualities in bins (see `IlluminaQualityError::bin_quals`)
+     and/or give reads numeric IDs instead of ones saying where they came from.
+     With `name_table_`, each numeric ID and its read's origin also go to an extra
+     pool after the FASTQ ones, to be written to a table.
+     */
+    void set_output_mode(const bool& bin_quals,
+                         const bool& short_names_,
+                         const bool& name_table_) {
+        if (bin_quals && qual_errors) {
+            std::vector<IlluminaQualityError> qe(*qual_errors);
+            for (IlluminaQualityError& q : qe) q.bin_quals();
+            qual_errors = std::make_shared<std::vector<IlluminaQualityError>>(qe);
+        }
+        short_names = short_names_;
+        name_table = short_names_ && name_table_;
+        return;
+    }
+    // Number of pools this adds to `fastq_pools` beyond one per read end:
+    inline uint64 n_extra_pools() const {
+        return name_table ? 1ULL : 0ULL;
+    }
+    // Set numeric ID for the next read (so that each thread's are unique):
+    void set_first_id(const uint64& id) {
+        read_id = id;
+        return;
+    }
+
+
+    /*
+     Switch to making reads from a different genome (with its own name in read IDs
+     and its own barcode), keeping the same samplers.
+     */
+    void set_genome(const T& chrom_object,
+                    const std::string& name_,
+                    const std::string& barcode) {
+        chromosomes = &chrom_object;
+        name = name_;
+        constr_info.barcode = barcode;
+        return;
+    }
+
+
     // Sample one set of read strings (each with 4 lines: ID, chromosome, "+", quality)
     // `U` should be a std::string or std::vector<char>
-    template <typename U>
-    void one_read(std::vector<U>& fastq_pools, bool& finished, pcg64& eng);
+    template <typename U, typename E>
+    void one_read(std::vector<U>& fastq_pools, bool& finished, E& eng);
     // Overloaded for when we input a haplotype chromosome stored as string
-    template <typename U>
+    template <typename U, typename E>
     void one_read(const std::string& chrom, const uint64& chrom_i,
-                  std::vector<U>& fastq_pools, pcg64& eng);
+                  std::vector<U>& fastq_pools, E& eng);
 
     /*
      Same as above, but for a duplicate. It's assumed that `one_read` has been
      run once before.
      */
-    template <typename U>
-    void re_read(std::vector<U>& fastq_pools, bool& finished, pcg64& eng);
-    template <typename U>
+    template <typename U, typename E>
+    void re_read(std::vector<U>& fastq_pools, bool& finished, E& eng);
+    template <typename U, typename E>
     void re_read(const std::string& chrom, const uint64& chrom_i,
-                 std::vector<U>& fastq_pools, pcg64& eng);
+                 std::vector<U>& fastq_pools, E& eng);
 
 
 
 
 protected:
 
-    // To store indel locations, where each vector will be of length 2 if paired==true
-    std::vector<std::deque<uint64>> insertions;
-    std::vector<std::deque<uint64>> deletions;
-    // Bounds for fragment sizes:
-    uint64 frag_len_min;
-    uint64 frag_len_max;
+    /*
+     To store indel locations, where each vector will be of length 2 if paired==true.
+     They're cleared rather than re-made for each read, so after the first few reads
+     they have enough capacity and making reads doesn't allocate.
+     */
+    std::vector<std::vector<uint64>> insertions;
+    std::vector<std::vector<uint64>> deletions;
     // Info to construct reads:
     IlluminaReadConstrInfo constr_info;
 
 
     // Sample for insertion and deletion positions
-    void sample_indels(pcg64& eng);
+    template <typename E>
+    void sample_indels(E& eng);
 
     // Adjust chromosome spaces
     void adjust_chrom_spaces();
@@ -463,7 +679,8 @@ protected:
      Sample a chromosome, indels, fragment length, and starting position for the fragment.
      Lastly, it sets the chromosome spaces required for these reads.
      */
-    void chrom_indels_frag(pcg64& eng);
+    template <typename E>
+    void chrom_indels_frag(E& eng);
 
 
     /*
@@ -471,14 +688,16 @@ protected:
      Lastly, it sets the chromosome spaces required for these reads.
      This is for when the chromosome is already set.
      */
-    void indels_frag(pcg64& eng);
+    template <typename E>
+    void indels_frag(E& eng);
 
 
     /*
      Same as `chrom_indels_frag`, but for duplicates.
      This means skipping the chromosome and fragment info parts.
      */
-    void just_indels(pcg64& eng);
+    template <typename E>
+    void just_indels(E& eng);
 
 
 
@@ -488,10 +707,10 @@ protected:
      This function does NOT do anything with fragments.
      That should be done outside this function.
      */
-    template <typename U>
-    void append_pools(std::vector<U>& fastq_pools, pcg64& eng);
-    template <typename U>
-    void append_pools(const std::string& chrom, std::vector<U>& fastq_pools, pcg64& eng);
+    template <typename U, typename E>
+    void append_pools(std::vector<U>& fastq_pools, E& eng);
+    template <typename U, typename E>
+    void append_pools(const std::string& chrom, std::vector<U>& fastq_pools, E& eng);
 
 
 };
@@ -505,24 +724,38 @@ typedef IlluminaOneGenome<HapGenome> IlluminaOneHaplotype;
 /*
  To process a `HapSet` object, I need to wrap IlluminaOneHaplotype inside
  another class.
+
+ It can also make reads from multiple `HapSet`s at once (e.g., the samples in a
+ multiplexed lane), in which case their haplotypes are combined in order and
+ `sample_names` gives a name for each set. Haplotype names in read IDs are then
+ prefixed with their sample's name.
+
+ Copies of this class (one per thread) share everything that doesn't change while
+ making reads: the samplers inside `read_maker` and the per-haplotype pointers,
+ names, and `barcodes`.
+ Each copy only has one `IlluminaOneHaplotype` that's pointed to whichever
+ haplotype it's currently making reads from, so copying doesn't scale with
+ the number of haplotypes.
  */
 class IlluminaHaplotypes {
 
 public:
 
-    const HapSet* haplotypes;                         // pointer to `const HapSet`
-    std::vector<std::vector<uint64>> n_reads_vc;    // # reads per haplotype and chromosome
-    std::vector<IlluminaOneHaplotype> read_makers;    // makes Illumina reads
+    // Pointers to haplotypes from all `HapSet`s:
+    std::shared_ptr<const std::vector<const HapGenome*>> haplotypes;
+    std::vector<ChromReads> hap_chrom_reads;        // # reads per haplotype & chromosome
+    IlluminaOneHaplotype read_maker;                // makes Illumina reads
     bool paired;                                    // Boolean for paired-end reads
     std::vector<double> hap_probs;                  // probs of sampling haplotypes
 
 
-    IlluminaHaplotypes() : haplotypes(nullptr) {}
+    IlluminaHaplotypes() : haplotypes() {}
 
     /* Initializers */
 
     // For paired-end reads:
-    IlluminaHaplotypes(const HapSet& hap_set,
+    IlluminaHaplotypes(const std::vector<const HapSet*>& hap_sets,
+                     const std::vector<std::string>& sample_names,
                      const std::vector<double>& haplotype_probs,
                      const bool& matepair_,
                      const double& frag_len_shape,
@@ -537,39 +770,32 @@ public:
                      const std::vector<std::vector<std::vector<uint8>>>& quals2,
                      const double& ins_prob2,
                      const double& del_prob2,
-                     std::vector<std::string> barcodes)
-        : haplotypes(&hap_set),
-          n_reads_vc(),
-          read_makers(),
+                     std::vector<std::string> barcodes_)
+        : haplotypes(),
+          hap_chrom_reads(),
+          read_maker(),
           paired(true),
           hap_probs(haplotype_probs),
-          hap(0),
-          chr(0),
-          hap_chrom_seq() {
+          ind(0),
+          hap_chrom_seq(),
+          names(),
+          barcodes() {
 
-        if (barcodes.size() < hap_set.size()) barcodes.resize(hap_set.size(), "");
-
-        uint64 n_haps = haplotypes->size();
+        set_haplotypes(hap_sets, sample_names, barcodes_);
 
-        /*
-         Fill `read_makers` field:
-         */
-        read_makers.reserve(n_haps);
-        for (uint64 i = 0; i < n_haps; i++) {
-            read_makers.push_back(
-                IlluminaOneHaplotype(hap_set[i], matepair_,
-                                   frag_len_shape, frag_len_scale,
-                                   frag_len_min_, frag_len_max_,
-                                   qual_probs1, quals1, ins_prob1, del_prob1,
-                                   qual_probs2, quals2, ins_prob2, del_prob2,
-                                   barcodes[i])
-            );
-        }
+        if (haplotypes->empty()) return;
+        read_maker = IlluminaOneHaplotype(*haplotypes->front(), matepair_,
+                                          frag_len_shape, frag_len_scale,
+                                          frag_len_min_, frag_len_max_,
+                                          qual_probs1, quals1, ins_prob1, del_prob1,
+                                          qual_probs2, quals2, ins_prob2, del_prob2,
+                                          barcodes_[0]);
 
     };
 
     // Single-end reads
-    IlluminaHaplotypes(const HapSet& hap_set,
+    IlluminaHaplotypes(const std::vector<const HapSet*>& hap_sets,
+                     const std::vector<std::string>& sample_names,
                      const std::vector<double>& haplotype_probs,
                      const double& frag_len_shape,
                      const double& frag_len_scale,
@@ -579,41 +805,54 @@ public:
                      const std::vector<std::vector<std::vector<uint8>>>& quals,
                      const double& ins_prob,
                      const double& del_prob,
-                     std::vector<std::string> barcodes)
-        : haplotypes(&hap_set),
-          n_reads_vc(),
-          read_makers(),
+                     std::vector<std::string> barcodes_)
+        : haplotypes(),
+          hap_chrom_reads(),
+          read_maker(),
           paired(false),
           hap_probs(haplotype_probs),
-          hap(0),
-          chr(0),
-          hap_chrom_seq() {
+          ind(0),
+          hap_chrom_seq(),
+          names(),
+          barcodes() {
 
-        if (barcodes.size() < hap_set.size()) barcodes.resize(hap_set.size(), "");
+        set_haplotypes(hap_sets, sample_names, barcodes_);
 
-        uint64 n_haps = hap_set.size();
-
-        /*
-         Fill `read_makers` field:
-         */
-        read_makers.reserve(n_haps);
-        for (uint64 i = 0; i < n_haps; i++) {
-            read_makers.push_back(
-                IlluminaOneHaplotype(hap_set[i],
-                                   frag_len_shape, frag_len_scale,
-                                   frag_len_min_, frag_len_max_,
-                                   qual_probs, quals, ins_prob, del_prob,
-                                   barcodes[i])
-            );
-        }
+        if (haplotypes->empty()) return;
+        read_maker = IlluminaOneHaplotype(*haplotypes->front(),
+                                          frag_len_shape, frag_len_scale,
+                                          frag_len_min_, frag_len_max_,
+                                          qual_probs, quals, ins_prob, del_prob,
+                                          barcodes_[0]);
 
     };
 
     IlluminaHaplotypes(const IlluminaHaplotypes& other)
-        : haplotypes(other.haplotypes), n_reads_vc(other.n_reads_vc),
-          read_makers(other.read_makers), paired(other.paired),
+        : haplotypes(other.haplotypes), hap_chrom_reads(other.hap_chrom_reads),
+          read_maker(other.read_maker), paired(other.paired),
           hap_probs(other.hap_probs),
-          hap(other.hap), chr(other.chr), hap_chrom_seq(other.hap_chrom_seq) {};
+          ind(other.ind), hap_chrom_seq(other.hap_chrom_seq),
+          names(other.names), barcodes(other.barcodes) {};
+    IlluminaHaplotypes& operator=(const IlluminaHaplotypes& other) = default;
+    IlluminaHaplotypes(IlluminaHaplotypes&& other) noexcept
+        : haplotypes(std::move(other.haplotypes)),
+          hap_chrom_reads(std::move(other.hap_chrom_reads)),
+          read_maker(std::move(other.read_maker)), paired(other.paired),
+          hap_probs(std::move(other.hap_probs)), ind(other.ind),
+          hap_chrom_seq(std::move(other.hap_chrom_seq)),
+          names(std::move(other.names)), barcodes(std::move(other.barcodes)) {}
+    IlluminaHaplotypes& operator=(IlluminaHaplotypes&& other) noexcept {
+        haplotypes = std::move(other.haplotypes);
+        hap_chrom_reads = std::move(other.hap_chrom_reads);
+        read_maker = std::move(other.read_maker);
+        paired = other.paired;
+        hap_probs = std::move(other.hap_probs);
+        ind = other.ind;
+        hap_chrom_seq = std::move(other.hap_chrom_seq);
+        names = std::move(other.names);
+        barcodes = std::move(other.barcodes);
+        return *this;
+    }
 
 
     // Add info on # reads
@@ -625,21 +864,28 @@ public:
         if (paired) n_reads /= 2; // now it's pairs of reads
         std::vector<uint64> hap_reads = reads_per_group(n_reads, hap_probs);
 
-        // splitting by chromosome, too:
+        // splitting by chromosome, too (`* 2` to go back to # reads):
         for (uint64 v = 0; v < n_haps; v++) {
-            std::vector<double> chrom_probs;
-            for (const HapChrom& vc : (*haplotypes)[v].chromosomes) {
-                chrom_probs.push_back(vc.size());
-            }
-            n_reads_vc.push_back(reads_per_group(hap_reads[v], chrom_probs));
-            if (paired) for (uint64& r : n_reads_vc.back()) r *= 2;  // back to # reads
+            add_chrom_reads(hap_chrom_reads, v, hap_reads[v],
+                            (*haplotypes)[v]->chrom_sizes(), paired ? 2 : 1);
         }
 
-        // Fill `read_makers` field:
-        for (uint64 i = 0; i < n_haps; i++) {
-            read_makers[i].add_n_reads(hap_reads[i]);
-        }
+        return;
+    }
+
 
+    // Compact output (see `IlluminaOneGenome::set_output_mode`):
+    void set_output_mode(const bool& bin_quals,
+                         const bool& short_names,
+                         const bool& name_table) {
+        read_maker.set_output_mode(bin_quals, short_names, name_table);
+        return;
+    }
+    inline uint64 n_extra_pools() const {
+        return read_maker.n_extra_pools();
+    }
+    void set_first_id(const uint64& id) {
+        read_maker.set_first_id(id);
         return;
     }
 
@@ -650,27 +896,50 @@ public:
      -------------
      */
     // If only providing rng and id info, sample for a haplotype, then make read(s):
-    template <typename U>
-    void one_read(std::vector<U>& fastq_pools, bool& finished, pcg64& eng);
+    template <typename U, typename E>
+    void one_read(std::vector<U>& fastq_pools, bool& finished, E& eng);
 
     /*
      -------------
      `re_read` methods (for duplicates)
      -------------
      */
-    template <typename U>
-    void re_read(std::vector<U>& fastq_pools, bool& finished, pcg64& eng);
+    template <typename U, typename E>
+    void re_read(std::vector<U>& fastq_pools, bool& finished, E& eng);
 
 
 
 private:
 
-    // Haplotype to create read from.
-    uint64 hap;
-    // Chromosome to create read from.
-    uint64 chr;
+    // Index to `hap_chrom_reads` for the haplotype and chromosome to create reads from.
+    uint64 ind;
     // String for haplotype chromosome. It's saved to make things faster.
     std::string hap_chrom_seq;
+    // Names (for read IDs) and barcodes for each haplotype (shared among copies):
+    std::shared_ptr<const std::vector<std::string>> names;
+    std::shared_ptr<const std::vector<std::string>> barcodes;
+
+    // Set `haplotypes`, `names`, and `barcodes` from one or more `HapSet`s:
+    void set_haplotypes(const std::vector<const HapSet*>& hap_sets,
+                        const std::vector<std::string>& sample_names,
+                        std::vector<std::string> barcodes_) {
+        std::vector<const HapGenome*> haps;
+        std::vector<std::string> names_;
+        for (uint64 i = 0; i < hap_sets.size(); i++) {
+            const HapSet& hap_set(*hap_sets[i]);
+            for (uint64 j = 0; j < hap_set.size(); j++) {
+                haps.push_back(&hap_set[j]);
+                if (sample_names.empty()) {
+                    names_.push_back(hap_set[j].name);
+                } else names_.push_back(sample_names[i] + '_' + hap_set[j].name);
+            }
+        }
+        if (barcodes_.size() < haps.size()) barcodes_.resize(haps.size(), "");
+        haplotypes = std::make_shared<std::vector<const HapGenome*>>(haps);
+        names = std::make_shared<std::vector<std::string>>(names_);
+        barcodes = std::make_shared<std::vector<std::string>>(barcodes_);
+        return;
+    }
 
 };
 
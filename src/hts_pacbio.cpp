@@ -7,6 +7,8 @@
 #include <pcg/pcg_random.hpp> // pcg prng
 #include <string>  // string class
 #include <random>  // distributions
+#include <numeric>  // accumulate
+#include <algorithm>  // max
 
 
 
@@ -24,22 +26,79 @@
 
 
 
-uint64 PacBioReadLenSampler::sample(pcg64& eng) {
+PacBioReadLenSampler::PacBioReadLenSampler(const double& scale_,
+                                           const double& sigma_,
+                                           const double& loc_,
+                                           const double& min_read_len_)
+    : read_lens(),
+      sampler(),
+      len_table(),
+      use_distr(true),
+      meanlog(std::log(scale_)),
+      sigma(sigma_),
+      loc(loc_),
+      tail_start(),
+      tail_prob(0) {
+
+    double min_ = std::ceil(min_read_len_);
+    if (!(min_ >= 1)) min_ = 1;
+    uint64 min_len = static_cast<uint64>(min_);
+
+    /*
+     Lengths are truncated to be >= `min_len`, so probabilities are relative
+     to `surv_min`.
+     If the minimum is so far in the tail that this is zero, it's the only length.
+     */
+    double surv_min = surv(min_);
+    if (!(surv_min > 0)) {
+        len_table = std::make_shared<LengthSampler>(min_len,
+                                                    std::vector<double>(1, 1.0), 0);
+        tail_start = min_len + 1;
+        return;
+    }
+
+    // Last length in the table:
+    double q = R::qnorm5(LengthSampler::tail_thresh * surv_min, meanlog, sigma, 0, 0);
+    q = loc + std::exp(q);
+    uint64 end = min_len + LengthSampler::max_size - 1;
+    if (q < static_cast<double>(end)) end = std::max(min_len, static_cast<uint64>(q));
+
+    // Length `k` gets P(k <= X < k+1) for `X` being `loc` plus the lognormal variable:
+    std::vector<double> probs(end - min_len + 1);
+    double surv_k = surv_min;
+    for (uint64 k = min_len; k <= end; k++) {
+        double surv_next = surv(static_cast<double>(k + 1));
+        probs[k - min_len] = surv_k - surv_next;
+        surv_k = surv_next;
+    }
+    tail_start = end + 1;
+    tail_prob = surv_k;
+
+    len_table = std::make_shared<LengthSampler>(min_len, probs, tail_prob);
+
+}
+
+
+double PacBioReadLenSampler::surv(const double& x) const {
+    if (x <= loc) return 1;
+    return R::pnorm5(std::log(x - loc), meanlog, sigma, 0, 0);
+}
+
+
+
+template <typename E>
+uint64 PacBioReadLenSampler::sample(E& eng) const {
     uint64 len_;
     if (use_distr) {
-        double rnd = distr(eng) + loc;
-        uint64 iters = 0; // to make sure it doesn't run many times
-        // Rejection sampling to keep it above minimum and not NaN:
-        while (rnd < min_read_len && iters < 10) {
-            rnd = distr(eng) + loc;
-            iters++;
-        }
-        // Give up if it keeps returning craziness:
-        if (rnd < min_read_len) rnd = min_read_len;
-        len_ = static_cast<uint64>(rnd);
+        if (len_table->sample(eng, len_)) return len_;
+        // Inverting the upper tail, conditional on being at least `tail_start`:
+        double u = static_cast<double>(runif_01(eng)) * tail_prob;
+        double x = loc + std::exp(R::qnorm5(u, meanlog, sigma, 0, 0));
+        len_ = tail_start;
+        if (x > static_cast<double>(tail_start)) len_ = static_cast<uint64>(x);
     } else {
-        uint64 ind = sampler.sample(eng);
-        len_ = read_lens[ind];
+        uint64 ind = sampler->sample(eng);
+        len_ = (*read_lens)[ind];
     }
     return len_;
 }
@@ -93,7 +152,8 @@ double PacBioQualityError::calc_min_exp() {
 
 
 
-void PacBioQualityError::update_probs(pcg64& eng,
+template <typename E>
+void PacBioQualityError::update_probs(E& eng,
                                       const double& passes_left,
                                       const double& passes_right) {
 
@@ -132,10 +192,10 @@ void PacBioQualityError::update_probs(pcg64& eng,
 
 
 template <typename T>
-template <typename U>
+template <typename U, typename E>
 void PacBioOneGenome<T>::one_read(std::vector<U>& fastq_pools,
                                   bool& finished,
-                                  pcg64& eng) {
+                                  E& eng) {
 
     U& fastq_pool(fastq_pools[0]);
 
@@ -189,11 +249,11 @@ void PacBioOneGenome<T>::one_read(std::vector<U>& fastq_pools,
 
 // Overloaded for when we input a haplotype chromosome stored as string
 template <typename T>
-template <typename U>
+template <typename U, typename E>
 void PacBioOneGenome<T>::one_read(const std::string& chrom,
                                   const uint64& chrom_i,
                                   std::vector<U>& fastq_pools,
-                                  pcg64& eng) {
+                                  E& eng) {
 
     U& fastq_pool(fastq_pools[0]);
 
@@ -242,10 +302,10 @@ void PacBioOneGenome<T>::one_read(const std::string& chrom,
 
 
 template <typename T>
-template <typename U>
+template <typename U, typename E>
 void PacBioOneGenome<T>::re_read(std::vector<U>& fastq_pools,
                                  bool& finished,
-                                 pcg64& eng) {
+                                 E& eng) {
 
     U& fastq_pool(fastq_pools[0]);
 
@@ -292,11 +352,11 @@ void PacBioOneGenome<T>::re_read(std::vector<U>& fastq_pools,
 
 
 template <typename T>
-template <typename U>
+template <typename U, typename E>
 void PacBioOneGenome<T>::re_read(const std::string& chrom,
                                  const uint64& chrom_i,
                                  std::vector<U>& fastq_pools,
-                                 pcg64& eng) {
+                                 E& eng) {
 
     U& fastq_pool(fastq_pools[0]);
 
@@ -346,8 +406,8 @@ void PacBioOneGenome<T>::re_read(const std::string& chrom,
 
 
 template <typename T>
-template <typename U>
-void PacBioOneGenome<T>::append_pool(U& fastq_pool, pcg64& eng) {
+template <typename U, typename E>
+void PacBioOneGenome<T>::append_pool(U& fastq_pool, E& eng) {
 
     // Make sure it has enough memory reserved:
     fastq_pool.reserve(fastq_pool.size() + read_length * 3 + 10);
@@ -359,7 +419,7 @@ void PacBioOneGenome<T>::append_pool(U& fastq_pool, pcg64& eng) {
     fastq_pool.push_back('@');
     for (const char& c : name) fastq_pool.push_back(c);
     fastq_pool.push_back('-');
-    for (const char& c : (*chromosomes)[chrom_ind].name) fastq_pool.push_back(c);
+    for (const char& c : chromosomes->chrom_name(chrom_ind)) fastq_pool.push_back(c);
     fastq_pool.push_back('-');
     for (const char& c : std::to_string(read_start)) fastq_pool.push_back(c);
     fastq_pool.push_back('-');
@@ -380,19 +440,21 @@ void PacBioOneGenome<T>::append_pool(U& fastq_pool, pcg64& eng) {
     uint64 read_pos = 0;
     uint64 current_length = 0;
     uint64 rndi;
+    // Indices to the next insertion, deletion, and substitution:
+    uint64 ins_i = 0, del_i = 0, sub_i = 0;
     while (current_length < read_length) {
-        if (!insertions.empty() && read_pos == insertions.front()) {
+        if (ins_i < insertions.size() && read_pos == insertions[ins_i]) {
             rndi = static_cast<uint64>(runif_01(eng) * 4);
             fastq_pool.push_back(read[read_pos]);
             fastq_pool.push_back(jlp::bases[rndi]);
-            insertions.pop_front();
+            ins_i++;
             current_length += 2;
-        } else if (!deletions.empty() && read_pos == deletions.front()) {
-            deletions.pop_front();
-        } else if (!substitutions.empty() && read_pos == substitutions.front()) {
+        } else if (del_i < deletions.size() && read_pos == deletions[del_i]) {
+            del_i++;
+        } else if (sub_i < substitutions.size() && read_pos == substitutions[sub_i]) {
             rndi = static_cast<uint64>(runif_01(eng) * 3);
             fastq_pool.push_back(mm_nucleos[nt_map[read[read_pos]]][rndi]);
-            substitutions.pop_front();
+            sub_i++;
             current_length++;
         } else {
             fastq_pool.push_back(read[read_pos]);
@@ -415,10 +477,10 @@ void PacBioOneGenome<T>::append_pool(U& fastq_pool, pcg64& eng) {
 
 
 template <typename T>
-template <typename U>
+template <typename U, typename E>
 void PacBioOneGenome<T>::append_pool(const std::string& chrom,
                                      U& fastq_pool,
-                                     pcg64& eng) {
+                                     E& eng) {
 
     // Make sure it has enough memory reserved:
     fastq_pool.reserve(fastq_pool.size() + read_length * 3 + 10);
@@ -430,7 +492,7 @@ void PacBioOneGenome<T>::append_pool(const std::string& chrom,
     fastq_pool.push_back('@');
     for (const char& c : name) fastq_pool.push_back(c);
     fastq_pool.push_back('-');
-    for (const char& c : (*chromosomes)[chrom_ind].name) fastq_pool.push_back(c);
+    for (const char& c : chromosomes->chrom_name(chrom_ind)) fastq_pool.push_back(c);
     fastq_pool.push_back('-');
     for (const char& c : std::to_string(read_start)) fastq_pool.push_back(c);
     fastq_pool.push_back('-');
@@ -451,19 +513,21 @@ void PacBioOneGenome<T>::append_pool(const std::string& chrom,
     uint64 read_pos = 0;
     uint64 current_length = 0;
     uint64 rndi;
+    // Indices to the next insertion, deletion, and substitution:
+    uint64 ins_i = 0, del_i = 0, sub_i = 0;
     while (current_length < read_length) {
-        if (!insertions.empty() && read_pos == insertions.front()) {
+        if (ins_i < insertions.size() && read_pos == insertions[ins_i]) {
             rndi = static_cast<uint64>(runif_01(eng) * 4);
             fastq_pool.push_back(read[read_pos]);
             fastq_pool.push_back(jlp::bases[rndi]);
-            insertions.pop_front();
+            ins_i++;
             current_length += 2;
-        } else if (!deletions.empty() && read_pos == deletions.front()) {
-            deletions.pop_front();
-        } else if (!substitutions.empty() && read_pos == substitutions.front()) {
+        } else if (del_i < deletions.size() && read_pos == deletions[del_i]) {
+            del_i++;
+        } else if (sub_i < substitutions.size() && read_pos == substitutions[sub_i]) {
             rndi = static_cast<uint64>(runif_01(eng) * 3);
             fastq_pool.push_back(mm_nucleos[nt_map[read[read_pos]]][rndi]);
-            substitutions.pop_front();
+            sub_i++;
             current_length++;
         } else {
             fastq_pool.push_back(read[read_pos]);
@@ -490,43 +554,34 @@ void PacBioOneGenome<T>::append_pool(const std::string& chrom,
 
 
 // `one_read` method
-template <typename U>
-void PacBioHaplotypes::one_read(std::vector<U>& fastq_pools, bool& finished, pcg64& eng) {
+template <typename U, typename E>
+void PacBioHaplotypes::one_read(std::vector<U>& fastq_pools, bool& finished, E& eng) {
 
 
-    if (hap == haplotypes->size()) {
+    if (ind == hap_chrom_reads.size()) {
         finished = true;
         return;
     }
 
-    if (n_reads_vc[hap][chr] == 0 || hap_chrom_seq.empty()) {
-
-        uint64 new_hap = hap;
-        uint64 new_chr = chr;
-        for (; new_hap < n_reads_vc.size(); new_hap++) {
-            while (n_reads_vc[new_hap][new_chr] == 0) {
-                new_chr++;
-                if (new_chr == n_reads_vc[new_hap].size()) break;
-            }
-            if (new_chr < n_reads_vc[new_hap].size()) {
-                break;
-            } else new_chr = 0;
-        }
+    if (hap_chrom_reads[ind].n == 0 || hap_chrom_seq.empty()) {
 
-        hap = new_hap;
-        chr = new_chr;
+        while (ind < hap_chrom_reads.size() && hap_chrom_reads[ind].n == 0) ind++;
 
-        if (hap == haplotypes->size())  {
+        if (ind == hap_chrom_reads.size())  {
             finished = true;
             return;
         }
 
-        hap_chrom_seq = (*haplotypes)[hap][chr].get_chrom_full();
+        const ChromReads& cr(hap_chrom_reads[ind]);
+        hap_chrom_seq = (*haplotypes)[cr.hap][cr.chrom].get_chrom_full();
+        read_maker.set_genome((*haplotypes)[cr.hap]);
     }
 
-    read_makers[hap].one_read<U>(hap_chrom_seq, chr, fastq_pools, eng);
+    ChromReads& cr(hap_chrom_reads[ind]);
+
+    read_maker.one_read<U>(hap_chrom_seq, cr.chrom, fastq_pools, eng);
 
-    n_reads_vc[hap][chr]--;
+    cr.n--;
 
     return;
 
@@ -534,17 +589,19 @@ void PacBioHaplotypes::one_read(std::vector<U>& fastq_pools, bool& finished, pcg
 
 
 // `re_read` method (for duplicates)
-template <typename U>
-void PacBioHaplotypes::re_read(std::vector<U>& fastq_pools, bool& finished, pcg64& eng) {
+template <typename U, typename E>
+void PacBioHaplotypes::re_read(std::vector<U>& fastq_pools, bool& finished, E& eng) {
 
-    if (hap == haplotypes->size()) {
+    if (ind == hap_chrom_reads.size()) {
         finished = true;
         return;
     }
 
-    read_makers[hap].re_read<U>(hap_chrom_seq, chr, fastq_pools, eng);
+    ChromReads& cr(hap_chrom_reads[ind]);
 
-    if (n_reads_vc[hap][chr] > 0) n_reads_vc[hap][chr]--;
+    read_maker.re_read<U>(hap_chrom_seq, cr.chrom, fastq_pools, eng);
+
+    if (cr.n > 0) cr.n--;
 
     return;
 
@@ -570,6 +627,54 @@ void PacBioHaplotypes::re_read(std::vector<U>& fastq_pools, bool& finished, pcg6
 
 
 
+/*
+ Fit threads and read pools to a memory budget for PacBio sequencing.
+ Read lengths come from a lognormal distribution if `read_probs` is empty,
+ otherwise from `read_lens` with weights `read_probs`.
+ */
+template <typename T>
+inline void pacbio_fit_memory(const T& genome_obj,
+                              const double& max_memory,
+                              const double& scale,
+                              const double& sigma,
+                              const double& loc,
+                              const std::vector<double>& read_probs,
+                              const std::vector<uint64>& read_lens,
+                              uint64& n_threads,
+                              uint64& read_pool_size) {
+
+    if (max_memory <= 0) return;
+
+    double mean_len;
+    uint64 shared_bytes = 0;
+    if (read_probs.size() == 0) {
+        mean_len = scale * std::exp(sigma * sigma / 2) + loc;
+    } else {
+        double sum_probs = std::accumulate(read_probs.begin(), read_probs.end(), 0.0);
+        mean_len = 0;
+        for (uint64 i = 0; i < read_probs.size(); i++) {
+            mean_len += read_lens[i] * read_probs[i] / sum_probs;
+        }
+        // Read lengths plus the probability and alias for each:
+        shared_bytes = read_lens.size() *
+            (sizeof(uint64) + sizeof(double) + sizeof(uint64));
+    }
+    if (mean_len < 1) mean_len = 1;
+    uint64 read_length = static_cast<uint64>(std::ceil(mean_len));
+
+    uint64 read_bytes = mem_usage::fastq_read(read_name_length(genome_obj), read_length);
+    // Each thread also stores the current read and its quality:
+    uint64 thread_bytes = thread_chrom_bytes(genome_obj) + 2ULL * read_length;
+
+    fit_memory_budget(max_memory, shared_bytes, thread_bytes, read_bytes, 1,
+                      n_threads, read_pool_size);
+
+    return;
+}
+
+
+
+
 //' PacBio chromosome for reference object.
 //'
 //'
@@ -580,10 +685,12 @@ void pacbio_ref_cpp(SEXP ref_genome_ptr,
                       const std::string& out_prefix,
                       const int& compress,
                       const std::string& comp_method,
+                      const std::string& rng,
                       const uint64& n_reads,
-                      const uint64& n_threads,
+                      uint64 n_threads,
                       const bool& show_progress,
-                      const uint64& read_pool_size,
+                      uint64 read_pool_size,
+                      const double& max_memory,
                       const double& prob_dup,
                       const double& scale,
                       const double& sigma,
@@ -620,6 +727,9 @@ void pacbio_ref_cpp(SEXP ref_genome_ptr,
                             prob_ins, prob_del, prob_subst);
     }
 
+    pacbio_fit_memory<RefGenome>(*ref_genome, max_memory, scale, sigma, loc,
+                                 read_probs, read_lens, n_threads, read_pool_size);
+
     // For doing multithreaded compression after initial uncompressed run:
     uint64 prog_n = n_reads;
     if (compress > 0 && n_threads > 1) prog_n += (n_reads / 2);
@@ -628,7 +738,7 @@ void pacbio_ref_cpp(SEXP ref_genome_ptr,
 
     write_reads_cpp_<PacBioReference>(
         read_filler_base, out_prefix, n_reads, prob_dup, read_pool_size, 1,
-        n_threads, compress, comp_method, prog_bar);
+        n_threads, compress, comp_method, rng, prog_bar);
 
 
     return;
@@ -648,10 +758,12 @@ void pacbio_hap_cpp(SEXP hap_set_ptr,
                     const bool& sep_files,
                     const int& compress,
                     const std::string& comp_method,
+                    const std::string& rng,
                     const uint64& n_reads,
-                    const uint64& n_threads,
+                    uint64 n_threads,
                     const bool& show_progress,
-                    const uint64& read_pool_size,
+                    uint64 read_pool_size,
+                    const double& max_memory,
                     const std::vector<double>& haplotype_probs,
                     const double& prob_dup,
                     const double& scale,
@@ -689,6 +801,9 @@ void pacbio_hap_cpp(SEXP hap_set_ptr,
                            prob_ins, prob_del, prob_subst);
     }
 
+    pacbio_fit_memory<HapSet>(*hap_set, max_memory, scale, sigma, loc,
+                              read_probs, read_lens, n_threads, read_pool_size);
+
     // For doing multithreaded compression after initial uncompressed run:
     uint64 prog_n = n_reads;
     if (compress > 0 && n_threads > 1) prog_n += (n_reads / 2);
@@ -700,13 +815,13 @@ void pacbio_hap_cpp(SEXP hap_set_ptr,
         write_reads_cpp_sep_files_<PacBioHaplotypes>(
             *hap_set, haplotype_probs,
             read_filler_base, out_prefix, n_reads, prob_dup, read_pool_size, 1,
-            n_threads, compress, comp_method, prog_bar);
+            n_threads, compress, comp_method, rng, prog_bar);
 
     } else {
 
         write_reads_cpp_<PacBioHaplotypes>(
             read_filler_base, out_prefix, n_reads, prob_dup, read_pool_size, 1,
-            n_threads, compress, comp_method, prog_bar);
+            n_threads, compress, comp_method, rng, prog_bar);
 
     }
 
@@ -8,11 +8,11 @@
 #include <RcppArmadillo.h>
 #include <cmath>
 #include <vector>  // vector class
-#include <deque>  // deque class
 #include <pcg/pcg_random.hpp> // pcg prng
 #include <string>  // string class
 #include <random>  // distributions
 #include <fstream> // for writing FASTQ files
+#include <memory>  // shared_ptr
 #include "zlib.h"  // for writing to compressed FASTQ
 #ifdef _OPENMP
 #include <omp.h>  // omp
@@ -41,6 +41,12 @@ using namespace Rcpp;
  If providing custom read lengths, make sure that the vector of their
  sampling weights is the same length as the vector of lengths.
 
+ When using a lognormal distribution, lengths are `loc` plus a lognormal variable,
+ rounded down and truncated to be at least `min_read_len`.
+ The probability of each length is tabulated at construction, so most lengths take
+ one alias draw. Lengths in the far upper tail aren't in the table; they're rare
+ and drawn by inverting the lognormal distribution's upper tail.
+
  */
 class PacBioReadLenSampler {
 
@@ -52,24 +58,19 @@ public:
     PacBioReadLenSampler(const double& scale_,
                          const double& sigma_,
                          const double& loc_,
-                         const double& min_read_len_)
-        : read_lens(),
-          sampler(),
-          distr(std::log(scale_), sigma_),
-          use_distr(true),
-          min_read_len(std::ceil(min_read_len_)),
-          loc(loc_) {
-        if (min_read_len < 1) min_read_len = 1;
-    };
+                         const double& min_read_len_);
     // Using a vector of read lengths, each with a sampling probability:
     PacBioReadLenSampler(const std::vector<double>& read_probs_,
                          const std::vector<uint64>& read_lens_)
-        : read_lens(read_lens_),
-          sampler(read_probs_),
-          distr(),
+        : read_lens(std::make_shared<std::vector<uint64>>(read_lens_)),
+          sampler(std::make_shared<AliasSampler>(read_probs_)),
+          len_table(),
           use_distr(false),
-          min_read_len(),
-          loc() {
+          meanlog(),
+          sigma(),
+          loc(),
+          tail_start(),
+          tail_prob() {
         if (read_probs_.size() != read_lens_.size()) {
             stop("Probability and read lengths vector should be the same length.");
         }
@@ -78,31 +79,46 @@ public:
     PacBioReadLenSampler(const PacBioReadLenSampler& other)
         : read_lens(other.read_lens),
           sampler(other.sampler),
-          distr(other.distr),
+          len_table(other.len_table),
           use_distr(other.use_distr),
-          min_read_len(other.min_read_len),
-          loc(other.loc) {};
+          meanlog(other.meanlog),
+          sigma(other.sigma),
+          loc(other.loc),
+          tail_start(other.tail_start),
+          tail_prob(other.tail_prob) {};
     // Assignment operator
-    PacBioReadLenSampler& operator=(const PacBioReadLenSampler& other) {
-        read_lens = other.read_lens;
-        sampler = other.sampler;
-        distr = other.distr;
-        use_distr = other.use_distr;
-        min_read_len = other.min_read_len;
-        loc = other.loc;
-        return *this;
-    }
+    PacBioReadLenSampler& operator=(const PacBioReadLenSampler& other) = default;
+    PacBioReadLenSampler(PacBioReadLenSampler&& other) noexcept
+        : read_lens(std::move(other.read_lens)), sampler(std::move(other.sampler)),
+          len_table(std::move(other.len_table)), use_distr(other.use_distr),
+          meanlog(other.meanlog), sigma(other.sigma), loc(other.loc),
+          tail_start(other.tail_start), tail_prob(other.tail_prob) {}
+    PacBioReadLenSampler& operator=(PacBioReadLenSampler&& other) noexcept = default;
 
-    uint64 sample(pcg64& eng);
+    template <typename E>
+    uint64 sample(E& eng) const;
 
 private:
 
-    std::vector<uint64> read_lens;      // optional vector of possible read lengths
-    AliasSampler sampler;               // optional sampler that chooses from `read_lens`
-    std::lognormal_distribution<double> distr; // optional if using a distribution
-    bool use_distr;                     // Whether to sample using `distr` field
-    double min_read_len;                // Minimum read length
+    /*
+     These don't change after construction, so copies (i.e., one per thread
+     and haplotype) all point to the same ones:
+     */
+    // optional vector of possible read lengths:
+    std::shared_ptr<const std::vector<uint64>> read_lens;
+    // optional sampler that chooses from `read_lens`:
+    std::shared_ptr<const AliasSampler> sampler;
+    // optional table of lengths from the lognormal distribution:
+    std::shared_ptr<const LengthSampler> len_table;
+    bool use_distr;                     // Whether to sample using `len_table`
+    double meanlog;                     // Mean of the log of the lognormal variable
+    double sigma;                       // SD of the log of the lognormal variable
     double loc;                         // Location parameter for lognormal distribution
+    uint64 tail_start;                  // First length not in `len_table`
+    double tail_prob;                   // Probability of lengths >= `tail_start`
+
+    // Probability that `loc` plus the lognormal variable is >= `x`:
+    double surv(const double& x) const;
 
 
 
@@ -144,12 +160,23 @@ public:
         chi2_params_s = other.chi2_params_s;
         return *this;
     }
+    PacBioPassSampler(PacBioPassSampler&& other) noexcept
+        : max_passes(other.max_passes),
+          chi2_params_n(std::move(other.chi2_params_n)),
+          chi2_params_s(std::move(other.chi2_params_s)) {}
+    PacBioPassSampler& operator=(PacBioPassSampler&& other) noexcept {
+        max_passes = other.max_passes;
+        chi2_params_n = std::move(other.chi2_params_n);
+        chi2_params_s = std::move(other.chi2_params_s);
+        return *this;
+    }
 
 
+    template <typename E>
     void sample(uint64& split_pos,
                 double& passes_left,
                 double& passes_right,
-                pcg64& eng,
+                E& eng,
                 const double& read_length) {
 
         double passes, prop_left;
@@ -261,14 +288,31 @@ public:
         min_exp = other.min_exp;
         return *this;
     }
+    PacBioQualityError(PacBioQualityError&& other) noexcept
+        : sqrt_params(std::move(other.sqrt_params)),
+          norm_params(std::move(other.norm_params)),
+          prob_thresh(other.prob_thresh),
+          prob_ins(other.prob_ins), prob_del(other.prob_del),
+          prob_subst(other.prob_subst), min_exp(other.min_exp) {}
+    PacBioQualityError& operator=(PacBioQualityError&& other) noexcept {
+        sqrt_params = std::move(other.sqrt_params);
+        norm_params = std::move(other.norm_params);
+        prob_thresh = other.prob_thresh;
+        prob_ins = other.prob_ins;
+        prob_del = other.prob_del;
+        prob_subst = other.prob_subst;
+        min_exp = other.min_exp;
+        return *this;
+    }
 
 
-    void sample(pcg64& eng,
+    template <typename E>
+    void sample(E& eng,
                 char& qual_left,
                 char& qual_right,
-                std::deque<uint64>& insertions,
-                std::deque<uint64>& deletions,
-                std::deque<uint64>& substitutions,
+                std::vector<uint64>& insertions,
+                std::vector<uint64>& deletions,
+                std::vector<uint64>& substitutions,
                 const uint64& chrom_len,
                 const uint64& read_length,
                 const uint64& split_pos,
@@ -335,8 +379,9 @@ private:
     }
 
     // Normal distribution truncated with lower threshold
+    template <typename E>
     inline double trunc_norm(const double& lower_thresh,
-                             pcg64& eng) {
+                             E& eng) {
         double rnd;
         double a_bar = (lower_thresh - norm_params[0]) / norm_params[1];
 
@@ -382,7 +427,8 @@ private:
     the read: (cum_probs_left, cum_probs_right) with (ins, ins+del, ins+del+subst)."
     */
 
-    void update_probs(pcg64& eng,
+    template <typename E>
+    void update_probs(E& eng,
                       const double& passes_left,
                       const double& passes_right);
 
@@ -432,7 +478,6 @@ public:
 
     /* __ Info __ */
     std::vector<uint64> chrom_reads;      // # reads per chromosome
-    std::vector<uint64> chrom_lengths;    // genome-chromosome lengths
     const T* chromosomes;                 // pointer to `const T`
     std::string name;
 
@@ -458,7 +503,6 @@ public:
           qe_sampler(sqrt_params_, norm_params_, prob_thresh_, prob_ins_,
           prob_del_, prob_subst_),
           chrom_reads(),
-          chrom_lengths(chrom_object.chrom_sizes()),
           chromosomes(&chrom_object),
           name(chrom_object.name) {};
 
@@ -480,7 +524,6 @@ public:
           qe_sampler(sqrt_params_, norm_params_, prob_thresh_, prob_ins_,
           prob_del_, prob_subst_),
           chrom_reads(),
-          chrom_lengths(chrom_object.chrom_sizes()),
           chromosomes(&chrom_object),
           name(chrom_object.name) {};
 
@@ -489,37 +532,64 @@ public:
           pass_sampler(other.pass_sampler),
           qe_sampler(other.qe_sampler),
           chrom_reads(other.chrom_reads),
-          chrom_lengths(other.chrom_lengths),
           chromosomes(other.chromosomes),
           name(other.name) {};
+    PacBioOneGenome& operator=(const PacBioOneGenome& other) = default;
+    PacBioOneGenome(PacBioOneGenome&& other) noexcept
+        : len_sampler(std::move(other.len_sampler)),
+          pass_sampler(std::move(other.pass_sampler)),
+          qe_sampler(std::move(other.qe_sampler)),
+          chrom_reads(std::move(other.chrom_reads)),
+          chromosomes(other.chromosomes), name(std::move(other.name)) {}
+    PacBioOneGenome& operator=(PacBioOneGenome&& other) noexcept {
+        len_sampler = std::move(other.len_sampler);
+        pass_sampler = std::move(other.pass_sampler);
+        qe_sampler = std::move(other.qe_sampler);
+        chrom_reads = std::move(other.chrom_reads);
+        chromosomes = other.chromosomes;
+        name = std::move(other.name);
+        return *this;
+    }
 
 
 
     void add_n_reads(const uint64& n_reads) {
 
+        std::vector<uint64> chrom_lengths = chromosomes->chrom_sizes();
         std::vector<double> probs_(chrom_lengths.begin(), chrom_lengths.end());
         chrom_reads = reads_per_group(n_reads, probs_);
 
         return;
     }
 
+    // PacBio reads always have full IDs, so there's no table of numeric IDs:
+    inline uint64 n_extra_pools() const { return 0; }
+    void set_first_id(const uint64& id) { return; }
+
+    // Switch to making reads from a different genome, keeping the same samplers
+    void set_genome(const T& chrom_object) {
+        chromosomes = &chrom_object;
+        name = chrom_object.name;
+        return;
+    }
+
     // Add one read string (with 4 lines: ID, chromosome, "+", quality) to a FASTQ pool
     // `U` should be a std::string or std::vector<char>
-    template <typename U>
-    void one_read(std::vector<U>& fastq_pools, bool& finished, pcg64& eng);
+    template <typename U, typename E>
+    void one_read(std::vector<U>& fastq_pools, bool& finished, E& eng);
     // Overloaded for when we input a haplotype chromosome stored as string
-    template <typename U>
+    template <typename U, typename E>
     void one_read(const std::string& chrom, const uint64& chrom_i,
-                  std::vector<U>& fastq_pools, pcg64& eng);
+                  std::vector<U>& fastq_pools, E& eng);
     /*
      Same as above, but for a duplicate. It's assumed that `one_read` has been
      run once before.
      */
-    template <typename U>
-    void re_read(std::vector<U>& fastq_pools, bool& finished, pcg64& eng);
-    template <typename U>
+    template <typename U, typename E>
+    void re_read(std::vector<U>& fastq_pools, bool& finished, E& eng);
+    template <typename U, typename E>
     void re_read(const std::string& chrom, const uint64& chrom_i,
-                 std::vector<U>& fastq_pools, pcg64& eng);
+                 std::vector<U>& fastq_pools, E& eng);
 
 
 private:
@@ -538,19 +608,22 @@ private:
     to sample from for a mismatch
     */
     std::vector<std::string> mm_nucleos = sequencer::mm_nucleos;
-    // To store indel locations, where each vector will be of length 2 if paired==true
-    std::deque<uint64> insertions = std::deque<uint64>(0);
-    std::deque<uint64> deletions = std::deque<uint64>(0);
-    std::deque<uint64> substitutions = std::deque<uint64>(0);
+    /*
+     To store error locations on the read, in increasing order.
+     They're cleared rather than re-made for each read, so they keep their capacity.
+     */
+    std::vector<uint64> insertions;
+    std::vector<uint64> deletions;
+    std::vector<uint64> substitutions;
     uint64 chrom_ind = 0;
     uint64 read_length = 0;
     uint64 read_start = 0;
 
     // Append quality and read to fastq pool
-    template <typename U>
-    void append_pool(U& fastq_pool, pcg64& eng);
-    template <typename U>
-    void append_pool(const std::string& chrom, U& fastq_pool, pcg64& eng);
+    template <typename U, typename E>
+    void append_pool(U& fastq_pool, E& eng);
+    template <typename U, typename E>
+    void append_pool(const std::string& chrom, U& fastq_pool, E& eng);
 
 
 };
@@ -565,14 +638,18 @@ typedef PacBioOneGenome<HapGenome> PacBioOneHaplotype;
 /*
  To process a `HapSet` object, I need to wrap PacBioOneHaplotype inside
  another class.
+
+ As for `IlluminaHaplotypes`, copies of this class (one per thread) share the
+ samplers' fixed tables and have one `PacBioOneHaplotype` that's pointed to
+ whichever haplotype it's currently making reads from.
  */
 class PacBioHaplotypes {
 
 public:
 
-    const HapSet* haplotypes;                         // pointer to `const HapSet`
-    std::vector<std::vector<uint64>> n_reads_vc;    // # reads per haplotype and chromosome
-    std::vector<PacBioOneHaplotype> read_makers;      // makes PacBio reads
+    const HapSet* haplotypes;                       // pointer to `const HapSet`
+    std::vector<ChromReads> hap_chrom_reads;        // # reads per haplotype & chromosome
+    PacBioOneHaplotype read_maker;                  // makes PacBio reads
     std::vector<double> hap_probs;                  // probs of sampling haplotypes
 
     /* Initializers */
@@ -594,27 +671,18 @@ public:
                    const double& prob_del_,
                    const double& prob_subst_)
         : haplotypes(&hap_set),
-          n_reads_vc(),
-          read_makers(),
+          hap_chrom_reads(),
+          read_maker(),
           hap_probs(haplotype_probs),
-          hap(0),
-          chr(0),
+          ind(0),
           hap_chrom_seq() {
 
-        /*
-         Fill `read_makers` field:
-         */
-        uint64 n_haps = haplotypes->size();
-        read_makers.reserve(n_haps);
-        for (uint64 i = 0; i < n_haps; i++) {
-            read_makers.push_back(
-                PacBioOneHaplotype(hap_set[i],
-                                 scale_, sigma_, loc_, min_read_len_,
-                                 max_passes_, chi2_params_n_, chi2_params_s_,
-                                 sqrt_params_, norm_params_, prob_thresh_,
-                                 prob_ins_, prob_del_, prob_subst_)
-            );
-        }
+        if (hap_set.size() == 0) return;
+        read_maker = PacBioOneHaplotype(hap_set[0],
+                                        scale_, sigma_, loc_, min_read_len_,
+                                        max_passes_, chi2_params_n_, chi2_params_s_,
+                                        sqrt_params_, norm_params_, prob_thresh_,
+                                        prob_ins_, prob_del_, prob_subst_);
 
     };
     // Using vectors of read lengths and sampling weight for read lengths:
@@ -632,39 +700,45 @@ public:
                    const double& prob_del_,
                    const double& prob_subst_)
         : haplotypes(&hap_set),
-          n_reads_vc(),
-          read_makers(),
+          hap_chrom_reads(),
+          read_maker(),
           hap_probs(haplotype_probs),
-          hap(0),
-          chr(0),
+          ind(0),
           hap_chrom_seq() {
 
-        /*
-         Fill `read_makers` field:
-         */
-        uint64 n_haps = haplotypes->size();
-        read_makers.reserve(n_haps);
-        for (uint64 i = 0; i < n_haps; i++) {
-            read_makers.push_back(
-                PacBioOneHaplotype(hap_set[i],
-                                 read_probs_, read_lens_,
-                                 max_passes_, chi2_params_n_, chi2_params_s_,
-                                 sqrt_params_, norm_params_, prob_thresh_,
-                                 prob_ins_, prob_del_, prob_subst_)
-            );
-        }
+        if (hap_set.size() == 0) return;
+        read_maker = PacBioOneHaplotype(hap_set[0],
+                                        read_probs_, read_lens_,
+                                        max_passes_, chi2_params_n_, chi2_params_s_,
+                                        sqrt_params_, norm_params_, prob_thresh_,
+                                        prob_ins_, prob_del_, prob_subst_);
 
     };
 
     // Copy constructor
     PacBioHaplotypes(const PacBioHaplotypes& other)
         : haplotypes(other.haplotypes),
-          n_reads_vc(other.n_reads_vc),
-          read_makers(other.read_makers),
+          hap_chrom_reads(other.hap_chrom_reads),
+          read_maker(other.read_maker),
           hap_probs(other.hap_probs),
-          hap(other.hap),
-          chr(other.chr),
+          ind(other.ind),
           hap_chrom_seq(other.hap_chrom_seq) {};
+    PacBioHaplotypes& operator=(const PacBioHaplotypes& other) = default;
+    PacBioHaplotypes(PacBioHaplotypes&& other) noexcept
+        : haplotypes(other.haplotypes),
+          hap_chrom_reads(std::move(other.hap_chrom_reads)),
+          read_maker(std::move(other.read_maker)),
+          hap_probs(std::move(other.hap_probs)), ind(other.ind),
+          hap_chrom_seq(std::move(other.hap_chrom_seq)) {}
+    PacBioHaplotypes& operator=(PacBioHaplotypes&& other) noexcept {
+        haplotypes = other.haplotypes;
+        hap_chrom_reads = std::move(other.hap_chrom_reads);
+        read_maker = std::move(other.read_maker);
+        hap_probs = std::move(other.hap_probs);
+        ind = other.ind;
+        hap_chrom_seq = std::move(other.hap_chrom_seq);
+        return *this;
+    }
 
 
     // Add info on # reads
@@ -676,38 +750,31 @@ public:
         std::vector<uint64> hap_reads = reads_per_group(n_reads, hap_probs);
         // splitting by chromosome, too:
         for (uint64 v = 0; v < n_haps; v++) {
-            std::vector<double> chrom_probs;
-            for (const HapChrom& vc : (*haplotypes)[v].chromosomes) {
-                chrom_probs.push_back(vc.size());
-            }
-            n_reads_vc.push_back(reads_per_group(hap_reads[v], chrom_probs));
-        }
-
-        // Fill `read_makers` field:
-        for (uint64 i = 0; i < n_haps; i++) {
-            read_makers[i].add_n_reads(hap_reads[i]);
+            add_chrom_reads(hap_chrom_reads, v, hap_reads[v],
+                            (*haplotypes)[v].chrom_sizes());
         }
 
         return;
     }
 
+    inline uint64 n_extra_pools() const { return 0; }
+    void set_first_id(const uint64& id) { return; }
+
 
 
     // `one_read` method
-    template <typename U>
-    void one_read(std::vector<U>& fastq_pools, bool& finished, pcg64& eng);
+    template <typename U, typename E>
+    void one_read(std::vector<U>& fastq_pools, bool& finished, E& eng);
     // `re_read` method (for duplicates)
-    template <typename U>
-    void re_read(std::vector<U>& fastq_pools, bool& finished, pcg64& eng);
+    template <typename U, typename E>
+    void re_read(std::vector<U>& fastq_pools, bool& finished, E& eng);
 
 
 
 private:
 
-    // Haplotype to create read from.
-    uint64 hap;
-    // Chromosome to create read from.
-    uint64 chr;
+    // Index to `hap_chrom_reads` for the haplotype and chromosome to create reads from.
+    uint64 ind;
     // String for haplotype chromosome. It's saved to make things faster.
     std::string hap_chrom_seq;
 
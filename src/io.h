@@ -12,14 +12,34 @@
 #include <string>               // string class
 
 #include <fstream>
+#include <algorithm>  // min
+#include <cstring>  // memchr
+#include <thread>  // thread
+#include <mutex>  // mutex, lock_guard, unique_lock
+#include <condition_variable>  // condition_variable
 #include "zlib.h"
 
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
 
 #include "htslib/bgzf.h"  // BGZF
 
+/*
+ Optional compression libraries.
+ See `Makevars` for how to build with them.
+ */
+#ifdef __JACKALOPE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+#ifdef __JACKALOPE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "jackalope_types.h"  // integer types
 #include "ref_classes.h"  // Ref* classes
 #include "hap_classes.h"  // Hap* classes
+#include "memory_usage.h"  // mem_usage::out_buffer
 
 
 
@@ -28,12 +48,6 @@ using namespace Rcpp;
 
 
 
-// Size of the block of memory to use for reading non-indexed fasta files and fai files.
-#define LENGTH 0x1000 // hexadecimel for 4096.
-
-
-
-
 inline void expand_path(std::string& file_name) {
     // Obtain environment containing function
     Environment base("package:base");
@@ -50,20 +64,26 @@ inline void expand_path(std::string& file_name) {
 
 /*
  Simple wrappers around file types.
- They are for writing only!
+ They are for writing only! (See `FileLines` below for reading.)
+
+ All of them have `set`, `write`, and `close` methods and can be constructed
+ from an output prefix and compression level.
+ The compressed ones add their own extension to the prefix.
+ Use `FileBGZF` (not `FileHtsBGZF`) for bgzip output so that it uses libdeflate
+ when that's available.
  */
 
 
 // Simple wrapper aroung BGZF class to have `write` and `close` methods
-struct FileBGZF {
+struct FileHtsBGZF {
 
     BGZF *file;
 
-    FileBGZF() : file(nullptr) {};
+    FileHtsBGZF() : file(nullptr) {};
 
-    FileBGZF(const std::string& out_prefix,
-             const int& n_threads,
-             const int& compress) {
+    FileHtsBGZF(const std::string& out_prefix,
+                const int& n_threads,
+                const int& compress) {
 
         construct(out_prefix, compress);
 
@@ -71,8 +91,8 @@ struct FileBGZF {
 
     }
     // Serial version
-    FileBGZF(const std::string& out_prefix,
-             const int& compress) {
+    FileHtsBGZF(const std::string& out_prefix,
+                const int& compress) {
 
         construct(out_prefix, compress);
 
@@ -237,15 +257,378 @@ private:
 
 
 
-// Simple wrapper around std::ofstream class to have `write` and `close` methods
-// that are exactly the same as FileGZ and FileBGZF above
-struct FileUncomp {
+/*
+ Compressed file written as a series of independently compressed blocks.
+ Since blocks don't depend on each other, with `n_threads > 1` (and OpenMP),
+ up to `n_threads` blocks are compressed in parallel before being written in order.
+ This should only use multiple threads outside of other parallel regions.
+
+ `C` is the compression backend, and it should have the following:
+ - `static const uint64 block_size`: max. # uncompressed bytes per block.
+ - `static std::string extension()`: file extension.
+ - A constructor taking the compression level.
+ - `bool compress(const char* in, const uint64& n, std::vector<char>& out)`: compress
+   `n` bytes into one block, returning false on failure.
+ - `static void footer(comp_sizes, sizes, out)`: fill `out` with what goes at the end
+   of the file, given the compressed and uncompressed sizes of all blocks.
+ */
+template <typename C>
+class FileBlocks {
+
+public:
+
+    FileBlocks() : n_threads(1) {};
+
+    FileBlocks(const std::string& out_prefix,
+               const int& n_threads_,
+               const int& compress) {
+        construct(out_prefix, n_threads_, compress);
+    }
+    // Serial version
+    FileBlocks(const std::string& out_prefix,
+               const int& compress) {
+        construct(out_prefix, 1, compress);
+    }
+
+    // Allows to set after initializing blank
+    void set(const std::string& out_prefix,
+             const int& compress) {
+        construct(out_prefix, 1, compress);
+        return;
+    }
+
+
+    inline void write(const char* buffer, const uint64& n) {
+        in_buffer.insert(in_buffer.end(), buffer, buffer + n);
+        if (in_buffer.size() >= (C::block_size * n_threads)) write_blocks(false);
+        return;
+    }
+    inline void write(void *buffer, const int& c) {
+        write(static_cast<const char*>(buffer), static_cast<uint64>(c));
+        return;
+    }
+    inline void write(const std::vector<char>& buffer) {
+        write(buffer.data(), buffer.size());
+        return;
+    }
+    inline void write(const std::string& buffer) {
+        write(buffer.c_str(), buffer.size());
+        return;
+    }
+
+    int close() {
+        write_blocks(true);
+        std::vector<char> footer;
+        C::footer(comp_sizes, sizes, footer);
+        file.write(footer.data(), footer.size());
+        file.close();
+        if (file.fail()) {
+            str_warn({"Close failed for ", file_name});
+            return -1;
+        }
+        return 0;
+    }
+
+
+private:
 
     std::ofstream file;
+    std::string file_name;
+    uint64 n_threads;
+    std::vector<C> compressors;  // one per thread
+    std::vector<char> in_buffer;
+    std::vector<std::vector<char>> out_blocks;
+    // Compressed and uncompressed sizes of all blocks written:
+    std::vector<uint32> comp_sizes;
+    std::vector<uint32> sizes;
+
+    void construct(const std::string& out_prefix,
+                   const int& n_threads_,
+                   int compress) {
+
+        if (compress < -1 || compress > 9) {
+            str_stop({"\nInvalid compress level of ",
+                     std::to_string(compress),
+                     ". It must be in range [0,9]."});
+        }
+        if (compress < 0) compress = 6;
+
+        n_threads = (n_threads_ > 1) ? n_threads_ : 1;
+        compressors.clear();
+        compressors.reserve(n_threads);
+        for (uint64 i = 0; i < n_threads; i++) compressors.emplace_back(compress);
+        in_buffer.clear();
+        in_buffer.reserve(C::block_size * n_threads);
+        out_blocks.resize(n_threads);
+        comp_sizes.clear();
+        sizes.clear();
+
+        file_name = out_prefix + C::extension();
+        file.open(file_name, std::ofstream::out | std::ios::binary);
+        if (!file.is_open()) {
+            str_stop({"\nUnable to create ", file_name, "."});
+        }
+
+        return;
+    }
+
+    /*
+     Compress and write all full blocks in `in_buffer`, plus the last partial
+     block if `all` is true.
+     */
+    void write_blocks(const bool& all) {
+
+        const uint64 block_size = C::block_size;
+        uint64 n_blocks = in_buffer.size() / block_size;
+        if (all && (in_buffer.size() % block_size) > 0) n_blocks++;
+        if (n_blocks == 0) return;
+        if (n_blocks > out_blocks.size()) out_blocks.resize(n_blocks);
+
+        uint64 n_failed = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(n_threads) if (n_threads > 1 && n_blocks > 1) \
+    reduction(+:n_failed)
+#endif
+        for (uint64 i = 0; i < n_blocks; i++) {
+#ifdef _OPENMP
+            uint64 active_thread = omp_get_thread_num();
+#else
+            uint64 active_thread = 0;
+#endif
+            uint64 start = i * block_size;
+            uint64 n = std::min(block_size, in_buffer.size() - start);
+            if (!compressors[active_thread].compress(&in_buffer[start], n,
+                                                     out_blocks[i])) n_failed++;
+        }
+
+        if (n_failed > 0) str_stop({"\nCompression failed for ", file_name, "."});
+
+        uint64 n_used = 0;
+        for (uint64 i = 0; i < n_blocks; i++) {
+            const std::vector<char>& block(out_blocks[i]);
+            file.write(block.data(), block.size());
+            comp_sizes.push_back(block.size());
+            uint64 n = std::min(block_size, in_buffer.size() - n_used);
+            sizes.push_back(n);
+            n_used += n;
+        }
+        in_buffer.erase(in_buffer.begin(), in_buffer.begin() + n_used);
+
+        return;
+    }
+
+};
+
+
+// Write the lowest `n_bytes` bytes of `x` to `out` starting at `pos` (little endian)
+inline void put_le(std::vector<char>& out, const uint64& pos,
+                   uint64 x, const uint64& n_bytes) {
+    for (uint64 i = 0; i < n_bytes; i++) {
+        out[pos + i] = static_cast<char>(x & 0xffULL);
+        x >>= 8;
+    }
+    return;
+}
+
+
+#ifdef __JACKALOPE_LIBDEFLATE
+
+/*
+ BGZF blocks compressed using libdeflate, which is much faster than zlib.
+ Blocks are gzip members with a "BC" extra field giving the block size, and the file
+ ends with an empty block (as in the SAM/BAM specification).
+ Output is the same format as from `FileHtsBGZF`.
+ */
+class BlockBGZF {
+
+public:
+
+    // Same as `BGZF_BLOCK_SIZE` in htslib, so any block fits in 64 kB compressed:
+    static const uint64 block_size = 0xff00;
+
+    static std::string extension() { return ".gz"; }
+
+    BlockBGZF(const int& compress)
+        : compressor(libdeflate_alloc_compressor(compress)) {
+        if (compressor == nullptr) stop("\nCould not allocate libdeflate compressor.");
+    }
+    BlockBGZF(BlockBGZF&& other) : compressor(other.compressor) {
+        other.compressor = nullptr;
+    }
+    BlockBGZF(const BlockBGZF&) = delete;
+    BlockBGZF& operator=(const BlockBGZF&) = delete;
+    ~BlockBGZF() {
+        if (compressor != nullptr) libdeflate_free_compressor(compressor);
+    }
+
+    bool compress(const char* in, const uint64& n, std::vector<char>& out) {
+
+        const uint64 max_block = 0x10000;
+        const uint64 header_size = 18;
+        // gzip header with "BC" extra field; last 2 bytes are filled in with block size
+        const unsigned char header[header_size] = {
+            0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00,
+            0x42, 0x43, 0x02, 0x00, 0x00, 0x00};
+
+        out.resize(max_block);
+        for (uint64 i = 0; i < header_size; i++) out[i] = header[i];
+
+        uint64 n_comp = libdeflate_deflate_compress(
+            compressor, in, n, &out[header_size], max_block - header_size - 8);
+
+        /*
+         If it doesn't fit (which only happens for data that doesn't compress),
+         store it uncompressed in one deflate block.
+         */
+        if (n_comp == 0) {
+            out[header_size] = 1;
+            put_le(out, header_size + 1, n, 2);
+            put_le(out, header_size + 3, ~n, 2);
+            for (uint64 i = 0; i < n; i++) out[header_size + 5 + i] = in[i];
+            n_comp = n + 5;
+        }
+
+        uint64 total = header_size + n_comp + 8;
+        put_le(out, 16, total - 1, 2);
+        put_le(out, header_size + n_comp, libdeflate_crc32(0, in, n), 4);
+        put_le(out, header_size + n_comp + 4, n, 4);
+        out.resize(total);
+
+        return true;
+    }
+
+    static void footer(const std::vector<uint32>& comp_sizes,
+                       const std::vector<uint32>& sizes,
+                       std::vector<char>& out) {
+        // Empty block marking the end of file:
+        const unsigned char eof[28] = {
+            0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00,
+            0x42, 0x43, 0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00};
+        out.assign(eof, eof + 28);
+        return;
+    }
+
+private:
+
+    libdeflate_compressor* compressor;
+
+};
+
+typedef FileBlocks<BlockBGZF> FileBGZF;
+
+#else
+
+typedef FileHtsBGZF FileBGZF;
+
+#endif
+
+
+
+// Stop if this build doesn't support zstd compression
+inline void check_zstd() {
+#ifndef __JACKALOPE_ZSTD
+    stop("\nThis build of jackalope doesn't support zstd compression.");
+#endif
+    return;
+}
+
+
+/*
+ Frames compressed using zstd.
+ Frames are independent, and the file ends with a seek table in the zstd
+ seekable format, so tools that support it can decompress parts of the file.
+ Other zstd tools skip the seek table and decompress it normally.
+ */
+class BlockZstd {
+
+public:
 
-    FileUncomp() {};
+    // Uncompressed bytes per frame:
+    static const uint64 block_size = 0x100000;
 
-    FileUncomp(const std::string& file_name) {
+    static std::string extension() { return ".zst"; }
+
+#ifdef __JACKALOPE_ZSTD
+
+    BlockZstd(const int& compress) : cctx(ZSTD_createCCtx()), level(compress) {
+        if (cctx == nullptr) stop("\nCould not allocate zstd compression context.");
+    }
+    BlockZstd(BlockZstd&& other) : cctx(other.cctx), level(other.level) {
+        other.cctx = nullptr;
+    }
+    BlockZstd(const BlockZstd&) = delete;
+    BlockZstd& operator=(const BlockZstd&) = delete;
+    ~BlockZstd() {
+        if (cctx != nullptr) ZSTD_freeCCtx(cctx);
+    }
+
+    bool compress(const char* in, const uint64& n, std::vector<char>& out) {
+        out.resize(ZSTD_compressBound(n));
+        size_t n_comp = ZSTD_compressCCtx(cctx, out.data(), out.size(), in, n, level);
+        if (ZSTD_isError(n_comp)) return false;
+        out.resize(n_comp);
+        return true;
+    }
+
+#else
+
+    BlockZstd(const int& compress) {
+        check_zstd();
+    }
+    bool compress(const char* in, const uint64& n, std::vector<char>& out) {
+        return false;
+    }
+
+#endif
+
+    // Seek table inside a skippable frame:
+    static void footer(const std::vector<uint32>& comp_sizes,
+                       const std::vector<uint32>& sizes,
+                       std::vector<char>& out) {
+        const uint64 n_frames = comp_sizes.size();
+        const uint64 content_size = n_frames * 8 + 9;
+        out.resize(8 + content_size);
+        put_le(out, 0, 0x184D2A5EULL, 4);  // skippable frame magic number
+        put_le(out, 4, content_size, 4);
+        for (uint64 i = 0; i < n_frames; i++) {
+            put_le(out, 8 + i * 8, comp_sizes[i], 4);
+            put_le(out, 12 + i * 8, sizes[i], 4);
+        }
+        put_le(out, 8 + n_frames * 8, n_frames, 4);
+        out[12 + n_frames * 8] = 0;  // descriptor (no checksums)
+        put_le(out, 13 + n_frames * 8, 0x8F92EAB1ULL, 4);  // seekable magic number
+        return;
+    }
+
+#ifdef __JACKALOPE_ZSTD
+private:
+    ZSTD_CCtx* cctx;
+    int level;
+#endif
+
+};
+
+typedef FileBlocks<BlockZstd> FileZstd;
+
+
+
+/*
+ Uncompressed file with the same `write` and `close` methods as FileGZ and FileBGZF
+ above.
+
+ Writes are collected into a large buffer (`mem_usage::out_buffer` bytes), and full
+ buffers are passed to a background thread that writes them to disk.
+ So threads calling `write` (often while holding a lock shared with other threads)
+ only copy into memory, and they only wait on the disk if the background thread
+ is still writing the previous buffer.
+ */
+struct FileUncomp {
+
+    FileUncomp() : pending_full(false), done(false), failed(false) {};
+
+    FileUncomp(const std::string& file_name) : FileUncomp() {
         construct(file_name);
     }
     /*
@@ -253,34 +636,62 @@ struct FileUncomp {
      allow compressed-file classes.
      */
     FileUncomp(const std::string& file_name,
-               const int& compress) {
+               const int& compress) : FileUncomp() {
         construct(file_name);
     }
 
+    ~FileUncomp() {
+        close();
+    }
+
     // Allows to set after initializing blank
     void set(const std::string& file_name,
              const int& compress) {
+        close();
         construct(file_name);
         return;
     }
 
+    inline void write(const char* buffer, const uint64& n) {
+        active.insert(active.end(), buffer, buffer + n);
+        if (active.size() >= mem_usage::out_buffer) submit();
+        return;
+    }
     inline void write(const std::vector<char>& buffer) {
-        file.write(buffer.data(), buffer.size());
+        write(buffer.data(), buffer.size());
         return;
     }
     inline void write(const std::string& buffer) {
-        file.write(buffer.c_str(), buffer.size());
+        write(buffer.c_str(), buffer.size());
         return;
     }
 
     int close() {
+        if (!writer.joinable()) return 0;
+        if (!active.empty()) submit();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            done = true;
+        }
+        cv.notify_all();
+        writer.join();
         file.close();
-        return 0;
+        return (failed || file.fail()) ? -1 : 0;
     }
 
 
 private:
 
+    std::ofstream file;
+    std::vector<char> active;   // being filled by `write`
+    std::vector<char> pending;  // being written by `writer`
+    bool pending_full;
+    bool done;
+    bool failed;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread writer;
+
     void construct(const std::string& file_name) {
 
         file.open(file_name, std::ofstream::out | std::ios::binary);
@@ -289,6 +700,292 @@ private:
             str_stop({"Unable to open file ", file_name, ".\n"});
         }
 
+        active.clear();
+        pending.clear();
+        active.reserve(mem_usage::out_buffer);
+        pending.reserve(mem_usage::out_buffer);
+        pending_full = false;
+        done = false;
+        failed = false;
+        writer = std::thread(&FileUncomp::write_pending, this);
+
+        return;
+    }
+
+    // Wait for the background thread to be free, then give it the active buffer
+    void submit() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this]{ return !pending_full; });
+        active.swap(pending);
+        pending_full = true;
+        lock.unlock();
+        cv.notify_all();
+        active.clear();
+        return;
+    }
+
+    // Run by the background thread until the file is closed
+    void write_pending() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this]{ return pending_full || done; });
+            if (pending_full) {
+                lock.unlock();
+                file.write(pending.data(), pending.size());
+                if (file.fail()) failed = true;
+                pending.clear();
+                lock.lock();
+                pending_full = false;
+                cv.notify_all();
+            } else break;
+        }
+        return;
+    }
+
+};
+
+
+
+
+
+/*
+ ========================================================================================
+ ========================================================================================
+
+ Reading
+
+ ========================================================================================
+ ========================================================================================
+ */
+
+
+/*
+ Part of a line from a `FileLines` object, without copying it.
+ It's only valid until the next line is read.
+ */
+struct LineView {
+
+    const char* data;
+    uint64 size;
+
+    LineView() : data(nullptr), size(0) {};
+    LineView(const char* data_, const uint64& size_) : data(data_), size(size_) {};
+
+    inline bool empty() const noexcept { return size == 0; }
+    inline const char& operator[](const uint64& i) const { return data[i]; }
+    inline std::string str() const { return std::string(data, size); }
+
+    inline bool starts_with(const std::string& prefix) const {
+        return size >= prefix.size() &&
+            std::memcmp(data, prefix.data(), prefix.size()) == 0;
+    }
+    // Part of this view starting at `pos`:
+    inline LineView substr(const uint64& pos) const {
+        if (pos >= size) return LineView(data + size, 0);
+        return LineView(data + pos, size - pos);
+    }
+    // Without leading or trailing spaces:
+    inline LineView trim() const {
+        uint64 i = 0, j = size;
+        while (i < j && data[i] == ' ') i++;
+        while (j > i && data[j-1] == ' ') j--;
+        return LineView(data + i, j - i);
+    }
+    // Split on a delimiter, skipping empty fields:
+    inline void split(const char& delim, std::vector<LineView>& fields) const {
+        fields.clear();
+        uint64 i = 0;
+        while (i < size) {
+            uint64 j = i;
+            while (j < size && data[j] != delim) j++;
+            if (j > i) fields.push_back(LineView(data + i, j - i));
+            i = j + 1;
+        }
+        return;
+    }
+
+};
+
+
+
+
+/*
+ Reads an uncompressed, gzipped, or bgzipped file line by line.
+
+ A background thread decompresses the file (using zlib, which handles all three)
+ into a ring of `n_bufs` buffers of `mem_usage::in_buffer` bytes, so parsing one
+ buffer overlaps with decompressing the next ones.
+ `next` gives views of lines directly inside these buffers.
+ Only lines that span two buffers are copied (into `carry`).
+ Trailing carriage returns are removed.
+
+ User interrupts are checked each time a new buffer is started.
+ */
+class FileLines {
+
+public:
+
+    FileLines(std::string file_name_)
+        : file(nullptr), file_name(file_name_), bufs(n_bufs), read_i(0), pos(0),
+          have_buf(false), carry(), at_end(false), stopping(false), error() {
+
+        expand_path(file_name);
+
+        file = gzopen(file_name.c_str(), "rb");
+        if (!file) {
+            str_stop({"gzopen of ", file_name, " failed: ", strerror(errno), ".\n"});
+        }
+        gzbuffer(file, 128U * 1024U);
+
+        for (Buffer& b : bufs) b.data.resize(mem_usage::in_buffer);
+
+        reader = std::thread(&FileLines::fill_buffers, this);
+    }
+
+    ~FileLines() {
+        close();
+    }
+
+    /*
+     Set `line` to the next line (without the newline).
+     Returns false once there are no more lines.
+     */
+    bool next(LineView& line) {
+
+        bool use_carry = false;
+        carry.clear();
+
+        while (true) {
+
+            if (!have_buf && !acquire()) {
+                if (!use_carry) return false;
+                line = LineView(carry.data(), carry.size());
+                break;
+            }
+
+            const Buffer& b(bufs[read_i]);
+            const char* start = b.data.data() + pos;
+            uint64 n = b.size - pos;
+            const char* nl = static_cast<const char*>(std::memchr(start, '\n', n));
+
+            if (nl != nullptr) {
+                uint64 len = nl - start;
+                pos += len + 1;
+                if (use_carry) {
+                    carry.append(start, len);
+                    line = LineView(carry.data(), carry.size());
+                } else line = LineView(start, len);
+                break;
+            }
+
+            if (n > 0) {
+                carry.append(start, n);
+                use_carry = true;
+            }
+            release();
+
+        }
+
+        if (line.size > 0 && line.data[line.size-1] == '\r') line.size--;
+
+        return true;
+    }
+
+    // Stop the background thread and close the file
+    void close() {
+        if (!reader.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        reader.join();
+        gzclose(file);
+        file = nullptr;
+        return;
+    }
+
+
+private:
+
+    struct Buffer {
+        std::vector<char> data;
+        uint64 size = 0;
+        bool full = false;  // filled by `reader` and not yet used by `next`
+    };
+
+    static const uint64 n_bufs = 4;
+
+    gzFile file;
+    std::string file_name;
+    std::vector<Buffer> bufs;
+    uint64 read_i;  // buffer `next` is on
+    uint64 pos;  // position in that buffer
+    bool have_buf;  // whether `next` has a buffer it hasn't used up
+    std::string carry;  // for lines that span buffers
+    bool at_end;  // set by `reader` at the end of the file or on an error
+    bool stopping;  // set when closing
+    std::string error;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread reader;
+
+    // Wait for the next buffer, returning false if there aren't any more
+    bool acquire() {
+        Rcpp::checkUserInterrupt();
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this]{ return bufs[read_i].full || at_end; });
+        if (!bufs[read_i].full) {
+            if (!error.empty()) {
+                std::string err = error;
+                lock.unlock();
+                str_stop({"Error reading ", file_name, ": ", err, ".\n"});
+            }
+            return false;
+        }
+        pos = 0;
+        have_buf = true;
+        return true;
+    }
+
+    // Give the current buffer back to the background thread
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            bufs[read_i].full = false;
+        }
+        cv.notify_all();
+        have_buf = false;
+        read_i = (read_i + 1) % n_bufs;
+        return;
+    }
+
+    // Run by the background thread until the end of the file or until closing
+    void fill_buffers() {
+        uint64 i = 0;
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [this, i]{ return !bufs[i].full || stopping; });
+            if (stopping) break;
+            lock.unlock();
+            int n = gzread(file, bufs[i].data.data(),
+                           static_cast<unsigned>(bufs[i].data.size()));
+            int err = Z_OK;
+            std::string err_str;
+            if (n < 0) err_str = gzerror(file, &err);
+            lock.lock();
+            if (n <= 0) {
+                if (n < 0) error = err_str;
+                at_end = true;
+                break;
+            }
+            bufs[i].size = n;
+            bufs[i].full = true;
+            cv.notify_all();
+            i = (i + 1) % n_bufs;
+        }
+        lock.unlock();
+        cv.notify_all();
         return;
     }
 
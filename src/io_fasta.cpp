@@ -23,7 +23,10 @@
 #include "hap_classes.h"  // Hap* classes
 #include "str_manip.h"  // filter_nucleos
 #include "util.h"  // str_stop, thread_check
-#include "io.h"   // expand_path, File* classes, `LENGTH`
+#include "progress_monitor.h"  // ProgressMonitor
+#include "io.h"   // expand_path, File* classes, FileLines
+#include "io_vcf.h"   // match_chrom_names
+#include "seq_diff.h"   // diff_hap_chrom
 
 using namespace Rcpp;
 
@@ -41,26 +44,26 @@ using namespace Rcpp;
 
 // Parse one line of input from a file and add to output
 
-void parse_fasta_line(const std::string& line, const bool& cut_names,
+void parse_fasta_line(const LineView& line, const bool& cut_names,
                       RefGenome& ref) {
 
-    if (line.find(">") != std::string::npos) {
-        std::string name_i = "";
+    if (!line.empty() && line[0] == '>') {
+        std::string name_i;
         if (cut_names) {
-            std::string::size_type spc = line.find(' ', 2);
-            if (spc == std::string::npos) spc = line.size();
-            name_i = line.substr(1, spc);
+            // (Skipping one character so a leading space doesn't count)
+            uint64 spc = 2;
+            while (spc < line.size && line[spc] != ' ') spc++;
+            name_i = std::string(line.data + 1, std::min(spc, line.size - 1));
             // Remove any spaces if they exist (they would occur at the beginning)
             name_i.erase(std::remove_if(name_i.begin(), name_i.end(), ::isspace),
                          name_i.end());
         } else {
-            name_i = line.substr(1, line.size());
+            name_i = line.substr(1).str();
         }
-        RefChrom chrom(name_i, "");
-        ref.chromosomes.push_back(chrom);
-    } else {
-        ref.chromosomes.back().nucleos += line;
-        ref.total_size += line.size();
+        ref.chromosomes.push_back(RefChrom(name_i, ""));
+    } else if (!ref.chromosomes.empty()) {
+        ref.chromosomes.back().nucleos.append(line.data, line.size);
+        ref.total_size += line.size;
     }
     return;
 }
@@ -73,64 +76,19 @@ void parse_fasta_line(const std::string& line, const bool& cut_names,
  Does most of the work for `read_fasta_noind` below.
  */
 void append_ref_noind(RefGenome& ref,
-                      std::string fasta_file,
+                      const std::string& fasta_file,
                       const bool& cut_names,
                       const bool& remove_soft_mask) {
 
-    expand_path(fasta_file);
-
-    gzFile file;
-    file = gzopen(fasta_file.c_str(), "rb");
-    if (! file) {
-        std::string e = "gzopen of " + fasta_file + " failed: " + strerror(errno) + ".\n";
-        Rcpp::stop(e);
-    }
-
-    // Scroll through buffers
-    std::string lastline = "";
-    char *buffer = new char[LENGTH];
-
-    while (1) {
-        Rcpp::checkUserInterrupt();
-        int err;
-        int bytes_read;
-        bytes_read = gzread(file, buffer, LENGTH - 1);
-        buffer[bytes_read] = '\0';
-
-        // Recast buffer as a std::string:
-        std::string mystring(buffer);
-        mystring = lastline + mystring;
-
-        // std::vector of strings for parsed buffer:
-        std::vector<std::string> svec = cpp_str_split_newline(mystring);
-
-        // Scroll through lines derived from the buffer.
-        for (uint64 i = 0; i < svec.size() - 1; i++){
-            parse_fasta_line(svec[i], cut_names, ref);
-        }
-        // Manage the last line.
-        lastline = svec.back();
-
-        // Check for end of file (EOF) or errors.
-        if (bytes_read < LENGTH - 1) {
-            if ( gzeof(file) ) {
-                parse_fasta_line(lastline, cut_names, ref);
-                break;
-            } else {
-                std::string error_string = gzerror (file, & err);
-                if (err) {
-                    std::string e = "Error: " + error_string + ".\n";
-                    stop(e);
-                }
-            }
-        }
+    const uint64 n_chroms0 = ref.size(); // starting # chromosomes
 
-    }
-    delete[] buffer;
-    gzclose (file);
+    FileLines file(fasta_file);
+    LineView line;
+    while (file.next(line)) parse_fasta_line(line, cut_names, ref);
+    file.close();
 
     // Remove weird characters and remove soft masking if desired:
-    for (uint64 i = 0; i < ref.size(); i++) {
+    for (uint64 i = n_chroms0; i < ref.size(); i++) {
         filter_nucleos(ref.chromosomes[i].nucleos, remove_soft_mask);
     }
 
@@ -184,21 +142,25 @@ SEXP read_fasta_noind(const std::vector<std::string>& fasta_files,
 
 // Parse one line of input from a fasta index file and add to output
 
-void parse_line_fai(const std::string& line,
+void parse_line_fai(const LineView& line,
+                    std::vector<LineView>& fields,
                     std::vector<uint64>& offsets,
                     std::vector<std::string>& names,
                     std::vector<uint64>& lengths,
                     std::vector<uint64>& line_lens) {
 
-    char split = '\t';
+    if (line.empty()) return;
 
-    if (line != "") {
-        std::vector<std::string> split_line = cpp_str_split_delim(line, split);
-        names.push_back(split_line[0]);
-        lengths.push_back(std::stoull(split_line[1]));
-        offsets.push_back(std::stoull(split_line[2]));
-        line_lens.push_back(std::stoul(split_line[3]));
+    line.split('\t', fields);
+    if (fields.size() < 4) {
+        str_stop({"\nEach line in a fasta index file should have at least 4 ",
+                 "tab-separated fields."});
     }
+    names.push_back(fields[0].str());
+    lengths.push_back(std::stoull(fields[1].str()));
+    offsets.push_back(std::stoull(fields[2].str()));
+    line_lens.push_back(std::stoul(fields[3].str()));
+
     return;
 }
 
@@ -211,58 +173,13 @@ void read_fai(const std::string& fai_file,
               std::vector<uint64>& lengths,
               std::vector<uint64>& line_lens) {
 
-
-    gzFile file;
-    file = gzopen(fai_file.c_str(), "rb");
-    if (! file) {
-        std::string e = "gzopen of " + fai_file + " failed: " + strerror(errno) +
-            ".\n";
-        Rcpp::stop(e);
-    }
-
-    // Scroll through buffers
-    std::string lastline = "";
-
-    char *buffer = new char[LENGTH];
-
-    while (1) {
-        Rcpp::checkUserInterrupt();
-        int err;
-        int bytes_read;
-        bytes_read = gzread(file, buffer, LENGTH - 1);
-        buffer[bytes_read] = '\0';
-
-        // Recast buffer as a std::string:
-        std::string mystring(buffer);
-        mystring = lastline + mystring;
-
-        // std::vector of strings for parsed buffer:
-        std::vector<std::string> svec = cpp_str_split_newline(mystring);
-
-        // Scroll through lines derived from the buffer.
-        for (uint64 i = 0; i < svec.size() - 1; i++){
-            parse_line_fai(svec[i], offsets, names, lengths, line_lens);
-        }
-        // Manage the last line.
-        lastline = svec.back();
-
-        // Check for end of file (EOF) or errors.
-        if (bytes_read < LENGTH - 1) {
-            if ( gzeof(file) ) {
-                parse_line_fai(lastline, offsets, names, lengths, line_lens);
-                break;
-            } else {
-                std::string error_string = gzerror (file, & err);
-                if (err) {
-                    std::string e = "Error: " + error_string + ".\n";
-                    stop(e);
-                }
-            }
-        }
+    FileLines file(fai_file);
+    LineView line;
+    std::vector<LineView> fields;
+    while (file.next(line)) {
+        parse_line_fai(line, fields, offsets, names, lengths, line_lens);
     }
-
-    delete[] buffer;
-    gzclose (file);
+    file.close();
 
     return;
 }
@@ -411,6 +328,132 @@ SEXP read_fasta_ind(const std::vector<std::string>& fasta_files,
 
 
 
+// ==================================================================
+// ==================================================================
+
+//                          READ FASTA - HAPLOTYPES
+
+// ==================================================================
+// ==================================================================
+
+
+//' Read haplotypes from fasta files to a new \code{HapSet} object.
+//'
+//' Each file should contain one full haplotype, with the same chromosome names
+//' as the reference genome.
+//' Each chromosome's mutations are found by comparing it to the reference
+//' (see `diff_hap_chrom` in `seq_diff.h`).
+//' Files are read one at a time, and chromosomes within a file are compared in
+//' parallel.
+//'
+//' @param reference_ptr External pointer to the reference genome.
+//' @param fasta_files File names of the fasta files, one per haplotype.
+//' @param hap_names Names of the haplotypes.
+//' @param cut_names Boolean for whether to cut chromosome names at the first space.
+//' @param remove_soft_mask Boolean for whether to remove soft-masking by making
+//'    chromosomes all uppercase.
+//' @param print_names Boolean for whether to print chromosome names from a file
+//'    if they don't match the reference.
+//' @param n_threads Number of threads to use.
+//' @param show_progress Boolean for whether to show progress bar.
+//'
+//' @return External pointer to the \code{HapSet} object.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+SEXP read_fasta_haps(SEXP reference_ptr,
+                     const std::vector<std::string>& fasta_files,
+                     const std::vector<std::string>& hap_names,
+                     const bool& cut_names,
+                     const bool& remove_soft_mask,
+                     const bool& print_names,
+                     uint64 n_threads,
+                     const bool& show_progress) {
+
+    XPtr<RefGenome> reference(reference_ptr);
+    const RefGenome& ref(*reference);
+
+    if (fasta_files.size() != hap_names.size()) {
+        str_stop({"\nThe vector of haplotype names must be the same length as ",
+                 "the vector of fasta files."});
+    }
+
+    thread_check(n_threads);
+
+    std::vector<std::string> ref_names;
+    ref_names.reserve(ref.size());
+    for (uint64 i = 0; i < ref.size(); i++) ref_names.push_back(ref[i].name);
+
+    XPtr<HapSet> hap_set(new HapSet(ref, hap_names), true, R_NilValue, reference_ptr);
+
+    Progress prog_bar(ref.total_size * hap_names.size(), show_progress);
+
+    for (uint64 h = 0; h < fasta_files.size(); h++) {
+
+        RefGenome hap_seqs;
+        append_ref_noind(hap_seqs, fasta_files[h], cut_names, remove_soft_mask);
+
+        if (hap_seqs.size() != ref.size()) {
+            str_stop({"\nThe number of chromosomes in the FASTA file ", fasta_files[h],
+                     " doesn't match that for the `ref_genome` object."});
+        }
+        std::vector<std::string> hap_chrom_names;
+        hap_chrom_names.reserve(hap_seqs.size());
+        for (uint64 i = 0; i < hap_seqs.size(); i++) {
+            hap_chrom_names.push_back(hap_seqs[i].name);
+        }
+        std::vector<uint64> ind_map = match_chrom_names(ref_names, hap_chrom_names,
+                                                        print_names, "FASTA");
+        for (uint64 i = 0; i < ref.size(); i++) {
+            if (ref[i].size() == 0 && hap_seqs[ind_map[i]].size() > 0) {
+                str_stop({"\nChromosome ", ref[i].name, " in the FASTA file ",
+                         fasta_files[h], " isn't empty, but it is in the ",
+                         "`ref_genome` object."});
+            }
+        }
+
+        HapGenome& hap_genome((*hap_set)[h]);
+        ProgressMonitor monitor(prog_bar, n_threads);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(n_threads) if (n_threads > 1)
+{
+#endif
+
+        // (No barrier at the end so the master thread can monitor)
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic) nowait
+#endif
+        for (uint64 i = 0; i < ref.size(); i++) {
+            if (monitor.check_abort()) continue;
+            diff_hap_chrom(hap_genome[i], hap_seqs[ind_map[i]].nucleos);
+            monitor.increment(ref[i].size());
+        }
+
+        monitor.finish();
+
+#ifdef _OPENMP
+}
+#endif
+
+        if (monitor.is_aborted()) {
+            std::string warn_msg = "\nThe user interrupted reading haplotype FASTA ";
+            warn_msg += "files, so some haplotypes are missing mutations.";
+            Rcpp::warning(warn_msg.c_str());
+            break;
+        }
+
+    }
+
+    return hap_set;
+
+}
+
+
+
+
+
 // ==================================================================
 // ==================================================================
 
@@ -424,8 +467,8 @@ SEXP read_fasta_ind(const std::vector<std::string>& fasta_files,
 
 /*
  Template that does most of the work to write from RefGenome to FASTA files of
- varying formats (gzip, bgzip, uncompressed).
- `T` should be `FileUncomp` or `FileBGZF` from `io.h`
+ varying formats (gzip, bgzip, zstd, uncompressed).
+ `T` should be `FileUncomp`, `FileGZ`, `FileBGZF`, or `FileZstd` from `io.h`
  */
 template <typename T>
 inline void write_ref_fasta__(const std::string& file_name,
@@ -517,6 +560,10 @@ void write_ref_fasta(const std::string& out_prefix,
         } else if (comp_method == "bgzip") {
             write_ref_fasta__<FileBGZF>(file_name, compress, ref, text_width,
                                         show_progress);
+        } else if (comp_method == "zstd") {
+            check_zstd();
+            write_ref_fasta__<FileZstd>(file_name, compress, ref, text_width,
+                                        show_progress);
         } else stop("\nUnrecognized compression method.");
 
     } else {
@@ -540,7 +587,8 @@ void write_haps_fasta__(const std::string& out_prefix,
                         const uint64& n_threads,
                         const bool& show_progress) {
 
-    Progress prog_bar(hap_set.reference->size() * hap_set.size(), show_progress);
+    Progress prog_bar(hap_set.reference->total_size * hap_set.size(), show_progress);
+    ProgressMonitor monitor(prog_bar, n_threads);
 
 #ifdef _OPENMP
 #pragma omp parallel num_threads(n_threads) if (n_threads > 1)
@@ -551,20 +599,20 @@ void write_haps_fasta__(const std::string& out_prefix,
     std::string name;
     name.reserve(text_width + 1);
 
-    // Parallelize the Loop
+    // Parallelize the Loop (no barrier at the end so the master thread can monitor)
 #ifdef _OPENMP
-#pragma omp for schedule(static)
+#pragma omp for schedule(static) nowait
 #endif
     for (uint64 v = 0; v < hap_set.size(); v++) {
 
-        if (prog_bar.is_aborted() || prog_bar.check_abort()) continue;
+        if (monitor.check_abort()) continue;
 
         std::string file_name = out_prefix + "__" + hap_set[v].name + ".fa";
         T out_file(file_name, compress);
 
         for (uint64 s = 0; s < hap_set.reference->size(); s++) {
 
-            if (prog_bar.is_aborted() || prog_bar.check_abort()) break;
+            if (monitor.check_abort()) break;
 
             name = '>';
             name += (*hap_set.reference)[s].name;
@@ -579,7 +627,7 @@ void write_haps_fasta__(const std::string& out_prefix,
             while (line_start < hap_chrom.chrom_size) {
                 // Check every 10,000 characters for user interrupt:
                 if (n_chars > 10000) {
-                    if (prog_bar.check_abort()) break;
+                    if (monitor.check_abort()) break;
                     n_chars = 0;
                 }
                 hap_chrom.set_chrom_chunk(line, line_start,
@@ -590,7 +638,7 @@ void write_haps_fasta__(const std::string& out_prefix,
                 n_chars += text_width;
             }
 
-            prog_bar.increment(hap_set.reference->operator[](s).size());
+            monitor.increment(hap_set.reference->operator[](s).size());
 
         }
 
@@ -598,6 +646,8 @@ void write_haps_fasta__(const std::string& out_prefix,
 
     }
 
+    monitor.finish();
+
 #ifdef _OPENMP
 }
 #endif
@@ -643,6 +693,10 @@ void write_haps_fasta(std::string out_prefix,
         } else if (comp_method == "bgzip") {
             write_haps_fasta__<FileBGZF>(out_prefix, hap_set, text_width, compress,
                                          n_threads, show_progress);
+        } else if (comp_method == "zstd") {
+            check_zstd();
+            write_haps_fasta__<FileZstd>(out_prefix, hap_set, text_width, compress,
+                                         n_threads, show_progress);
         } else stop("\nUnrecognized compression method.");
 
     } else {
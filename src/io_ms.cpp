@@ -20,9 +20,8 @@
 #include "jackalope_types.h"  // integer types
 #include "ref_classes.h"  // Ref* classes
 #include "hap_classes.h"  // Hap* classes
-#include "str_manip.h"  // filter_nucleos
 #include "util.h"  // str_stop, thread_check
-#include "io.h"
+#include "io.h"  // FileLines
 
 using namespace Rcpp;
 
@@ -39,19 +38,19 @@ namespace parse_ms {
  Parse from gene trees in ms-style output
  */
 
-void ms_parse_tree_line(std::string& line,
+void ms_parse_tree_line(const LineView& line,
                         std::vector<std::vector<std::string>>& newick_strings) {
 
-    if (line[0] == '/' && line[1] == '/') {
+    if (line.starts_with("//")) {
         newick_strings.push_back(std::vector<std::string>(0));
         return;
     }
-    if (line[0] == '[' || line[0] == '(') {
+    if (!line.empty() && (line[0] == '[' || line[0] == '(')) {
         if (newick_strings.empty()) {
             str_stop({"\nIn the input ms-style output file containing gene trees, ",
                      "the first gene tree is not preceded with a line containing \"//\"."});
         }
-        newick_strings.back().push_back(line);
+        newick_strings.back().push_back(line.str());
     }
     return;
 }
@@ -69,56 +68,10 @@ std::vector<std::vector<std::string>> read_ms_trees_(std::string ms_file) {
 
     std::vector<std::vector<std::string>> newick_strings;
 
-    expand_path(ms_file);
-
-    gzFile file;
-    file = gzopen(ms_file.c_str(), "rb");
-    if (! file) {
-        std::string e = "gzopen of " + ms_file + " failed: " + strerror(errno) + ".\n";
-        Rcpp::stop(e);
-    }
-
-    // Scroll through buffers
-    std::string lastline = "";
-    char *buffer = new char[LENGTH];
-
-    while (1) {
-        Rcpp::checkUserInterrupt();
-        int err;
-        int bytes_read;
-        bytes_read = gzread(file, buffer, LENGTH - 1);
-        buffer[bytes_read] = '\0';
-
-        // Recast buffer as a std::string:
-        std::string mystring(buffer);
-        mystring = lastline + mystring;
-
-        // std::vector of strings for parsed buffer:
-        std::vector<std::string> svec = cpp_str_split_newline(mystring);
-
-        // Scroll through lines derived from the buffer.
-        for (uint64 i = 0; i < svec.size() - 1; i++){
-            ms_parse_tree_line(svec[i], newick_strings);
-        }
-        // Manage the last line.
-        lastline = svec.back();
-
-        // Check for end of file (EOF) or errors.
-        if (bytes_read < LENGTH - 1) {
-            if ( gzeof(file) ) {
-                ms_parse_tree_line(lastline, newick_strings);
-                break;
-            } else {
-                std::string error_string = gzerror(file, &err);
-                if (err) {
-                    std::string e = "Error: " + error_string + ".\n";
-                    stop(e);
-                }
-            }
-        }
-    }
-    delete[] buffer;
-    gzclose (file);
+    FileLines file(ms_file);
+    LineView line;
+    while (file.next(line)) ms_parse_tree_line(line, newick_strings);
+    file.close();
 
     return newick_strings;
 }
@@ -167,26 +120,28 @@ struct MS_SitesInfo {
 };
 
 // For parsing a single line from the file
-void ms_parse_sites_line(std::string& line,
+void ms_parse_sites_line(const LineView& line,
+                         std::vector<LineView>& fields,
                          std::vector<MS_SitesInfo>& sites_infos) {
 
+    if (line.empty()) return;
+
     if (line[0] == '0' || line[0] == '1') {
         if (sites_infos.empty()) return; // sometimes it has a header that starts with 1/0
-        trimws(line);
+        LineView bools = line.trim();
         std::vector<std::vector<bool>>& segr_bools(sites_infos.back().segr_bools);
         segr_bools.push_back(std::vector<bool>());
-        segr_bools.back().reserve(line.size());
-        for (char& c : line) segr_bools.back().push_back(c == '1');
-    } else if (line[0] == '/' || line[0] == '/') {
+        segr_bools.back().reserve(bools.size);
+        for (uint64 i = 0; i < bools.size; i++) {
+            segr_bools.back().push_back(bools[i] == '1');
+        }
+    } else if (line[0] == '/') {
         sites_infos.push_back(MS_SitesInfo());
-    } else if (line.compare(0, parse_ms::site.size(), parse_ms::site) == 0) {
-        line.erase(0, parse_ms::site.size());
-        trimws(line);
-        sites_infos.back().n_sites = std::stoi(line);
-    } else if (line.compare(0, parse_ms::pos.size(), parse_ms::pos) == 0) {
-        line.erase(0, parse_ms::pos.size());
-        trimws(line);
-        std::vector<std::string> pos_str = cpp_str_split_delim(line, ' ');
+    } else if (line.starts_with(parse_ms::site)) {
+        LineView n_sites = line.substr(parse_ms::site.size()).trim();
+        sites_infos.back().n_sites = std::stoi(n_sites.str());
+    } else if (line.starts_with(parse_ms::pos)) {
+        line.substr(parse_ms::pos.size()).split(' ', fields);
         if (sites_infos.empty()) {
             str_stop({"\nIn parsing of segregation-sites info from a file, ",
                      "a line starting with '//' should always appear before ",
@@ -194,8 +149,8 @@ void ms_parse_sites_line(std::string& line,
         }
         std::vector<double>& pos(sites_infos.back().positions);
         if (!pos.empty()) stop("multiple positions for the same locus.");
-        pos.reserve(pos_str.size());
-        for (std::string& ps : pos_str) pos.push_back(std::stod(ps));
+        pos.reserve(fields.size());
+        for (const LineView& ps : fields) pos.push_back(std::stod(ps.str()));
     }
     return;
 }
@@ -214,57 +169,11 @@ arma::field<arma::mat> coal_file_sites(std::string ms_file) {
 
     std::vector<MS_SitesInfo> sites_infos;
 
-    expand_path(ms_file);
-
-    gzFile file;
-    file = gzopen(ms_file.c_str(), "rb");
-    if (! file) {
-        std::string e = "gzopen of " + ms_file + " failed: " + strerror(errno) + ".\n";
-        Rcpp::stop(e);
-    }
-
-    // Scroll through buffers
-    std::string lastline = "";
-
-    char *buffer = new char[LENGTH];
-
-    while (1) {
-        Rcpp::checkUserInterrupt();
-        int err;
-        int bytes_read;
-        bytes_read = gzread(file, buffer, LENGTH - 1);
-        buffer[bytes_read] = '\0';
-
-        // Recast buffer as a std::string:
-        std::string mystring(buffer);
-        mystring = lastline + mystring;
-
-        // std::vector of strings for parsed buffer:
-        std::vector<std::string> svec = cpp_str_split_newline(mystring);
-
-        // Scroll through lines derived from the buffer.
-        for (uint64 i = 0; i < svec.size() - 1; i++){
-            ms_parse_sites_line(svec[i], sites_infos);
-        }
-        // Manage the last line.
-        lastline = svec.back();
-
-        // Check for end of file (EOF) or errors.
-        if (bytes_read < LENGTH - 1) {
-            if ( gzeof(file) ) {
-                ms_parse_sites_line(lastline, sites_infos);
-                break;
-            } else {
-                std::string error_string = gzerror(file, &err);
-                if (err) {
-                    std::string e = "Error: " + error_string + ".\n";
-                    stop(e);
-                }
-            }
-        }
-    }
-    delete[] buffer;
-    gzclose (file);
+    FileLines file(ms_file);
+    LineView line;
+    std::vector<LineView> fields;
+    while (file.next(line)) ms_parse_sites_line(line, fields, sites_infos);
+    file.close();
 
     arma::field<arma::mat> sites_mats(sites_infos.size());
     for (uint64 i = 0; i < sites_infos.size(); i++) {
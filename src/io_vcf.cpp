@@ -709,7 +709,8 @@ SEXP read_vcf_cpp(SEXP reference_ptr,
     std::vector<uint64> ind_map = match_chrom_names(ref_names, chrom_names, print_names);
 
     // Finally create HapSet
-    XPtr<HapSet> hap_set(new HapSet(*reference, hap_names));
+    XPtr<HapSet> hap_set(new HapSet(*reference, hap_names), true, R_NilValue,
+                         reference_ptr);
     // ...and add mutations:
     add_vcf_mutations(*hap_set, alts_list, chrom_inds, positions, ref_chrom, ind_map);
 
@@ -31,10 +31,12 @@ using namespace Rcpp;
  This function produces a vector of indices that map the VCF indices onto the
  original chromosome names from the `ref_genome` object.
  This is in case the chromosomes are in a different order in the VCF file.
+ It's also used for haplotype FASTA files, with `file_type` set to `"FASTA"`.
  */
 inline std::vector<uint64> match_chrom_names(const std::vector<std::string>& from_ref,
                                              const std::vector<std::string>& from_vcf,
-                                             const bool& print_names) {
+                                             const bool& print_names,
+                                             const std::string& file_type = "VCF") {
 
     std::vector<uint64> order_(from_ref.size());
 
@@ -46,11 +48,12 @@ inline std::vector<uint64> match_chrom_names(const std::vector<std::string>& fro
             if (print_names) {
                 for (const std::string& s : from_vcf) err_msg.push_back(s + '\n');
             }
-            err_msg.push_back("\nChromosome name(s) in VCF file don't match those in ");
+            err_msg.push_back("\nChromosome name(s) in " + file_type);
+            err_msg.push_back(" file don't match those in ");
             err_msg.push_back("the `ref_genome` object. It's probably easiest ");
             err_msg.push_back("to manually change the `ref_genome` object ");
             err_msg.push_back("(using `$set_names()` method) to have the same names ");
-            err_msg.push_back("as the VCF file.");
+            err_msg.push_back("as the " + file_type + " file.");
             str_stop(err_msg);
         }
         order_[i] = iter - from_vcf.begin();
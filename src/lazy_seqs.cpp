@@ -0,0 +1,396 @@
+
+/*
+ ********************************************************
+
+ Lazy character vectors of chromosome sequences.
+
+ Viewing chromosomes from R used to copy every one of them into a character
+ vector right away.
+ Where R supports it (>= 3.6.0), these vectors are instead ALTREP objects that only
+ hold a pointer to the genome. A chromosome is only copied into an R string when
+ R asks for that element, and a haplotype chromosome is only pieced together from
+ its mutations at that point.
+ Vectors are filled in completely (and let go of the genome) before they're
+ serialized, when R needs a pointer to all their data, or when the genome they
+ point to is about to be changed (see `detach_lazy_chroms`).
+
+ ********************************************************
+ */
+
+
+#include "jackalope_config.h" // controls debugging and diagnostics output
+
+#include <RcppArmadillo.h>
+#include <Rversion.h>  // R_VERSION
+#include <vector>  // vector class
+#include <string>  // string class
+
+#include "jackalope_types.h"  // integer types
+#include "ref_classes.h"  // Ref* classes
+#include "hap_classes.h"  // Hap* classes
+#include "lazy_seqs.h"  // lazy_*_chroms, detach_lazy_chroms
+
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 6, 0)
+#define JACKALOPE_ALTREP
+#include <R_ext/Altrep.h>
+#endif
+
+
+using namespace Rcpp;
+
+
+
+namespace lazy_seqs {
+
+/*
+ Where a lazy vector's sequences come from.
+ These are stored as doubles inside the R object.
+ */
+enum info_ind {
+    hap_info = 0,       // 1 for haplotypes, 0 for a reference genome
+    hap_ind_info,       // haplotype index
+    start_info,         // index for the first chromosome
+    n_info              // number of chromosomes
+};
+
+
+/*
+ One chromosome as an R string (CHARSXP).
+ `ptr` points to a RefGenome or HapSet, and `info` is as above.
+ A HapSet pointer protects its reference's pointer, so holding `ptr` is enough to
+ keep both genomes alive.
+ */
+SEXP chrom_charsxp(SEXP ptr, const double* info, const uint64& i) {
+
+    uint64 chrom_ind = static_cast<uint64>(info[start_info]) + i;
+
+    if (info[hap_info] == 0) {
+        const RefGenome* ref_genome =
+            static_cast<const RefGenome*>(R_ExternalPtrAddr(ptr));
+        const std::string& nucleos((*ref_genome)[chrom_ind].nucleos);
+        return Rf_mkCharLen(nucleos.c_str(), nucleos.size());
+    }
+
+    const HapSet* hap_set = static_cast<const HapSet*>(R_ExternalPtrAddr(ptr));
+    uint64 hap_ind = static_cast<uint64>(info[hap_ind_info]);
+    std::string nucleos = (*hap_set)[hap_ind][chrom_ind].get_chrom_full();
+    return Rf_mkCharLen(nucleos.c_str(), nucleos.size());
+}
+
+
+/*
+ Whether the genome at `ptr` depends on the one at `genome`: either it's the same
+ genome or it's a HapSet using `genome` as its reference.
+ */
+bool uses_genome(SEXP ptr, const double* info, const void* genome) {
+    const void* addr = R_ExternalPtrAddr(ptr);
+    if (addr == genome) return true;
+    if (info[hap_info] != 0) {
+        const HapSet* hap_set = static_cast<const HapSet*>(addr);
+        if (static_cast<const void*>(hap_set->reference) == genome) return true;
+    }
+    return false;
+}
+
+
+}
+
+
+
+#ifdef JACKALOPE_ALTREP
+
+
+/*
+ ========================================================================================
+ ========================================================================================
+
+ ALTREP class
+
+ `data1` is a list of the external pointer to the genome and a numeric vector of info
+ (see `lazy_seqs::info_ind`), or NULL once everything's been filled in.
+ `data2` is NULL until R first accesses an element, then a regular character vector
+ with the sequences retrieved so far.
+ Elements not yet retrieved are blank strings. Empty chromosomes are cheap to
+ retrieve, so it's fine to retrieve them again.
+
+ ========================================================================================
+ ========================================================================================
+ */
+
+namespace lazy_seqs {
+
+R_altrep_class_t chroms_class;
+
+/*
+ Lazy vectors that may still point to a genome (as weak references).
+ They're the first `n_views` elements of an R list that's protected from garbage
+ collection for as long as it's in use.
+ */
+SEXP views = R_NilValue;
+R_xlen_t n_views = 0;
+const R_xlen_t min_views = 16;
+
+
+SEXP get_data2(SEXP x) {
+    SEXP data2 = R_altrep_data2(x);
+    if (data2 == R_NilValue) {
+        const double* info = REAL(VECTOR_ELT(R_altrep_data1(x), 1));
+        data2 = PROTECT(Rf_allocVector(STRSXP,
+                                       static_cast<R_xlen_t>(info[n_info])));
+        R_set_altrep_data2(x, data2);
+        UNPROTECT(1);
+    }
+    return data2;
+}
+
+
+// Fill in all elements and let go of the genome
+void materialize(SEXP x) {
+    SEXP data1 = R_altrep_data1(x);
+    if (data1 == R_NilValue) return;
+    SEXP data2 = get_data2(x);
+    SEXP ptr = VECTOR_ELT(data1, 0);
+    const double* info = REAL(VECTOR_ELT(data1, 1));
+    for (R_xlen_t i = 0; i < XLENGTH(data2); i++) {
+        if (STRING_ELT(data2, i) != R_BlankString) continue;
+        SET_STRING_ELT(data2, i, chrom_charsxp(ptr, info, i));
+    }
+    R_set_altrep_data1(x, R_NilValue);
+    return;
+}
+
+
+
+/*
+ Remove views of vectors that no longer exist or are already filled in, after
+ filling in those that use `genome` (if it isn't null; see `uses_genome`).
+ Afterward, at least half the list is free, so new views can be added in amortized
+ constant time by only doing this when it's full.
+ */
+void compact_views(const void* genome) {
+
+    R_xlen_t n_kept = 0;
+    for (R_xlen_t i = 0; i < n_views; i++) {
+        SEXP view = VECTOR_ELT(views, i);
+        SEXP x = PROTECT(R_WeakRefKey(view));
+        if (x != R_NilValue && R_altrep_data1(x) != R_NilValue) {
+            SEXP data1 = R_altrep_data1(x);
+            if (genome != nullptr &&
+                uses_genome(VECTOR_ELT(data1, 0), REAL(VECTOR_ELT(data1, 1)), genome)) {
+                materialize(x);
+            } else {
+                SET_VECTOR_ELT(views, n_kept, view);
+                n_kept++;
+            }
+        }
+        UNPROTECT(1);
+    }
+    // Let go of the rest so they can be collected:
+    for (R_xlen_t i = n_kept; i < n_views; i++) SET_VECTOR_ELT(views, i, R_NilValue);
+    n_views = n_kept;
+
+    R_xlen_t capacity = (views == R_NilValue) ? 0 : XLENGTH(views);
+    if (capacity >= 2 * n_views && capacity > 0) return;
+
+    R_xlen_t new_capacity = 2 * n_views;
+    if (new_capacity < min_views) new_capacity = min_views;
+    SEXP new_views = PROTECT(Rf_allocVector(VECSXP, new_capacity));
+    for (R_xlen_t i = 0; i < n_views; i++) {
+        SET_VECTOR_ELT(new_views, i, VECTOR_ELT(views, i));
+    }
+    R_PreserveObject(new_views);
+    if (views != R_NilValue) R_ReleaseObject(views);
+    views = new_views;
+    UNPROTECT(1);
+
+    return;
+}
+
+
+
+R_xlen_t chroms_Length(SEXP x) {
+    SEXP data1 = R_altrep_data1(x);
+    if (data1 == R_NilValue) return XLENGTH(R_altrep_data2(x));
+    const double* info = REAL(VECTOR_ELT(data1, 1));
+    return static_cast<R_xlen_t>(info[n_info]);
+}
+
+SEXP chroms_Elt(SEXP x, R_xlen_t i) {
+    SEXP data2 = get_data2(x);
+    SEXP data1 = R_altrep_data1(x);
+    SEXP elt = STRING_ELT(data2, i);
+    if (elt != R_BlankString || data1 == R_NilValue) return elt;
+    elt = PROTECT(chrom_charsxp(VECTOR_ELT(data1, 0), REAL(VECTOR_ELT(data1, 1)),
+                                static_cast<uint64>(i)));
+    SET_STRING_ELT(data2, i, elt);
+    UNPROTECT(1);
+    return elt;
+}
+
+void chroms_Set_elt(SEXP x, R_xlen_t i, SEXP v) {
+    materialize(x);
+    SET_STRING_ELT(R_altrep_data2(x), i, v);
+    return;
+}
+
+void* chroms_Dataptr(SEXP x, Rboolean writeable) {
+    materialize(x);
+    return const_cast<SEXP*>(STRING_PTR_RO(R_altrep_data2(x)));
+}
+
+const void* chroms_Dataptr_or_null(SEXP x) {
+    if (R_altrep_data1(x) != R_NilValue) return nullptr;
+    return STRING_PTR_RO(R_altrep_data2(x));
+}
+
+// Saved as a regular character vector because the genome pointer can't be saved
+SEXP chroms_Serialized_state(SEXP x) {
+    materialize(x);
+    return R_altrep_data2(x);
+}
+
+SEXP chroms_Unserialize(SEXP cls, SEXP state) {
+    return state;
+}
+
+Rboolean chroms_Inspect(SEXP x, int pre, int deep, int pvec,
+                        void (*inspect_subtree)(SEXP, int, int, int)) {
+    bool lazy = R_altrep_data1(x) != R_NilValue;
+    Rprintf("jackalope chromosomes (len=%d, %s)\n",
+            static_cast<int>(chroms_Length(x)), lazy ? "lazy" : "materialized");
+    return TRUE;
+}
+
+
+
+SEXP new_chroms(SEXP ptr, const std::vector<double>& info_vec) {
+
+    if (views == R_NilValue || n_views == XLENGTH(views)) compact_views(nullptr);
+
+    SEXP info = PROTECT(Rf_allocVector(REALSXP, info_vec.size()));
+    for (uint64 i = 0; i < info_vec.size(); i++) REAL(info)[i] = info_vec[i];
+    SEXP data1 = PROTECT(Rf_allocVector(VECSXP, 2));
+    SET_VECTOR_ELT(data1, 0, ptr);
+    SET_VECTOR_ELT(data1, 1, info);
+
+    SEXP out = PROTECT(R_new_altrep(chroms_class, data1, R_NilValue));
+
+    // So it can be filled in before its genome changes:
+    SET_VECTOR_ELT(views, n_views, R_MakeWeakRef(out, R_NilValue, R_NilValue, FALSE));
+    n_views++;
+
+    UNPROTECT(3);
+
+    return out;
+}
+
+}
+
+
+#else
+
+
+namespace lazy_seqs {
+
+// Without ALTREP, sequences are copied right away
+SEXP new_chroms(SEXP ptr, const std::vector<double>& info) {
+    uint64 n = static_cast<uint64>(info[n_info]);
+    SEXP out = PROTECT(Rf_allocVector(STRSXP, n));
+    for (uint64 i = 0; i < n; i++) {
+        SET_STRING_ELT(out, i, chrom_charsxp(ptr, info.data(), i));
+    }
+    UNPROTECT(1);
+    return out;
+}
+
+}
+
+
+#endif
+
+
+
+
+// Registers the ALTREP class when the package is loaded
+// [[Rcpp::init]]
+void init_lazy_seqs(DllInfo* dll) {
+
+#ifdef JACKALOPE_ALTREP
+
+    using namespace lazy_seqs;
+
+    chroms_class = R_make_altstring_class("lazy_chroms", "jackalope", dll);
+
+    R_set_altrep_Length_method(chroms_class, chroms_Length);
+    R_set_altrep_Inspect_method(chroms_class, chroms_Inspect);
+    R_set_altrep_Serialized_state_method(chroms_class, chroms_Serialized_state);
+    R_set_altrep_Unserialize_method(chroms_class, chroms_Unserialize);
+    R_set_altvec_Dataptr_method(chroms_class, chroms_Dataptr);
+    R_set_altvec_Dataptr_or_null_method(chroms_class, chroms_Dataptr_or_null);
+    R_set_altstring_Elt_method(chroms_class, chroms_Elt);
+    R_set_altstring_Set_elt_method(chroms_class, chroms_Set_elt);
+
+#endif
+
+    return;
+}
+
+
+
+/*
+ ========================================================================================
+ ========================================================================================
+
+ Making vectors and detaching them from genomes
+
+ ========================================================================================
+ ========================================================================================
+ */
+
+
+SEXP lazy_ref_chroms(SEXP ref_genome_ptr,
+                     const uint64& chrom_start,
+                     const uint64& n_chroms) {
+
+    XPtr<RefGenome> ref_genome(ref_genome_ptr);
+    if ((chrom_start + n_chroms) > ref_genome->size()) {
+        stop("chromosome index out of bounds");
+    }
+
+    std::vector<double> info = {0, 0, static_cast<double>(chrom_start),
+                                static_cast<double>(n_chroms)};
+
+    return lazy_seqs::new_chroms(ref_genome_ptr, info);
+}
+
+
+SEXP lazy_hap_chroms(SEXP hap_set_ptr,
+                     const uint64& hap_ind,
+                     const uint64& chrom_start,
+                     const uint64& n_chroms) {
+
+    XPtr<HapSet> hap_set(hap_set_ptr);
+    if (hap_ind >= hap_set->size()) stop("haplotype index out of bounds");
+    if ((chrom_start + n_chroms) > (*hap_set)[hap_ind].size()) {
+        stop("chromosome index out of bounds");
+    }
+
+    std::vector<double> info = {1, static_cast<double>(hap_ind),
+                                static_cast<double>(chrom_start),
+                                static_cast<double>(n_chroms)};
+
+    return lazy_seqs::new_chroms(hap_set_ptr, info);
+}
+
+
+
+void detach_lazy_chroms(SEXP genome_ptr) {
+
+#ifdef JACKALOPE_ALTREP
+
+    lazy_seqs::compact_views(R_ExternalPtrAddr(genome_ptr));
+
+#endif
+
+    return;
+}
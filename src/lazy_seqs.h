@@ -0,0 +1,50 @@
+#ifndef __JACKALOPE_LAZY_SEQS_H
+#define __JACKALOPE_LAZY_SEQS_H
+
+
+/*
+ ********************************************************
+
+ Character vectors of chromosome sequences that are only filled in when R
+ actually accesses them.
+
+ ********************************************************
+ */
+
+
+#include "jackalope_config.h" // controls debugging and diagnostics output
+
+#include <RcppArmadillo.h>
+
+#include "jackalope_types.h"  // integer types
+
+
+using namespace Rcpp;
+
+
+/*
+ Character vector of `n_chroms` reference chromosomes, starting with
+ index `chrom_start`.
+ */
+SEXP lazy_ref_chroms(SEXP ref_genome_ptr,
+                     const uint64& chrom_start,
+                     const uint64& n_chroms);
+
+/*
+ Character vector of `n_chroms` chromosomes from haplotype `hap_ind`, starting with
+ index `chrom_start`.
+ */
+SEXP lazy_hap_chroms(SEXP hap_set_ptr,
+                     const uint64& hap_ind,
+                     const uint64& chrom_start,
+                     const uint64& n_chroms);
+
+/*
+ Fill in all vectors that still point to a genome (or to haplotypes using it as their
+ reference) so they aren't affected by changes to it.
+ This should be called by anything that alters a RefGenome or HapSet in place.
+ */
+void detach_lazy_chroms(SEXP genome_ptr);
+
+
+#endif
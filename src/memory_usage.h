@@ -0,0 +1,217 @@
+#ifndef __JACKALOPE_MEMORY_USAGE_H
+#define __JACKALOPE_MEMORY_USAGE_H
+
+
+/*
+ ********************************************************
+
+ Approximate accounting of the memory used by genome objects.
+
+ Numbers here are estimates: they assume libstdc++ containers (512-byte deque
+ blocks, 15-character short-string buffer) and a glibc-style allocator
+ (8-byte chunk header, 16-byte alignment, 32-byte minimum chunk).
+ They should be close on Linux and macOS, and they're always in bytes.
+
+ ********************************************************
+ */
+
+
+#include "jackalope_config.h" // controls debugging and diagnostics output
+
+#include <RcppArmadillo.h>
+#include <vector>  // vector class
+#include <string>  // string class
+#include <deque>  // deque class
+#include <algorithm>  // max
+
+#include "jackalope_types.h"  // integer types
+
+
+using namespace Rcpp;
+
+
+
+namespace mem_usage {
+
+// Bytes per block inside a std::deque
+const uint64 deque_block = 512;
+// Smallest number of block pointers in a std::deque's map
+const uint64 deque_min_map = 8;
+// Largest string that fits inside a std::string object (no heap allocation)
+const uint64 sso_capacity = 15;
+
+/*
+ Bytes actually taken from the heap when you ask the allocator for `n` bytes.
+ */
+inline uint64 malloc_chunk(const uint64& n) {
+    if (n == 0) return 0;
+    uint64 chunk = (n + 8ULL + 15ULL) & ~static_cast<uint64>(15);
+    if (chunk < 32ULL) chunk = 32ULL;
+    return chunk;
+}
+
+/*
+ Number of blocks a std::deque needs to store `n` objects of `elem_size` bytes.
+ */
+inline uint64 deque_blocks(const uint64& n, const uint64& elem_size) {
+    uint64 per_block = elem_size < deque_block ? deque_block / elem_size : 1;
+    return n / per_block + 1;
+}
+
+/*
+ Bytes of FASTQ text for one read: "@" + name, read, "+", and quality lines.
+ `name_length` is the (mean) length of read names, and `read_length` is the
+ (mean) read length.
+ */
+inline uint64 fastq_read(const uint64& name_length, const uint64& read_length) {
+    return name_length + 2ULL * read_length + 6ULL;
+}
+
+/*
+ Bytes used by one thread's pool of `read_pool_size` reads before they're written,
+ allowing for 2x growth of the vector holding them.
+ */
+inline uint64 read_pool(const uint64& read_pool_size, const uint64& read_bytes) {
+    return 2ULL * read_pool_size * read_bytes;
+}
+
+// Bytes collected before each write to an uncompressed output file (see `FileUncomp`)
+const uint64 out_buffer = 4ULL * 1024ULL * 1024ULL;
+// Bytes in each buffer that input files are decompressed into (see `FileLines`)
+const uint64 in_buffer = 1024ULL * 1024ULL;
+
+/*
+ Bytes used by the Illumina quality samplers (probability, alias, and quality per
+ position and nucleotide).
+ These are shared by all haplotypes and threads.
+ `n_quals` is the number of possible quality values per read position.
+ */
+inline uint64 illumina_samplers(const uint64& n_read_ends,
+                                const uint64& read_length,
+                                const uint64& n_quals) {
+    return n_read_ends * 4ULL * read_length * n_quals *
+        (sizeof(double) + sizeof(uint64) + sizeof(uint8));
+}
+
+/*
+ Estimated peak memory used by one thread when simulating sequencing reads,
+ not including samplers shared among threads.
+ `max_chrom_size` is the largest chromosome each thread stores as a string
+ (0 for a reference).
+ */
+inline uint64 read_sim_thread(const uint64& read_pool_size,
+                              const uint64& read_bytes,
+                              const uint64& max_chrom_size) {
+    return read_pool(read_pool_size, read_bytes) + max_chrom_size;
+}
+
+}
+
+
+
+/*
+ Memory usage, separated by category.
+ Each class's `memory_usage` method only counts memory it owns on the heap,
+ so the container holding an object counts the object's own `sizeof`.
+ */
+struct MemoryUsage {
+
+    uint64 sequence = 0;    // nucleotides stored as full sequences
+    uint64 positions = 0;   // mutation positions
+    uint64 nucleos = 0;     // nucleotides stored inside mutations
+    uint64 names = 0;       // chromosome and haplotype names
+    uint64 overhead = 0;    // containers, pointers, and allocator bookkeeping
+
+    MemoryUsage& operator+=(const MemoryUsage& other) {
+        sequence += other.sequence;
+        positions += other.positions;
+        nucleos += other.nucleos;
+        names += other.names;
+        overhead += other.overhead;
+        return *this;
+    }
+
+    // For scaling up the usage of one object to many identical ones
+    MemoryUsage& operator*=(const uint64& n) {
+        sequence *= n;
+        positions *= n;
+        nucleos *= n;
+        names *= n;
+        overhead *= n;
+        return *this;
+    }
+
+    uint64 total() const noexcept {
+        return sequence + positions + nucleos + names + overhead;
+    }
+
+    /*
+     Add a string's heap memory, putting its characters into `payload`.
+     The version with sizes is for estimating usage before a string exists.
+     */
+    void add_string(const uint64& size, const uint64& capacity, uint64& payload) {
+        payload += size;
+        if (capacity > mem_usage::sso_capacity) {
+            overhead += mem_usage::malloc_chunk(capacity + 1) - size;
+        }
+        return;
+    }
+    void add_string(const std::string& x, uint64& payload) {
+        add_string(x.size(), x.capacity(), payload);
+        return;
+    }
+
+    /*
+     Add a std::deque's blocks and map (not including heap memory owned by its
+     elements), putting the bytes used by its elements into `payload`.
+     The version with sizes is for estimating usage before a deque exists.
+     */
+    void add_deque(const uint64& n, const uint64& elem_size, uint64& payload) {
+        uint64 n_blocks = mem_usage::deque_blocks(n, elem_size);
+        uint64 block_bytes = std::max(mem_usage::deque_block, elem_size);
+        uint64 map_size = std::max(mem_usage::deque_min_map, n_blocks + 2);
+        payload += n * elem_size;
+        overhead += n_blocks * mem_usage::malloc_chunk(block_bytes) - n * elem_size;
+        overhead += mem_usage::malloc_chunk(map_size * sizeof(void*));
+        return;
+    }
+    template <typename T>
+    void add_deque(const std::deque<T>& x, uint64& payload) {
+        add_deque(x.size(), sizeof(T), payload);
+        return;
+    }
+
+    /*
+     Add a std::vector's storage (not including heap memory owned by its elements),
+     putting the bytes used by its elements into `payload`.
+     */
+    void add_vector(const uint64& n, const uint64& capacity, const uint64& elem_size,
+                    uint64& payload) {
+        payload += n * elem_size;
+        overhead += mem_usage::malloc_chunk(capacity * elem_size) - n * elem_size;
+        return;
+    }
+    template <typename T>
+    void add_vector(const std::vector<T>& x, uint64& payload) {
+        add_vector(x.size(), x.capacity(), sizeof(T), payload);
+        return;
+    }
+
+    // Output as a named R vector (doubles bc numbers can exceed int limits)
+    NumericVector to_R() const {
+        NumericVector out = NumericVector::create(
+            _["sequence"] = static_cast<double>(sequence),
+            _["positions"] = static_cast<double>(positions),
+            _["nucleos"] = static_cast<double>(nucleos),
+            _["names"] = static_cast<double>(names),
+            _["overhead"] = static_cast<double>(overhead),
+            _["total"] = static_cast<double>(total()));
+        return out;
+    }
+
+};
+
+
+
+
+#endif
@@ -38,10 +38,11 @@ using namespace Rcpp;
 int TreeMutator::mutate(const double& b_len,
                         HapChrom& hap_chrom,
                         pcg64& eng,
-                        Progress& prog_bar,
+                        ProgressMonitor& prog_bar,
                         const uint64& begin,
                         uint64& end,
-                        std::deque<uint8>& rate_inds)  {
+                        std::deque<uint8>& rate_inds,
+                        RateMap& rate_map)  {
 
 #ifdef __JACKALOPE_DEBUG
     if (end < begin) stop("end < begin in TreeMutator.mutate");
@@ -50,11 +51,15 @@ int TreeMutator::mutate(const double& b_len,
 
     int status;
 
-    status = indels.add_indels(b_len, begin, end, rate_inds, subs, hap_chrom,
-                               eng, prog_bar);
-    if (status < 0) return status;
+    // (Skipped entirely when there are no indels)
+    if (indels.total_rate() > 0) {
+        status = indels.add_indels(b_len, begin, end, rate_inds, rate_map, subs,
+                                   hap_chrom, eng, prog_bar);
+        if (status < 0) return status;
+    }
 
-    status = subs.add_subs(b_len, begin, end, rate_inds, hap_chrom, eng, prog_bar);
+    status = subs.add_subs(b_len, begin, end, rate_inds, rate_map, hap_chrom, lanes,
+                           prog_bar);
 
     return status;
 }
@@ -18,11 +18,13 @@
 
 
 #include "jackalope_types.h" // integer types
+#include "progress_monitor.h"  // ProgressMonitor
 #include "hap_classes.h"  // Hap* classes
-#include "pcg.h"  // pcg seeding
+#include "pcg.h"  // pcg seeding, xoshiro256pp_x4
 #include "alias_sampler.h"  // alias method of sampling
 #include "mutator_subs.h"   // SubMutator
 #include "mutator_indels.h" // IndelMutator
+#include "rate_map.h"  // RateMap
 #include "io.h"  // FileUncomp
 #include "util.h"  // str_stop
 
@@ -44,6 +46,11 @@ struct TreeMutator {
     SubMutator subs;
     // For adding indels:
     IndelMutator indels;
+    /*
+     Block engine for substitutions and rate categories.
+     It's seeded once per thread (using `seed_lanes`) and reused for every branch.
+     */
+    xoshiro256pp_x4 lanes;
 
 
     TreeMutator() {}
@@ -61,14 +68,30 @@ struct TreeMutator {
           indels(insertion_rates, deletion_rates, epsilon, pi_tcag) {}
 
     TreeMutator(const TreeMutator& other)
-        : subs(other.subs), indels(other.indels) {}
+        : subs(other.subs), indels(other.indels), lanes(other.lanes) {}
 
     TreeMutator& operator=(const TreeMutator& other) {
         subs = other.subs;
         indels = other.indels;
+        lanes = other.lanes;
+        return *this;
+    }
+    TreeMutator(TreeMutator&& other) noexcept
+        : subs(std::move(other.subs)), indels(std::move(other.indels)),
+          lanes(other.lanes) {}
+    TreeMutator& operator=(TreeMutator&& other) noexcept {
+        subs = std::move(other.subs);
+        indels = std::move(other.indels);
+        lanes = other.lanes;
         return *this;
     }
 
+    // Seed `lanes` from a thread's engine:
+    void seed_lanes(pcg64& eng) {
+        lanes = xoshiro256pp_x4(engine_seeds(eng));
+        return;
+    }
+
     /*
      Add mutations for a branch within a range.
      It also updates `end` for indels that occur in the range.
@@ -77,17 +100,17 @@ struct TreeMutator {
     int mutate(const double& b_len,
                HapChrom& hap_chrom,
                pcg64& eng,
-               Progress& prog_bar,
+               ProgressMonitor& prog_bar,
                const uint64& begin,
                uint64& end,
-               std::deque<uint8>& rate_inds);
+               std::deque<uint8>& rate_inds,
+               RateMap& rate_map);
 
     int new_rates(const uint64& begin,
                   const uint64& end,
                   std::deque<uint8>& rate_inds,
-                  pcg64& eng,
-                  Progress& prog_bar) {
-        int status = subs.new_rates(begin, end, rate_inds, eng, prog_bar);
+                  ProgressMonitor& prog_bar) {
+        int status = subs.new_rates(begin, end, rate_inds, lanes, prog_bar);
         return status;
     }
 
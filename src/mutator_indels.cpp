@@ -32,25 +32,40 @@ inline void IndelMutator::one_indel__(const double& change,
                                       const uint64& begin,
                                       uint64& end,
                                       std::deque<uint8>& rate_inds,
+                                      RateMap& rate_map,
                                       SubMutator& subs,
                                       HapChrom& hap_chrom,
                                       pcg64& eng) {
 
     if (change > 0) {
         uint64 size = static_cast<uint64>(change);
-        uint64 pos = static_cast<uint64>(runif_01(eng) * (end - begin) + begin);
+        uint64 pos;
+        if (rate_map.empty()) {
+            pos = static_cast<uint64>(runif_01(eng) * (end - begin) + begin);
+        } else pos = rate_map.sample(eng) + begin;
         insert_str.clear();
-        for (uint32 j = 0; j < size; j++) insert_str += insert.sample(eng);
+        for (uint32 j = 0; j < size; j++) insert_str += model->insert.sample(eng);
         hap_chrom.add_insertion(insert_str, pos);
         subs.insertion_adjust(size, pos, begin, rate_inds, eng);
+        rate_map.insertion_adjust(size, pos - begin);
         end += size;
     } else {
         uint64 size = std::min(static_cast<uint64>(std::abs(change)),
                                end - begin);
-        uint64 pos = static_cast<uint64>(runif_01(eng) *
-            (end - begin - size + 1) + begin);
+        uint64 pos;
+        if (rate_map.empty()) {
+            pos = static_cast<uint64>(runif_01(eng) * (end - begin - size + 1) + begin);
+        } else {
+            /*
+             Starting positions follow the map, so deletions that would run past
+             the end are cut short there.
+             */
+            pos = rate_map.sample(eng) + begin;
+            size = std::min(size, end - pos);
+        }
         hap_chrom.add_deletion(size, pos);
         subs.deletion_adjust(size, pos, begin, rate_inds);
+        rate_map.deletion_adjust(size, pos - begin);
         end -= size;
     }
 
@@ -65,19 +80,23 @@ inline void IndelMutator::exact_sim(int& status,
                                     const uint64& begin,
                                     uint64& end,
                                     std::deque<uint8>& rate_inds,
+                                    RateMap& rate_map,
                                     SubMutator& subs,
                                     HapChrom& hap_chrom,
                                     pcg64& eng,
-                                    Progress& prog_bar) {
+                                    ProgressMonitor& prog_bar) {
 
 
     // For insertions:
     std::string insert_str;
-    insert_str.reserve(rates.n_elem / 2);
+    insert_str.reserve(model->rates.n_elem / 2);
 
     uint32 iters = 0;
 
-    double rate = total_rate * (end - begin);
+    // (With a rate map, the region's size is weighted by rate multipliers.)
+    double rate = model->total_rate *
+        (rate_map.empty() ? (end - begin) : rate_map.total_weight());
+    if (rate <= 0) return;
 
     jump_distr.param(std::exponential_distribution<double>::param_type(rate));
 
@@ -98,13 +117,16 @@ inline void IndelMutator::exact_sim(int& status,
             return;
         }
 
-        i = event_sampler.sample(eng);
+        i = model->event_sampler.sample(eng);
 
-        one_indel__(changes(i), insert_str, begin, end, rate_inds, subs, hap_chrom, eng);
+        one_indel__(model->changes(i), insert_str, begin, end, rate_inds, rate_map,
+                    subs, hap_chrom, eng);
 
         if (end == begin) return;
 
-        rate = total_rate * (end - begin);
+        rate = model->total_rate *
+            (rate_map.empty() ? (end - begin) : rate_map.total_weight());
+        if (rate <= 0) return;
         jump_distr.param(std::exponential_distribution<double>::param_type(rate));
         b_len -= jump_distr(eng);
 
@@ -120,12 +142,23 @@ inline void IndelMutator::exact_sim(int& status,
  - rates over the whole chromosome and `tau` time units (`rates_tau`)
  - new branch length after progressing `tau` time units (`b_len`)
  */
-void IndelMutator::calc_tau(double& b_len, HapChrom& hap_chrom) {
-
-    const double chrom_size(hap_chrom.chrom_size);
+void IndelMutator::calc_tau(double& b_len,
+                            HapChrom& hap_chrom,
+                            const uint64& begin,
+                            const uint64& end,
+                            const RateMap& rate_map) {
+
+    const arma::vec& changes(model->changes);
+    const double& eps(model->eps);
+
+    double chrom_size(hap_chrom.chrom_size);
+    // With a rate map, the region's size is weighted by rate multipliers:
+    if (!rate_map.empty()) {
+        chrom_size += rate_map.total_weight() - static_cast<double>(end - begin);
+    }
 
     // Now rates are in units of "indels per unit time" (NOT yet over `tau` time units):
-    rates_tau = rates * chrom_size;
+    rates_tau = model->rates * chrom_size;
 
     // For the expected number of bp changes per time over entire chromosome...
     double mu = arma::accu(changes % rates_tau);             // mean
@@ -154,10 +187,11 @@ int IndelMutator::add_indels(double b_len,
                              const uint64& begin,
                              uint64& end,
                              std::deque<uint8>& rate_inds,
+                             RateMap& rate_map,
                              SubMutator& subs,
                              HapChrom& hap_chrom,
                              pcg64& eng,
-                             Progress& prog_bar) {
+                             ProgressMonitor& prog_bar) {
 
 #ifdef __JACKALOPE_DEBUG
     if (b_len < 0) {
@@ -174,13 +208,14 @@ int IndelMutator::add_indels(double b_len,
     }
 #endif
 
-    if ((rates.n_elem == 0) || (b_len == 0) || (end == begin)) return 0;
+    if ((model->rates.n_elem == 0) || (b_len == 0) || (end == begin)) return 0;
     if (prog_bar.is_aborted() || prog_bar.check_abort()) return -1;
 
     // Doing exact simulation in this case
-    if (eps <= 0) {
+    if (model->eps <= 0) {
         int status = 0;
-        exact_sim(status, b_len, begin, end, rate_inds, subs, hap_chrom, eng, prog_bar);
+        exact_sim(status, b_len, begin, end, rate_inds, rate_map, subs, hap_chrom, eng,
+                  prog_bar);
         return status;
     }
 
@@ -188,7 +223,7 @@ int IndelMutator::add_indels(double b_len,
     std::vector<uint32> events;
     // For insertions:
     std::string insert_str;
-    insert_str.reserve(rates.n_elem / 2);
+    insert_str.reserve(model->rates.n_elem / 2);
 
     uint32 iters = 0;
 
@@ -205,7 +240,7 @@ int IndelMutator::add_indels(double b_len,
          ----------------
          */
 
-        calc_tau(b_len, hap_chrom);
+        calc_tau(b_len, hap_chrom, begin, end, rate_map);
 
 #ifdef __JACKALOPE_DIAGNOSTICS
         csize = hap_chrom.size();
@@ -245,7 +280,7 @@ int IndelMutator::add_indels(double b_len,
         for (uint32 i = 0; i < events.size(); i++) {
 
             // The amount that this indel-type changes the chromosome size:
-            double& change(changes(events[i]));
+            const double& change(model->changes(events[i]));
 
 #ifdef __JACKALOPE_DEBUG
             if (change == 0) stop("change == 0 inside add_indels");
@@ -254,7 +289,8 @@ int IndelMutator::add_indels(double b_len,
             // Check for user interrupt every 1000 indels:
             if (interrupt_check(iters, prog_bar)) return -1;
 
-            one_indel__(change, insert_str, begin, end, rate_inds, subs, hap_chrom, eng);
+            one_indel__(change, insert_str, begin, end, rate_inds, rate_map, subs,
+                        hap_chrom, eng);
 
             if (end == begin) return 0;
 
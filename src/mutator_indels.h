@@ -15,14 +15,17 @@
 #include <vector>  // vector class
 #include <string>  // string class
 #include <random>  // poisson_distribution
+#include <memory>  // shared_ptr
 
 
 #include "jackalope_types.h" // integer types
+#include "progress_monitor.h"  // ProgressMonitor
 #include "hap_classes.h"  // Hap* classes
 #include "pcg.h"  // pcg seeding
 #include "alias_sampler.h"  // alias method of sampling
 #include "util.h"  // str_stop
 #include "mutator_subs.h"  // SubMutator
+#include "rate_map.h"  // RateMap
 
 
 
@@ -33,9 +36,11 @@ using namespace Rcpp;
 
 
 
-class IndelMutator {
-
-public:
+/*
+ The parts of an indel model that don't change while evolving chromosomes.
+ Like `SubModel`, one of these is shared by all copies of an `IndelMutator`.
+ */
+struct IndelModel {
 
     // Rates for each type of indel of each size, per bp per unit time:
     arma::vec rates;
@@ -47,26 +52,22 @@ public:
      */
     double eps;
     // For creating insertion sequences:
-    AliasStringSampler<std::string> insert;
+    NucleoSampler insert;
     // For total rate of all events if doing exact simulations
     double total_rate;
     // For sampling which event occurred if doing exact simulations
     AliasSampler event_sampler;
 
-    IndelMutator() {}
-    IndelMutator(const arma::vec& insertion_rates,
-                 const arma::vec& deletion_rates,
-                 const double& epsilon,
-                 const std::vector<double>& pi_tcag)
+    IndelModel(const arma::vec& insertion_rates,
+               const arma::vec& deletion_rates,
+               const double& epsilon,
+               const std::vector<double>& pi_tcag)
         : rates(insertion_rates.n_elem + deletion_rates.n_elem),
           changes(insertion_rates.n_elem + deletion_rates.n_elem),
           eps(epsilon),
           insert("TCAG", pi_tcag),
           total_rate(0),
-          event_sampler(),
-          tau(0),
-          rates_tau(insertion_rates.n_elem + deletion_rates.n_elem),
-          n_events(insertion_rates.n_elem + deletion_rates.n_elem) {
+          event_sampler() {
 
         uint32 n = insertion_rates.n_elem;
         uint32 m = deletion_rates.n_elem;
@@ -86,24 +87,56 @@ public:
 
     }
 
+};
+
+
+
+
+class IndelMutator {
+
+public:
+
+    // Shared model:
+    std::shared_ptr<const IndelModel> model;
+
+    IndelMutator() {}
+    IndelMutator(const arma::vec& insertion_rates,
+                 const arma::vec& deletion_rates,
+                 const double& epsilon,
+                 const std::vector<double>& pi_tcag)
+        : model(std::make_shared<const IndelModel>(insertion_rates, deletion_rates,
+                                                   epsilon, pi_tcag)),
+          tau(0),
+          rates_tau(insertion_rates.n_elem + deletion_rates.n_elem),
+          n_events(insertion_rates.n_elem + deletion_rates.n_elem) {}
+
     IndelMutator(const IndelMutator& other)
-        : rates(other.rates), changes(other.changes), eps(other.eps),
-          insert(other.insert), total_rate(other.total_rate),
-          event_sampler(other.event_sampler), tau(other.tau),
+        : model(other.model), tau(other.tau),
           rates_tau(other.rates_tau), n_events(other.n_events) {}
 
     IndelMutator& operator=(const IndelMutator& other) {
-        rates = other.rates;
-        changes = other.changes;
-        eps = other.eps;
-        insert = other.insert;
-        total_rate = other.total_rate;
-        event_sampler = other.event_sampler;
+        model = other.model;
         tau = other.tau;
         rates_tau = other.rates_tau;
         n_events = other.n_events;
         return *this;
     }
+    IndelMutator(IndelMutator&& other) noexcept
+        : model(std::move(other.model)), tau(other.tau),
+          rates_tau(std::move(other.rates_tau)), n_events(std::move(other.n_events)) {}
+    IndelMutator& operator=(IndelMutator&& other) noexcept {
+        model = std::move(other.model);
+        tau = other.tau;
+        rates_tau = std::move(other.rates_tau);
+        n_events = std::move(other.n_events);
+        return *this;
+    }
+
+    // Total rate of all indels (zero when there aren't any or there's no model):
+    inline double total_rate() const {
+        if (!model) return 0;
+        return model->total_rate;
+    }
 
 
     // Add indels, adjust `end` (`end == begin` when chromosome region is of size zero)
@@ -111,16 +144,18 @@ public:
                    const uint64& begin,
                    uint64& end,
                    std::deque<uint8>& rate_inds,
+                   RateMap& rate_map,
                    SubMutator& subs,
                    HapChrom& hap_chrom,
                    pcg64& eng,
-                   Progress& prog_bar);
+                   ProgressMonitor& prog_bar);
 
 
 private:
 
 
-    void calc_tau(double& b_len, HapChrom& hap_chrom);
+    void calc_tau(double& b_len, HapChrom& hap_chrom, const uint64& begin,
+                  const uint64& end, const RateMap& rate_map);
 
     // For generating # events per time period:
     std::poisson_distribution<uint32> distr = std::poisson_distribution<uint32>(1);
@@ -141,6 +176,7 @@ private:
                             const uint64& begin,
                             uint64& end,
                             std::deque<uint8>& rate_inds,
+                            RateMap& rate_map,
                             SubMutator& subs,
                             HapChrom& hap_chrom,
                             pcg64& eng);
@@ -152,10 +188,11 @@ private:
                           const uint64& begin,
                           uint64& end,
                           std::deque<uint8>& rate_inds,
+                          RateMap& rate_map,
                           SubMutator& subs,
                           HapChrom& hap_chrom,
                           pcg64& eng,
-                          Progress& prog_bar);
+                          ProgressMonitor& prog_bar);
 
 };
 
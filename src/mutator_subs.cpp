@@ -7,6 +7,7 @@
 #include <progress.hpp>  // for the progress bar
 #include <vector>  // vector class
 #include <string>  // string class
+#include <map>  // map
 
 
 #include "mutator_subs.h" // SubMutator
@@ -24,10 +25,10 @@ using namespace Rcpp;
 int SubMutator::new_rates(const uint64& begin,
                           const uint64& end,
                           std::deque<uint8>& rate_inds,
-                          pcg64& eng,
-                          Progress& prog_bar) {
+                          xoshiro256pp_x4& lanes,
+                          ProgressMonitor& prog_bar) {
 
-    if (!site_var) {
+    if (!site_var || stateless) {
         if (!rate_inds.empty()) {
             rate_inds.clear();
         }
@@ -35,7 +36,7 @@ int SubMutator::new_rates(const uint64& begin,
     }
 
     // (Gammas go from 0 to (n-1), invariants are n.)
-    const uint8 n = Q.size();
+    const uint8 n = model->Q.size();
 
     const uint64 N = end - begin;
     const uint64 N0 = rate_inds.size();
@@ -51,10 +52,10 @@ int SubMutator::new_rates(const uint64& begin,
         clear_memory<std::deque<uint8>>(rate_inds);
     }
 
-    if (invariant <= 0) {
+    if (model->invariant <= 0) {
 
         for (uint64 i = 0; i < rate_inds.size(); i++) {
-            rate_inds[i] = static_cast<uint8>(runif_01(eng) * n);
+            rate_inds[i] = static_cast<uint8>(runif_01(lanes) * n);
             if (interrupt_check(iters, prog_bar)) return -1;
 #ifdef __JACKALOPE_DIAGNOSTICS
             // This will be invisible without being converted to unsigned
@@ -62,7 +63,7 @@ int SubMutator::new_rates(const uint64& begin,
 #endif
         }
         while (rate_inds.size() < N) {
-            rate_inds.push_back(static_cast<uint8>(runif_01(eng) * n));
+            rate_inds.push_back(static_cast<uint8>(runif_01(lanes) * n));
             if (interrupt_check(iters, prog_bar)) return -1;
 #ifdef __JACKALOPE_DIAGNOSTICS
             Rcout << static_cast<unsigned>(rate_inds.back()) << ' ';
@@ -72,8 +73,8 @@ int SubMutator::new_rates(const uint64& begin,
     } else {
 
         for (uint64 i = 0; i < rate_inds.size(); i++) {
-            if (runif_01(eng) > invariant) {
-                rate_inds[i] = static_cast<uint8>(runif_01(eng) * n);
+            if (runif_01(lanes) > model->invariant) {
+                rate_inds[i] = static_cast<uint8>(runif_01(lanes) * n);
             } else rate_inds[i] = n;
             if (interrupt_check(iters, prog_bar)) return -1;
 #ifdef __JACKALOPE_DIAGNOSTICS
@@ -81,8 +82,8 @@ int SubMutator::new_rates(const uint64& begin,
 #endif
         }
         while (rate_inds.size() < N) {
-            if (runif_01(eng) > invariant) {
-                rate_inds.push_back(static_cast<uint8>(runif_01(eng) * n));
+            if (runif_01(lanes) > model->invariant) {
+                rate_inds.push_back(static_cast<uint8>(runif_01(lanes) * n));
             } else rate_inds.push_back(n);
             if (interrupt_check(iters, prog_bar)) return -1;
 #ifdef __JACKALOPE_DIAGNOSTICS
@@ -103,42 +104,56 @@ int SubMutator::new_rates(const uint64& begin,
 
 
 
-inline void SubMutator::adjust_mats(const double& b_len) {
+void SubMutator::calc_Pt(const double& b_len, std::vector<arma::mat>& Pt_) const {
+
+    const std::vector<arma::mat>& Q(model->Q);
+    const std::vector<arma::mat>& U(model->U);
+    const std::vector<arma::mat>& Ui(model->Ui);
+    const std::vector<arma::vec>& L(model->L);
+
+    if (Pt_.size() != Q.size()) Pt_.resize(Q.size(), arma::mat(4,4));
 
     // UNREST model
     if (U.size() == 0) {
         for (uint32 i = 0; i < Q.size(); i++) {
             // Adjust P(t) matrix using repeated matrix squaring
-            Pt_calc(Q[i], 30, b_len, Pt[i]);
-            // Now adjust the alias samplers:
-            std::vector<AliasSampler>& samp(samplers[i]);
-#ifdef __JACKALOPE_DEBUG
-            if (samp.size() != 4) stop("SubMutator::adjust_mats-> samp.size() != 4");
-#endif
-            for (uint32 j = 0; j < 4; j++) {
-                samp[j] = AliasSampler(Pt[i].row(j));
-            }
+            Pt_calc(Q[i], 30, b_len, Pt_[i]);
         }
     } else {
 #ifdef __JACKALOPE_DEBUG
-        if (U.size() != Q.size()) stop("SubMutator::adjust_mats-> U.size() != Q.size()");
+        if (U.size() != Q.size()) stop("SubMutator::calc_Pt-> U.size() != Q.size()");
         if (Ui.size() != Q.size()) {
-            stop("SubMutator::adjust_mats-> Ui.size() != Q.size()");
+            stop("SubMutator::calc_Pt-> Ui.size() != Q.size()");
         }
-        if (L.size() != Q.size()) stop("SubMutator::adjust_mats-> L.size() != Q.size()");
+        if (L.size() != Q.size()) stop("SubMutator::calc_Pt-> L.size() != Q.size()");
 #endif
         // All other models
         for (uint32 i = 0; i < Q.size(); i++) {
             // Adjust P(t) matrix using eigenvalues and eigenvectors in U, Ui, and L
-            Pt_calc(U[i], Ui[i], L[i], b_len, Pt[i]);
-            // Now adjust the alias samplers:
-            std::vector<AliasSampler>& samp(samplers[i]);
-#ifdef __JACKALOPE_DEBUG
-            if (samp.size() != 4) stop("SubMutator::adjust_mats-> samp.size() != 4");
-#endif
-            for (uint32 j = 0; j < 4; j++) {
-                samp[j] = AliasSampler(Pt[i].row(j));
-            }
+            Pt_calc(U[i], Ui[i], L[i], b_len, Pt_[i]);
+        }
+    }
+
+    return;
+}
+
+
+
+inline void SubMutator::adjust_mats(const double& b_len) {
+    make_samplers(b_len, samplers);
+    return;
+}
+
+inline void SubMutator::make_samplers(const double& b_len, SamplerSet& samps) {
+
+    calc_Pt(b_len, Pt);
+
+    // Now adjust the alias samplers:
+    if (samps.size() != model->Q.size()) samps.resize(model->Q.size());
+    for (uint32 i = 0; i < model->Q.size(); i++) {
+        std::array<FixedAliasSampler<4>, 4>& samp(samps[i]);
+        for (uint32 j = 0; j < 4; j++) {
+            samp[j] = FixedAliasSampler<4>(Pt[i].row(j));
         }
     }
 
@@ -157,12 +172,13 @@ inline void SubMutator::subs_before_muts__(const uint64& pos,
                                            uint64& mut_i,
                                            const std::string& bases,
                                            const uint8& rate_i,
+                                           const SamplerSet& samps,
                                            HapChrom& hap_chrom,
-                                           pcg64& eng) {
+                                           xoshiro256pp_x4& eng) {
 
-    const uint8& c_i(char_map[hap_chrom.ref_chrom->nucleos[pos]]);
+    const uint8& c_i(model->char_map[hap_chrom.ref_chrom->nucleos[pos]]);
     if (c_i > 3) return; // only changing T, C, A, or G
-    AliasSampler& samp(samplers[rate_i][c_i]);
+    const FixedAliasSampler<4>& samp(samps[rate_i][c_i]);
     uint8 nt_i = samp.sample(eng);
     if (nt_i != c_i) {
 #ifdef __JACKALOPE_DIAGNOSTICS
@@ -182,63 +198,37 @@ inline void SubMutator::subs_before_muts__(const uint64& pos,
 //'
 //' @noRd
 //'
+template <typename R, bool invariants>
 inline int SubMutator::subs_before_muts(const uint64& begin,
                                         const uint64& end,
+                                        const uint64& rate_begin,
                                         uint64& mut_i,
                                         const uint8& max_gamma,
                                         const std::string& bases,
+                                        const SamplerSet& samps,
                                         const std::deque<uint8>& rate_inds,
                                         HapChrom& hap_chrom,
-                                        pcg64& eng,
-                                        Progress& prog_bar,
+                                        xoshiro256pp_x4& eng,
+                                        ProgressMonitor& prog_bar,
                                         uint32& iters) {
 
-#ifdef __JACKALOPE_DEBUG
-    if (rate_inds.empty() && max_gamma > 1) {
-        stop("rate_inds shouldn't be empty when max_gamma > 1");
-    }
-    if (rate_inds.empty() && invariant > 0) {
-        stop("rate_inds shouldn't be empty when invariant > 0");
-    }
-#endif
-
     uint64 size = end - begin;
     uint64 pos;
 
-    if (site_var) {
-
-        // Going backwards from `end-1` to `begin` so we can add to front of `mutations`
-        for (uint64 i = 1; i <= size; i++) {
-
-            pos = end - i;
-
-            const uint8& rate_i(rate_inds[(pos-begin)]);
-            if (rate_i > max_gamma) continue; // this is an invariant region
-
-            subs_before_muts__(pos, mut_i, bases, rate_i, hap_chrom, eng);
-
-            if (interrupt_check(iters, prog_bar)) return -1;
-
-        }
-
-
-    } else {
-
-        const uint8 rate_i = 0;
-
-        for (uint64 i = 1; i <= size; i++) {
+    // Going backwards from `end-1` to `begin` so we can add to front of `mutations`
+    for (uint64 i = 1; i <= size; i++) {
 
-            pos = end - i;
+        pos = end - i;
 
-            subs_before_muts__(pos, mut_i, bases, rate_i, hap_chrom, eng);
+        const uint8 rate_i = R::before_muts(*this, pos, rate_begin, rate_inds);
+        if (invariants && rate_i > max_gamma) continue; // this is an invariant region
 
-            if (interrupt_check(iters, prog_bar)) return -1;
+        subs_before_muts__(pos, mut_i, bases, rate_i, samps, hap_chrom, eng);
 
-        }
+        if (interrupt_check(iters, prog_bar)) return -1;
 
     }
 
-
     return 0;
 
 }
@@ -251,17 +241,18 @@ inline void SubMutator::subs_after_muts__(const uint64& pos,
                                           uint64& mut_i,
                                           const std::string& bases,
                                           const uint8& rate_i,
+                                          const SamplerSet& samps,
                                           HapChrom& hap_chrom,
-                                          pcg64& eng) {
+                                          xoshiro256pp_x4& eng) {
 
 
     AllMutations& mutations(hap_chrom.mutations);
     const std::string& reference(hap_chrom.ref_chrom->nucleos);
 
-    const uint8& c_i(char_map[hap_chrom.get_char_(pos, mut_i)]);
+    const uint8& c_i(model->char_map[hap_chrom.get_char_(pos, mut_i)]);
     if (c_i > 3) return; // only changing T, C, A, or G
 
-    AliasSampler& samp(samplers[rate_i][c_i]);
+    const FixedAliasSampler<4>& samp(samps[rate_i][c_i]);
     uint8 nt_i = samp.sample(eng);
     const char& nucleo(bases[nt_i]);
 
@@ -315,52 +306,38 @@ inline void SubMutator::subs_after_muts__(const uint64& pos,
 //'
 //' @noRd
 //'
+template <typename R, bool invariants>
 inline int SubMutator::subs_after_muts(uint64& pos,
-                                       const uint64& begin,
+                                       const uint64& rate_begin,
                                        const uint64& end1,
                                        const uint64& end2,
                                        uint64& mut_i,
                                        const uint8& max_gamma,
                                        const std::string& bases,
+                                       const SamplerSet& samps,
                                        const std::deque<uint8>& rate_inds,
                                        HapChrom& hap_chrom,
-                                       pcg64& eng,
-                                       Progress& prog_bar,
+                                       xoshiro256pp_x4& eng,
+                                       ProgressMonitor& prog_bar,
                                        uint32& iters) {
 
     uint64 end = std::min(end1, end2);
 
-    if (site_var) {
-
-        while (pos < end) {
-
-            const uint8& rate_i(rate_inds[(pos-begin)]);
-            if (rate_i > max_gamma) {
-                pos++;
-                continue; // this is an invariant region
-            }
-
-            subs_after_muts__(pos, mut_i, bases, rate_i, hap_chrom, eng);
-            ++pos;
-            if (interrupt_check(iters, prog_bar)) return -1;
+    while (pos < end) {
 
+        const uint8 rate_i = R::after_muts(*this, pos, mut_i, hap_chrom, rate_begin,
+                                           rate_inds);
+        if (invariants && rate_i > max_gamma) {
+            pos++;
+            continue; // this is an invariant region
         }
 
-    } else {
-
-        const uint8 rate_i = 0;
-
-        while (pos < end) {
-
-            subs_after_muts__(pos, mut_i, bases, rate_i, hap_chrom, eng);
-            ++pos;
-            if (interrupt_check(iters, prog_bar)) return -1;
-
-        }
+        subs_after_muts__(pos, mut_i, bases, rate_i, samps, hap_chrom, eng);
+        ++pos;
+        if (interrupt_check(iters, prog_bar)) return -1;
 
     }
 
-
     return 0;
 
 }
@@ -381,9 +358,10 @@ int SubMutator::add_subs(const double& b_len,
                          const uint64& begin,
                          const uint64& end,
                          const std::deque<uint8>& rate_inds,
+                         const RateMap& rate_map,
                          HapChrom& hap_chrom,
-                         pcg64& eng,
-                         Progress& prog_bar) {
+                         xoshiro256pp_x4& lanes,
+                         ProgressMonitor& prog_bar) {
 
     if ((b_len == 0) || (end == begin)) return 0;
 
@@ -400,14 +378,112 @@ int SubMutator::add_subs(const double& b_len,
         Rcout << std::endl << end << ' ' << hap_chrom.size() << std::endl;
         stop("end > hap_chrom.size() in add_subs");
     }
+    if (!rate_map.empty() && rate_map.total_length() != (end - begin)) {
+        stop("rate_map.total_length() != (end - begin) in add_subs");
+    }
+    if (site_var && !stateless && rate_inds.empty()) {
+        stop("rate_inds shouldn't be empty with among-site variability");
+    }
 #endif
 
 
     if (prog_bar.is_aborted() || prog_bar.check_abort()) return -1;
 
-    adjust_mats(b_len);
+    // Pick the kernel for this kind of among-site variability:
+    if (!site_var) {
+        return add_subs_<UniformRates, false>(b_len, begin, end, rate_inds, rate_map,
+                                              hap_chrom, lanes, prog_bar);
+    }
+    if (stateless) {
+        if (model->invariant > 0) {
+            return add_subs_<HashedRates, true>(b_len, begin, end, rate_inds, rate_map,
+                                                hap_chrom, lanes, prog_bar);
+        }
+        return add_subs_<HashedRates, false>(b_len, begin, end, rate_inds, rate_map,
+                                             hap_chrom, lanes, prog_bar);
+    }
+    if (model->invariant > 0) {
+        return add_subs_<StoredRates, true>(b_len, begin, end, rate_inds, rate_map,
+                                            hap_chrom, lanes, prog_bar);
+    }
+    return add_subs_<StoredRates, false>(b_len, begin, end, rate_inds, rate_map,
+                                         hap_chrom, lanes, prog_bar);
+
+}
+
+
+
+//' Add substitutions using one kind of among-site variability.
+//'
+//' With a rate map, each of its segments is done separately with the branch
+//' length scaled by that segment's multiplier.
+//'
+//' @noRd
+//'
+template <typename R, bool invariants>
+int SubMutator::add_subs_(const double& b_len,
+                          const uint64& begin,
+                          const uint64& end,
+                          const std::deque<uint8>& rate_inds,
+                          const RateMap& rate_map,
+                          HapChrom& hap_chrom,
+                          xoshiro256pp_x4& eng,
+                          ProgressMonitor& prog_bar) {
+
+    if (rate_map.empty()) {
+        adjust_mats(b_len);
+        return subs_range<R, invariants>(begin, end, begin, samplers, rate_inds,
+                                         hap_chrom, eng, prog_bar);
+    }
+
+    int status = 0;
+    uint64 seg_begin = begin;
+
+    // Samplers by multiplier, since many segments usually share them:
+    std::map<double, SamplerSet> mult_samplers;
+
+    for (uint64 i = 0; i < rate_map.size() && seg_begin < end; i++) {
+
+        uint64 seg_end = std::min(seg_begin + rate_map.length(i), end);
+        const double& mult(rate_map.mult(i));
+
+        if (seg_end > seg_begin && mult > 0) {
+            if (mult_samplers.find(mult) == mult_samplers.end()) {
+                make_samplers(b_len * mult, mult_samplers[mult]);
+            }
+            status = subs_range<R, invariants>(seg_begin, seg_end, begin,
+                                               mult_samplers[mult], rate_inds,
+                                               hap_chrom, eng, prog_bar);
+            if (status < 0) return status;
+        }
+
+        seg_begin = seg_end;
+    }
+
+    return status;
+
+}
+
+
 
-    uint8 max_gamma = Q.size() - 1; // any rate_inds above this means an invariant region
+//' Add substitutions from `begin` to `end` after `adjust_mats` has been run.
+//'
+//' `rate_begin` is the position that `rate_inds` starts at.
+//'
+//' @noRd
+//'
+template <typename R, bool invariants>
+int SubMutator::subs_range(const uint64& begin,
+                           const uint64& end,
+                           const uint64& rate_begin,
+                           const SamplerSet& samps,
+                           const std::deque<uint8>& rate_inds,
+                           HapChrom& hap_chrom,
+                           xoshiro256pp_x4& eng,
+                           ProgressMonitor& prog_bar) {
+
+    // (any rate_inds above this means an invariant region)
+    uint8 max_gamma = model->Q.size() - 1;
     std::string bases = "TCAG";
 
     // To make code less clunky:
@@ -426,8 +502,9 @@ int SubMutator::add_subs(const double& b_len,
      */
     if (mutations.empty() || ((end-1) < mutations.new_pos.front())) {
 
-        status = subs_before_muts(begin, end, mut_i, max_gamma, bases, rate_inds,
-                                  hap_chrom, eng, prog_bar, iters);
+        status = subs_before_muts<R, invariants>(begin, end, rate_begin, mut_i,
+                                                 max_gamma, bases, samps, rate_inds,
+                                                 hap_chrom, eng, prog_bar, iters);
         return status;
 
     }
@@ -448,8 +525,9 @@ int SubMutator::add_subs(const double& b_len,
         mut_i = 0;
         // This is the end for now, but will be `pos` below:
         pos = mutations.new_pos[mut_i];
-        status = subs_before_muts(begin, pos, mut_i, max_gamma, bases,
-                                  rate_inds, hap_chrom, eng, prog_bar, iters);
+        status = subs_before_muts<R, invariants>(begin, pos, rate_begin, mut_i,
+                                                 max_gamma, bases, samps, rate_inds,
+                                                 hap_chrom, eng, prog_bar, iters);
 
         if (status < 0) return status;
 
@@ -463,9 +541,10 @@ int SubMutator::add_subs(const double& b_len,
     uint64 next_mut_i = mut_i + 1;
     while (pos < end && next_mut_i < mutations.size()) {
 
-        status = subs_after_muts(pos, begin, end, mutations.new_pos[next_mut_i], mut_i,
-                                 max_gamma, bases, rate_inds, hap_chrom, eng, prog_bar,
-                                 iters);
+        status = subs_after_muts<R, invariants>(pos, rate_begin, end,
+                                                mutations.new_pos[next_mut_i], mut_i,
+                                                max_gamma, bases, samps, rate_inds,
+                                                hap_chrom, eng, prog_bar, iters);
 
         if (status < 0) return status;
 
@@ -474,9 +553,9 @@ int SubMutator::add_subs(const double& b_len,
     }
 
     // Now taking care of nucleotides after the last Mutation
-    status = subs_after_muts(pos, begin, end, hap_chrom.chrom_size, mut_i,
-                             max_gamma, bases, rate_inds, hap_chrom, eng, prog_bar,
-                             iters);
+    status = subs_after_muts<R, invariants>(pos, rate_begin, end, hap_chrom.chrom_size,
+                                            mut_i, max_gamma, bases, samps, rate_inds,
+                                            hap_chrom, eng, prog_bar, iters);
 
     return status;
 
@@ -495,7 +574,7 @@ void SubMutator::deletion_adjust(const uint64& size,
                                  const uint64& begin,
                                  std::deque<uint8>& rate_inds) {
 
-    if (!site_var) return;
+    if (!site_var || stateless) return;
 
     // Because rate_inds is from `begin` to `end` only
     pos -= begin;
@@ -515,7 +594,7 @@ void SubMutator::insertion_adjust(const uint64& size,
                                   std::deque<uint8>& rate_inds,
                                   pcg64& eng) {
 
-    if (!site_var) return;
+    if (!site_var || stateless) return;
 
     /*
      Because `deque::insert` will insert items before `pos`, and we want it after
@@ -526,9 +605,9 @@ void SubMutator::insertion_adjust(const uint64& size,
     pos -= begin;
 
     // (Gammas go from 0 to (n-1), invariants are n.)
-    const uint8 n = Q.size();
+    const uint8 n = model->Q.size();
 
-    if (invariant <= 0) {
+    if (model->invariant <= 0) {
 
         for (uint64 i = 0; i < size; i++) {
             rate_inds.insert(rate_inds.begin() + pos,
@@ -538,7 +617,7 @@ void SubMutator::insertion_adjust(const uint64& size,
     } else {
 
         for (uint64 i = 0; i < size; i++) {
-            if (runif_01(eng) > invariant) {
+            if (runif_01(eng) > model->invariant) {
                 rate_inds.insert(rate_inds.begin() + pos,
                                  static_cast<uint8>(runif_01(eng) * n));
             } else rate_inds.insert(rate_inds.begin() + pos, n);
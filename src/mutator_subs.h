@@ -14,13 +14,17 @@
 #include <progress.hpp>  // for the progress bar
 #include <vector>  // vector class
 #include <string>  // string class
+#include <array>  // array class
+#include <memory>  // shared_ptr
 
 
 #include "jackalope_types.h" // integer types
+#include "progress_monitor.h"  // ProgressMonitor
 #include "hap_classes.h"  // Hap* classes
-#include "pcg.h"  // pcg seeding
+#include "pcg.h"  // pcg seeding, splitmix64
 #include "alias_sampler.h"  // alias method of sampling
 #include "util.h"  // str_stop
+#include "rate_map.h"  // RateMap
 
 
 
@@ -41,18 +45,54 @@ inline std::vector<uint8> make_char_map() {
 
 
 
-class SubMutator {
 
-public:
+/*
+ The parts of a substitution model that don't change while evolving chromosomes.
+ One of these is shared by all copies of a `SubMutator` (e.g., across chromosomes
+ and threads), so copies only hold what changes with each branch.
+ */
+struct SubModel {
 
     std::vector<arma::mat> Q;
     std::vector<arma::mat> U;
     std::vector<arma::mat> Ui;
     std::vector<arma::vec> L;
     double invariant;
-    const std::vector<uint8> char_map = make_char_map();
-    std::vector<std::vector<AliasSampler>> samplers;
+    std::vector<uint8> char_map;
+
+    SubModel(const std::vector<arma::mat>& Q_,
+             const std::vector<arma::mat>& U_,
+             const std::vector<arma::mat>& Ui_,
+             const std::vector<arma::vec>& L_,
+             const double& invariant_)
+        : Q(Q_), U(U_), Ui(Ui_), L(L_), invariant(invariant_),
+          char_map(make_char_map()) {}
+
+};
+
+
+
+
+class SubMutator {
+
+public:
+
+    // Alias samplers for each rate category, then for each starting nucleotide:
+    typedef std::vector<std::array<FixedAliasSampler<4>, 4>> SamplerSet;
+
+    // Shared model:
+    std::shared_ptr<const SubModel> model;
+    // Samplers and P(t) matrices for the current branch:
+    SamplerSet samplers;
     std::vector<arma::mat> Pt;
+    /*
+     If `stateless`, rate categories aren't stored in `rate_inds`, and each site's
+     category is instead a hash of `rate_seed`, `rate_chrom` (chromosome index),
+     and where the site came from (see `site_rate`).
+     */
+    bool stateless = false;
+    uint64 rate_seed = 0;
+    uint64 rate_chrom = 0;
 
 
     SubMutator() {}
@@ -61,8 +101,8 @@ public:
                const std::vector<arma::mat>& Ui_,
                const std::vector<arma::vec>& L_,
                const double& invariant_)
-        : Q(Q_), U(U_), Ui(Ui_), L(L_), invariant(invariant_),
-          samplers(Q_.size(), std::vector<AliasSampler>(4)),
+        : model(std::make_shared<const SubModel>(Q_, U_, Ui_, L_, invariant_)),
+          samplers(Q_.size()),
           Pt(Q_.size(), arma::mat(4,4)),
           site_var(((invariant_ > 0) || (Q_.size() > 1)) ? true : false) {
 #ifdef __JACKALOPE_DEBUG
@@ -76,36 +116,139 @@ public:
 
 
     SubMutator(const SubMutator& other)
-        : Q(other.Q), U(other.U), Ui(other.Ui), L(other.L), invariant(other.invariant),
-          samplers(other.samplers), Pt(other.Pt),
+        : model(other.model), samplers(other.samplers), Pt(other.Pt),
+          stateless(other.stateless), rate_seed(other.rate_seed),
+          rate_chrom(other.rate_chrom),
           site_var(other.site_var) {};
 
     SubMutator& operator=(const SubMutator& other) {
-        Q = other.Q;
-        U = other.U;
-        Ui = other.Ui;
-        L = other.L;
-        invariant = other.invariant;
+        model = other.model;
         samplers = other.samplers;
         Pt = other.Pt;
+        stateless = other.stateless;
+        rate_seed = other.rate_seed;
+        rate_chrom = other.rate_chrom;
+        site_var = other.site_var;
+        return *this;
+    }
+    SubMutator(SubMutator&& other) noexcept
+        : model(std::move(other.model)),
+          samplers(std::move(other.samplers)), Pt(std::move(other.Pt)),
+          stateless(other.stateless), rate_seed(other.rate_seed),
+          rate_chrom(other.rate_chrom),
+          site_var(other.site_var) {}
+    SubMutator& operator=(SubMutator&& other) noexcept {
+        model = std::move(other.model);
+        samplers = std::move(other.samplers);
+        Pt = std::move(other.Pt);
+        stateless = other.stateless;
+        rate_seed = other.rate_seed;
+        rate_chrom = other.rate_chrom;
         site_var = other.site_var;
         return *this;
     }
 
 
+    /*
+     Rate category for a site when `stateless`.
+     Sites from the reference are identified by their reference position and
+     `offset == 0`.
+     Inserted bases are identified by the reference position they were inserted
+     after and their 1-based position within the insertion.
+     (Gammas go from 0 to (n-1), invariants are n.)
+     */
+    inline uint8 site_rate(const uint64& old_pos, const uint64& offset) const {
+        if (!site_var) return 0;
+        uint64 h = splitmix64(rate_seed ^ splitmix64(rate_chrom));
+        h = splitmix64(h ^ old_pos);
+        h = splitmix64(h ^ offset);
+        const uint64 n = model->Q.size();
+        if (model->invariant > 0) {
+            // Top 53 bits to a uniform number in [0,1):
+            double u = static_cast<double>(h >> 11) / 9007199254740992.0;
+            if (u < model->invariant) return static_cast<uint8>(n);
+            h = splitmix64(h);
+        }
+        return static_cast<uint8>(((h >> 32) * n) >> 32);
+    }
+
+    /*
+     Policies for where substitution kernels get each site's rate category.
+     Kernels are instantiated for each, so their per-site loops don't check
+     which kind of among-site variability is used.
+     `before_muts` is for positions before any mutations, and `after_muts` for
+     positions at or after mutation `mut_i` but before the next one.
+     */
+    // No among-site variability, so all sites are in category 0:
+    struct UniformRates {
+        static inline uint8 before_muts(const SubMutator& subs,
+                                        const uint64& pos,
+                                        const uint64& rate_begin,
+                                        const std::deque<uint8>& rate_inds) {
+            return 0;
+        }
+        static inline uint8 after_muts(const SubMutator& subs,
+                                       const uint64& pos,
+                                       const uint64& mut_i,
+                                       const HapChrom& hap_chrom,
+                                       const uint64& rate_begin,
+                                       const std::deque<uint8>& rate_inds) {
+            return 0;
+        }
+    };
+    // Categories stored in `rate_inds`:
+    struct StoredRates {
+        static inline uint8 before_muts(const SubMutator& subs,
+                                        const uint64& pos,
+                                        const uint64& rate_begin,
+                                        const std::deque<uint8>& rate_inds) {
+            return rate_inds[pos - rate_begin];
+        }
+        static inline uint8 after_muts(const SubMutator& subs,
+                                       const uint64& pos,
+                                       const uint64& mut_i,
+                                       const HapChrom& hap_chrom,
+                                       const uint64& rate_begin,
+                                       const std::deque<uint8>& rate_inds) {
+            return rate_inds[pos - rate_begin];
+        }
+    };
+    // Categories from `site_rate` (when `stateless`):
+    struct HashedRates {
+        static inline uint8 before_muts(const SubMutator& subs,
+                                        const uint64& pos,
+                                        const uint64& rate_begin,
+                                        const std::deque<uint8>& rate_inds) {
+            // (No mutations before `pos`, so it's also the reference position)
+            return subs.site_rate(pos, 0);
+        }
+        static inline uint8 after_muts(const SubMutator& subs,
+                                       const uint64& pos,
+                                       const uint64& mut_i,
+                                       const HapChrom& hap_chrom,
+                                       const uint64& rate_begin,
+                                       const std::deque<uint8>& rate_inds) {
+            return subs.site_rate_after_muts(pos, mut_i, hap_chrom);
+        }
+    };
+
+    // Fill one P(t) matrix per rate category for a branch length:
+    void calc_Pt(const double& b_len, std::vector<arma::mat>& Pt_) const;
+
     int new_rates(const uint64& begin,
                   const uint64& end,
                   std::deque<uint8>& rate_inds,
-                  pcg64& eng,
-                  Progress& prog_bar);
+                  xoshiro256pp_x4& eng,
+                  ProgressMonitor& prog_bar);
 
     int add_subs(const double& b_len,
                  const uint64& begin,
                  const uint64& end,
                  const std::deque<uint8>& rate_inds,
+                 const RateMap& rate_map,
                  HapChrom& hap_chrom,
-                 pcg64& eng,
-                 Progress& prog_bar);
+                 xoshiro256pp_x4& eng,
+                 ProgressMonitor& prog_bar);
 
     // Adjust rate_inds for indels:
     void deletion_adjust(const uint64& size, uint64 pos, const uint64& begin,
@@ -119,41 +262,91 @@ private:
     bool site_var; // for whether to include among-site variability
 
     inline void adjust_mats(const double& b_len);
+    // Same as above, but filling `samps` instead of `samplers`:
+    inline void make_samplers(const double& b_len, SamplerSet& samps);
+
+    /*
+     Substitution kernels, instantiated once for each rate policy (see above) and
+     for whether there are invariant sites.
+     `add_subs` picks one of them for each call.
+     They draw from the block engine passed to `add_subs` (one per thread).
+     */
+    template <typename R, bool invariants>
+    int add_subs_(const double& b_len,
+                  const uint64& begin,
+                  const uint64& end,
+                  const std::deque<uint8>& rate_inds,
+                  const RateMap& rate_map,
+                  HapChrom& hap_chrom,
+                  xoshiro256pp_x4& eng,
+                  ProgressMonitor& prog_bar);
+    template <typename R, bool invariants>
+    int subs_range(const uint64& begin,
+                   const uint64& end,
+                   const uint64& rate_begin,
+                   const SamplerSet& samps,
+                   const std::deque<uint8>& rate_inds,
+                   HapChrom& hap_chrom,
+                   xoshiro256pp_x4& eng,
+                   ProgressMonitor& prog_bar);
 
     inline void subs_before_muts__(const uint64& pos,
                                    uint64& mut_i,
                                    const std::string& bases,
                                    const uint8& rate_i,
+                                   const SamplerSet& samps,
                                    HapChrom& hap_chrom,
-                                   pcg64& eng);
+                                   xoshiro256pp_x4& eng);
+    template <typename R, bool invariants>
     inline int subs_before_muts(const uint64& begin,
                                 const uint64& end,
+                                const uint64& rate_begin,
                                 uint64& mut_i,
                                 const uint8& max_gamma,
                                 const std::string& bases,
+                                const SamplerSet& samps,
                                 const std::deque<uint8>& rate_inds,
                                 HapChrom& hap_chrom,
-                                pcg64& eng,
-                                Progress& prog_bar,
+                                xoshiro256pp_x4& eng,
+                                ProgressMonitor& prog_bar,
                                 uint32& iters);
 
+    // Rate category (when `stateless`) for a position at or after mutation `mut_i`
+    // but before the next one:
+    inline uint8 site_rate_after_muts(const uint64& pos,
+                                      const uint64& mut_i,
+                                      const HapChrom& hap_chrom) const {
+        const AllMutations& mutations(hap_chrom.mutations);
+        sint64 ind = pos - mutations.new_pos[mut_i];
+        sint64 size_mod = hap_chrom.size_modifier(mut_i);
+        // Within a substitution or insertion:
+        if (size_mod >= 0 && ind <= size_mod) {
+            return site_rate(mutations.old_pos[mut_i], ind);
+        }
+        // In the reference chromosome following the mutation:
+        return site_rate(ind + (mutations.old_pos[mut_i] - size_mod), 0);
+    }
+
     inline void subs_after_muts__(const uint64& pos,
                                   uint64& mut_i,
                                   const std::string& bases,
                                   const uint8& rate_i,
+                                  const SamplerSet& samps,
                                   HapChrom& hap_chrom,
-                                  pcg64& eng);
+                                  xoshiro256pp_x4& eng);
+    template <typename R, bool invariants>
     inline int subs_after_muts(uint64& pos,
-                               const uint64& begin,
+                               const uint64& rate_begin,
                                const uint64& end1,
                                const uint64& end2,
                                uint64& mut_i,
                                const uint8& max_gamma,
                                const std::string& bases,
+                               const SamplerSet& samps,
                                const std::deque<uint8>& rate_inds,
                                HapChrom& hap_chrom,
-                               pcg64& eng,
-                               Progress& prog_bar,
+                               xoshiro256pp_x4& eng,
+                               ProgressMonitor& prog_bar,
                                uint32& iters);
 
 
@@ -47,6 +47,13 @@ struct MutationInfo {
         length = other.length;
         return *this;
     }
+    MutationInfo(MutationInfo&& other) noexcept
+        : nucleo(std::move(other.nucleo)), length(other.length) {}
+    MutationInfo& operator=(MutationInfo&& other) noexcept {
+        nucleo = std::move(other.nucleo);
+        length = other.length;
+        return *this;
+    }
 
     // Initialize from an index and mut-lengths vector
     MutationInfo (const uint64& ind, const std::vector<sint64>& mut_lengths)
@@ -113,6 +120,16 @@ public:
         base_inds = make_base_inds();
         return *this;
     }
+    MutationTypeSampler(MutationTypeSampler&& other) noexcept
+        : sampler(std::move(other.sampler)),
+          mut_lengths(std::move(other.mut_lengths)),
+          base_inds(std::move(other.base_inds)) {}
+    MutationTypeSampler& operator=(MutationTypeSampler&& other) noexcept {
+        sampler = std::move(other.sampler);
+        mut_lengths = std::move(other.mut_lengths);
+        base_inds = std::move(other.base_inds);
+        return *this;
+    }
 
     /*
      Sample a mutation based on an input nucleotide.
@@ -72,6 +72,25 @@ inline pcg64 seeded_pcg() {
     return out;
 }
 
+// 8 32-bit seeds (like from `mt_seeds`) drawn from another engine
+template <typename E>
+inline std::vector<uint64> engine_seeds(E& eng) {
+    std::vector<uint64> sub_seeds(8);
+    for (uint64& s : sub_seeds) s = static_cast<uint64>(eng()) >> 32;
+    return sub_seeds;
+}
+
+/*
+ splitmix64 finalizer, used to hash site IDs into rate categories and to
+ turn seeds into engine states.
+ */
+inline uint64 splitmix64(uint64 x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
 // sub_seeds needs to be at least 8-long!
 inline pcg64 seeded_pcg(const std::vector<uint64>& sub_seeds) {
 
@@ -88,6 +107,174 @@ inline pcg64 seeded_pcg(const std::vector<uint64>& sub_seeds) {
 
 
 
+/*
+ ========================
+
+ Other engines
+
+ ========================
+ */
+
+/*
+ xoshiro256++ (Blackman and Vigna 2019).
+ It only uses shifts, rotations, and additions, so it's faster than `pcg64`
+ (which needs a 128-bit multiply for every number) but still passes BigCrush.
+ It has the same interface as the pcg engines, so it can be used anywhere they can.
+ */
+class xoshiro256pp {
+
+public:
+
+    typedef uint64 result_type;
+
+    xoshiro256pp() : s{1, 2, 3, 4} {}
+    // Like `seeded_pcg`, sub_seeds needs to be at least 8-long!
+    xoshiro256pp(const std::vector<uint64>& sub_seeds) {
+        // Mixed using splitmix64 so the state is never all zeros:
+        uint64 x = 0;
+        for (uint64 i = 0; i < 4; i++) {
+            x ^= (sub_seeds[2*i]<<32) + sub_seeds[2*i+1];
+            s[i] = splitmix64(x);
+            x += 0x9e3779b97f4a7c15ULL;
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~static_cast<result_type>(0); }
+
+    inline result_type operator()() {
+        const uint64 out = rotl(s[0] + s[3], 23) + s[0];
+        const uint64 t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return out;
+    }
+
+private:
+
+    uint64 s[4];
+
+    static inline uint64 rotl(const uint64& x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+};
+
+
+
+/*
+ Four xoshiro256++ streams run side by side, making numbers in blocks.
+
+ Drawing one number at a time keeps the engine's state in a dependency chain,
+ so only one number is made at once.
+ Here, each refill makes `block_size` numbers from four independent lanes,
+ and the loop over lanes has no branches or dependencies between iterations,
+ so compilers turn it into SIMD instructions (e.g., 4 lanes with AVX2).
+ Draws are then just a read from the buffer and one (well predicted) branch.
+ Objects are ~2 kB, so make one per thread and reuse it.
+ */
+class xoshiro256pp_x4 {
+
+public:
+
+    typedef uint64 result_type;
+
+    static constexpr uint64 n_lanes = 4;
+    static constexpr uint64 block_size = 256;
+
+    xoshiro256pp_x4() : xoshiro256pp_x4(std::vector<uint64>(8, 0)) {}
+    // Like `seeded_pcg`, sub_seeds needs to be at least 8-long!
+    xoshiro256pp_x4(const std::vector<uint64>& sub_seeds) : ind(block_size) {
+        uint64 x = 0;
+        for (uint64 k = 0; k < 4; k++) {
+            x ^= (sub_seeds[2*k]<<32) + sub_seeds[2*k+1];
+            for (uint64 j = 0; j < n_lanes; j++) {
+                s[k][j] = splitmix64(x);
+                x += 0x9e3779b97f4a7c15ULL;
+            }
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~static_cast<result_type>(0); }
+
+    inline result_type operator()() {
+        if (ind == block_size) refill();
+        return block[ind++];
+    }
+
+    // Uniform number in range (0,1) from the top 53 bits:
+    inline double unif() {
+        return (static_cast<double>((*this)() >> 11) + 0.5) *
+            (1.0 / 9007199254740992.0);
+    }
+
+private:
+
+    uint64 s[4][n_lanes];   // state word by lane
+    uint64 block[block_size];
+    uint64 ind;             // index for the next draw from `block`
+
+    void refill() {
+        for (uint64 i = 0; i < block_size; i += n_lanes) {
+            for (uint64 j = 0; j < n_lanes; j++) {
+                const uint64 x = s[0][j] + s[3][j];
+                block[i+j] = ((x << 23) | (x >> 41)) + s[0][j];
+                const uint64 t = s[1][j] << 17;
+                s[2][j] ^= s[0][j];
+                s[3][j] ^= s[1][j];
+                s[1][j] ^= s[2][j];
+                s[0][j] ^= s[3][j];
+                s[2][j] ^= t;
+                s[3][j] = (s[3][j] << 45) | (s[3][j] >> 19);
+            }
+        }
+        ind = 0;
+        return;
+    }
+
+};
+
+
+
+/*
+ Make an engine of type `E` from 8 32-bit seeds, as from `mt_seeds`.
+ `E` can be `pcg64`, `pcg64_fast`, `xoshiro256pp`, or `xoshiro256pp_x4`.
+ */
+template <typename E>
+inline E seeded_engine(const std::vector<uint64>& sub_seeds);
+
+template <>
+inline pcg64 seeded_engine<pcg64>(const std::vector<uint64>& sub_seeds) {
+    return seeded_pcg(sub_seeds);
+}
+template <>
+inline pcg64_fast seeded_engine<pcg64_fast>(const std::vector<uint64>& sub_seeds) {
+    uint128 seed1;
+    uint128 seed2;
+    fill_seeds(sub_seeds, seed1, seed2);
+    // (This engine has no stream, so it only takes one seed)
+    pcg64_fast out(seed1 ^ seed2);
+    return out;
+}
+template <>
+inline xoshiro256pp seeded_engine<xoshiro256pp>(const std::vector<uint64>& sub_seeds) {
+    return xoshiro256pp(sub_seeds);
+}
+template <>
+inline xoshiro256pp_x4 seeded_engine<xoshiro256pp_x4>(
+        const std::vector<uint64>& sub_seeds) {
+    return xoshiro256pp_x4(sub_seeds);
+}
+
+
+
+
+
 /*
  ========================
 
@@ -95,13 +282,24 @@ inline pcg64 seeded_pcg(const std::vector<uint64>& sub_seeds) {
 
  ========================
  */
+/*
+ These work for any engine `E` that, like `pcg64`, returns 64 random bits.
+ */
 // uniform in range (0,1)
-inline long double runif_01(pcg64& eng) {
+template <typename E>
+inline long double runif_01(E& eng) {
+    static_assert(E::min() == 0 && E::max() == ~static_cast<uint64>(0),
+                  "RNG engines must return 64 random bits");
     return (static_cast<long double>(eng()) + 1) / (pcg::max64 + 2);
 }
+// Block engines convert from their buffers without long doubles
+inline long double runif_01(xoshiro256pp_x4& eng) {
+    return eng.unif();
+}
 // uniform in range (a,b)
-inline long double runif_ab(pcg64& eng, const long double& a, const long double& b) {
-    return a + ((static_cast<long double>(eng()) + 1) / (pcg::max64 + 2)) * (b - a);
+template <typename E>
+inline long double runif_ab(E& eng, const long double& a, const long double& b) {
+    return a + runif_01(eng) * (b - a);
 }
 
 
@@ -15,6 +15,8 @@
 #include <string>  // string class
 #include <algorithm>  // lower_bound, sort
 #include <deque>  // deque
+#include <cmath>  // log, log1p
+#include <map>  // map
 #include <progress.hpp>  // for the progress bar
 #ifdef _OPENMP
 #include <omp.h>  // omp
@@ -25,7 +27,7 @@
 #include "mutator.h"  // TreeMutator
 #include "pcg.h" // pcg sampler types
 #include "phylogenomics.h"
-#include "util.h"  // thread_check
+#include "util.h"  // thread_check, chrom_batches
 
 
 using namespace Rcpp;
@@ -36,6 +38,91 @@ using namespace Rcpp;
 
 
 
+/*
+ Make samplers for evolving one tree site by site.
+ */
+SiteMajorSampler::SiteMajorSampler(const PhyloTree& tree,
+                                   const SubMutator& subs,
+                                   const double& rate_mult)
+    : n_cats(subs.model->Q.size()),
+      n_edges(tree.n_edges),
+      edges(tree.edges),
+      zero_len(tree.n_edges),
+      p_vars(n_cats * 4U, 0),
+      first_change(n_cats * 4U),
+      samplers(n_edges * n_cats * 4U),
+      change_samplers(n_edges * n_cats * 4U) {
+
+    // For each rate category and nucleotide, the probability of reaching each edge
+    // without changing, and of first changing on each edge:
+    std::vector<double> stay_prob(n_cats * 4U, 1);
+    std::vector<std::vector<double>> change_probs(n_cats * 4U,
+                                                  std::vector<double>(n_edges, 0));
+
+    std::vector<arma::mat> Pt;
+
+    for (uint64 e = 0; e < n_edges; e++) {
+
+        zero_len[e] = (tree.branch_lens[e] * rate_mult) <= 0;
+        if (zero_len[e]) continue;
+
+        subs.calc_Pt(tree.branch_lens[e] * rate_mult, Pt);
+
+        for (uint64 k = 0; k < n_cats; k++) {
+            for (uint64 c = 0; c < 4; c++) {
+                arma::rowvec row = Pt[k].row(c);
+                // (Rounding error can make some values slightly negative.)
+                for (double& x : row) if (x < 0) x = 0;
+                double total = arma::accu(row);
+                uint64 j = (e * n_cats + k) * 4U + c;
+                samplers[j] = FixedAliasSampler<4>(row);
+                double change = (total - row(c)) / total;
+                if (change <= 0) continue;
+                row(c) = 0;
+                change_samplers[j] = FixedAliasSampler<4>(row);
+                uint64 kc = k * 4U + c;
+                change_probs[kc][e] = stay_prob[kc] * change;
+                stay_prob[kc] *= (1 - change);
+            }
+        }
+    }
+
+    for (uint64 kc = 0; kc < (n_cats * 4U); kc++) {
+        const std::vector<double>& probs(change_probs[kc]);
+        for (const double& p : probs) p_vars[kc] += p;
+        if (p_vars[kc] > 0) first_change[kc] = AliasSampler(probs);
+        if (p_vars[kc] > p_max) p_max = p_vars[kc];
+    }
+
+}
+
+
+void SiteMajorSampler::sample_site(const uint8& c,
+                                   const uint8& k,
+                                   std::vector<uint8>& states,
+                                   pcg64& eng) const {
+
+    uint64 e = first_change[k * 4U + c].sample(eng);
+
+    // All tips are still `c` at the first edge where it changes:
+    states[edges(e,1)] = change_samplers[(e * n_cats + k) * 4U + c].sample(eng);
+
+    for (++e; e < n_edges; e++) {
+        const uint64& b1(edges(e,0));
+        const uint64& b2(edges(e,1));
+        if (b1 != b2) states[b2] = states[b1];
+        if (zero_len[e] || states[b2] > 3) continue;
+        states[b2] = samplers[(e * n_cats + k) * 4U + states[b2]].sample(eng);
+    }
+
+    return;
+}
+
+
+
+
+
+
 /*
  Process one phylogenetic tree for a single chromosome with no recombination.
 
@@ -45,7 +132,7 @@ using namespace Rcpp;
  */
 int PhyloOneChrom::one_tree(const uint64& idx,
                             pcg64& eng,
-                            Progress& prog_bar) {
+                            ProgressMonitor& prog_bar) {
 
 
     PhyloTree& tree(trees[idx]);
@@ -82,8 +169,9 @@ int PhyloOneChrom::one_tree(const uint64& idx,
             // HapChrom object that parent node refers to:
             HapChrom& chrom1(*(tip_chroms[b1]));
 
-            // Update rate indices:
+            // Update rate indices and map:
             rates[b2] = rates[b1];
+            rate_maps[b2] = rate_maps[b1];
 
             /*
              Update HapChrom objects for this branch.
@@ -107,8 +195,9 @@ int PhyloOneChrom::one_tree(const uint64& idx,
 #ifdef __JACKALOPE_DIAGNOSTICS
         Rcout << "** b_len " << b_len << std::endl;
 #endif
-        status = mutator.mutate(b_len, chrom2, eng, prog_bar,
-                                tree.starts[b2], tree.ends[b2], rates[b2]);
+        status = mutator->mutate(b_len, chrom2, eng, prog_bar,
+                                 tree.starts[b2], tree.ends[b2], rates[b2],
+                                 rate_maps[b2]);
         if (status < 0) return status;
 
     }
@@ -132,12 +221,180 @@ int PhyloOneChrom::one_tree(const uint64& idx,
 
 
 
+/*
+ Process one phylogenetic tree for a single chromosome, site by site.
+
+ This is only used without indels, and it assumes that none of these HapChroms
+ have mutations at or after this tree's starting position.
+ With a rate map, each segment is done separately using samplers for its multiplier.
+ */
+int PhyloOneChrom::one_tree_sites(const uint64& idx,
+                                  pcg64& eng,
+                                  ProgressMonitor& prog_bar) {
+
+    PhyloTree& tree(trees[idx]);
+
+    // Rate categories are the same for all nodes without indels:
+    int status = reset(tree, eng, prog_bar);
+    if (status < 0) return status;
+    uint64 root = tree.edges(0,0);
+    const std::deque<uint8>& rate_inds(rates[root]);
+    const RateMap& map(rate_maps[root]);
+
+    std::vector<uint8> states(tree.n_tips);
+    uint32 iters = 0;
+
+    if (map.empty()) {
+
+        const SiteMajorSampler sampler(tree, mutator->subs);
+        status = sites_range(tree, sampler, tree.start, tree.end, rate_inds, states,
+                             eng, prog_bar, iters);
+        if (status < 0) return status;
+
+    } else {
+
+        // Samplers by multiplier, since many segments usually share them:
+        std::map<double, SiteMajorSampler> samplers;
+
+        uint64 seg_begin = tree.start;
+        for (uint64 i = 0; i < map.size(); i++) {
+            uint64 seg_end = seg_begin + map.length(i);
+            const double& mult(map.mult(i));
+            if (seg_end > seg_begin && mult > 0) {
+                if (samplers.find(mult) == samplers.end()) {
+                    samplers[mult] = SiteMajorSampler(tree, mutator->subs, mult);
+                }
+                status = sites_range(tree, samplers[mult], seg_begin, seg_end,
+                                     rate_inds, states, eng, prog_bar, iters);
+                if (status < 0) return status;
+            }
+            seg_begin = seg_end;
+        }
+
+    }
+
+    // Update indices (non-inclusive) for end of this tree's mutations in
+    // `HapChrom::mutations`:
+    for (uint64 i = 0; i < tree.n_tips; i++) {
+        tree.mut_ends[i] = tip_chroms[i]->mutations.size();
+    }
+
+    // Update progress bar:
+    prog_bar.increment(tree.end - tree.start + 1);
+
+    return 0;
+
+}
+
+
+/*
+ Evolve sites from `begin` to `end` (non-inclusive) for `one_tree_sites`.
+ */
+template <typename R>
+int PhyloOneChrom::sites_range_(const PhyloTree& tree,
+                                const SiteMajorSampler& sampler,
+                                const uint64& begin,
+                                const uint64& end,
+                                const std::deque<uint8>& rate_inds,
+                                std::vector<uint8>& states,
+                                pcg64& eng,
+                                ProgressMonitor& prog_bar,
+                                uint32& iters) {
+
+    const double& p_max(sampler.p_max);
+
+    const std::string& reference(tip_chroms[0]->ref_chrom->nucleos);
+    const std::vector<uint8>& char_map(mutator->subs.model->char_map);
+    const uint8 max_gamma = mutator->subs.model->Q.size() - 1;
+    const std::string bases = "TCAG";
+
+    // (`log(1 - p_max)`, for geometric jumps between sites that might change)
+    const double log_stay = (p_max < 1) ? std::log1p(-p_max) : 0;
+
+    uint64 pos = begin;
+    while (p_max > 0 && pos < end) {
+
+        if (p_max < 1) {
+            double jump = std::log(static_cast<double>(runif_01(eng))) / log_stay;
+            if (jump >= static_cast<double>(end - pos)) break;
+            pos += static_cast<uint64>(jump);
+        }
+
+        const uint8& c(char_map[reference[pos]]);
+        const uint8 k = R::before_muts(mutator->subs, pos, tree.start, rate_inds);
+
+        // Only T, C, A, or G not in invariant regions can change, and this
+        // is thinned from `p_max` to this site's probability:
+        if (c < 4 && k <= max_gamma &&
+            runif_01(eng) * p_max < sampler.p_var(c, k)) {
+
+            std::fill(states.begin(), states.end(), c);
+            sampler.sample_site(c, k, states, eng);
+
+            for (uint64 i = 0; i < tree.n_tips; i++) {
+                if (states[i] == c) continue;
+#ifdef __JACKALOPE_DIAGNOSTICS
+                // __ <tip> <pos> <rate index> <old nucleotide>-<new nucleotide>
+                Rcout << "__ " << i << ' ' << pos << ' ' << static_cast<unsigned>(k) <<
+                    ' ' << bases[c] << '-' << bases[states[i]] << std::endl;
+#endif
+                tip_chroms[i]->mutations.push_back(pos, pos, bases[states[i]]);
+            }
+        }
+
+        ++pos;
+        if (interrupt_check(iters, prog_bar)) return -1;
+    }
+
+    return 0;
+
+}
+
+
+
+
+
+
+
+// Pick the rate policy for `sites_range_`:
+int PhyloOneChrom::sites_range(const PhyloTree& tree,
+                               const SiteMajorSampler& sampler,
+                               const uint64& begin,
+                               const uint64& end,
+                               const std::deque<uint8>& rate_inds,
+                               std::vector<uint8>& states,
+                               pcg64& eng,
+                               ProgressMonitor& prog_bar,
+                               uint32& iters) {
+
+    if (mutator->subs.stateless) {
+        return sites_range_<SubMutator::HashedRates>(tree, sampler, begin, end,
+                                                     rate_inds, states, eng,
+                                                     prog_bar, iters);
+    }
+    // (`rate_inds` is empty without among-site variability)
+    if (rate_inds.empty()) {
+        return sites_range_<SubMutator::UniformRates>(tree, sampler, begin, end,
+                                                      rate_inds, states, eng,
+                                                      prog_bar, iters);
+    }
+    return sites_range_<SubMutator::StoredRates>(tree, sampler, begin, end, rate_inds,
+                                                 states, eng, prog_bar, iters);
+
+}
+
+
+
+
+
+
+
 /*
  Reset for a new tree:
  */
 int PhyloOneChrom::reset(const PhyloTree& tree,
                          pcg64& eng,
-                         Progress& prog_bar) {
+                         ProgressMonitor& prog_bar) {
 
     const uint64& start(tree.start);
     const uint64& end(tree.end);
@@ -148,9 +405,14 @@ int PhyloOneChrom::reset(const PhyloTree& tree,
 
     // Create rates:
     if (rates.size() != n_tips) rates.resize(n_tips);
+    if (rate_maps.size() != n_tips) rate_maps.resize(n_tips);
     uint64 root = tree.edges(0,0); // <-- should be index to root of tree
+    // Rate map for this tree's region:
+    if (!rate_map.empty()) {
+        rate_maps[root] = rate_map.slice(start, end);
+    } else rate_maps[root] = RateMap();
     // Generate rates for root of tree (`status` is -1 if user interrupts process):
-    int status = mutator.new_rates(start, end, rates[root], eng, prog_bar);
+    int status = mutator->new_rates(start, end, rates[root], prog_bar);
     // The rest of the nodes/tips will have rates based on parent nodes
     // as we progress through the tree.
 
@@ -204,12 +466,13 @@ void PhyloOneChrom::fill_tree_mutator(const List& genome_phylo_info,
         }
 
         n_bases_[j] = as<uint64>(phylo_info["n_bases"]);
-        branch_lens_[j] = branch_lens;
-        edges_[j] = edges;
-        tip_labels_[j] = tip_labels;
+        branch_lens_[j] = std::move(branch_lens);
+        edges_[j] = std::move(edges);
+        tip_labels_[j] = std::move(tip_labels);
     }
 
 
+    // (Moved rather than copied into this object)
     *this = PhyloOneChrom(n_bases_, branch_lens_, edges_, tip_labels_, mutator_base);
 
     return;
@@ -223,8 +486,11 @@ void PhyloOneChrom::fill_tree_mutator(const List& genome_phylo_info,
 /*
  Evolve all trees.
  */
-int PhyloOneChrom::evolve(pcg64& eng,
-                          Progress& prog_bar) {
+int PhyloOneChrom::evolve(TreeMutator& mutator_,
+                          pcg64& eng,
+                          ProgressMonitor& prog_bar) {
+
+    mutator = &mutator_;
 
     for (uint64 i = 0; i < trees.size(); i++) {
 
@@ -239,7 +505,10 @@ int PhyloOneChrom::evolve(pcg64& eng,
         Rcout << "-- tree " << i << std::endl;
 #endif
 
-        int status = one_tree(i, eng, prog_bar);
+        int status;
+        if (site_major) {
+            status = one_tree_sites(i, eng, prog_bar);
+        } else status = one_tree(i, eng, prog_bar);
         if (status < 0) return status;
     }
 
@@ -251,7 +520,10 @@ int PhyloOneChrom::evolve(pcg64& eng,
 
 
 
-PhyloInfo::PhyloInfo(const List& genome_phylo_info, const TreeMutator& mutator_base) {
+PhyloInfo::PhyloInfo(const List& genome_phylo_info,
+                     const TreeMutator& mutator_base_,
+                     const List& rate_maps)
+    : phylo_one_chroms(), mutator_base(mutator_base_) {
 
     uint64 n_chroms = genome_phylo_info.size();
 
@@ -262,10 +534,25 @@ PhyloInfo::PhyloInfo(const List& genome_phylo_info, const TreeMutator& mutator_b
 
     phylo_one_chroms = std::vector<PhyloOneChrom>(n_chroms);
 
-    // Fill tree and mutator info (i.e., everything but haplotype info):
+    // Fill tree info (i.e., everything but haplotype info):
     for (uint64 i = 0; i < n_chroms; i++) {
         phylo_one_chroms[i].fill_tree_mutator(genome_phylo_info, i, mutator_base);
     }
+
+    // Rate maps, if provided (an empty map means uniform rates):
+    if (rate_maps.size() > 0) {
+        if (static_cast<uint64>(rate_maps.size()) != n_chroms) {
+            std::string err_msg = "\n# items in rate maps must be of same length as ";
+            err_msg += "# chromosomes in phylo. info";
+            throw(Rcpp::exception(err_msg.c_str(), false));
+        }
+        for (uint64 i = 0; i < n_chroms; i++) {
+            const List& map_i(rate_maps[i]);
+            std::vector<uint64> lens = as<std::vector<uint64>>(map_i["lens"]);
+            std::vector<double> mults = as<std::vector<double>>(map_i["mults"]);
+            phylo_one_chroms[i].rate_map = RateMap(lens, mults);
+        }
+    }
 }
 
 
@@ -287,12 +574,13 @@ XPtr<HapSet> PhyloInfo::evolve_chroms(
     // (I'm simply extracting tip labels from the first tree, as they should all be
     // the same due to the process_phy function in R/create_haplotypes.R)
     XPtr<HapSet> hap_set(new HapSet(*ref_genome, phylo_one_chroms[0].trees[0].tip_labels),
-                         true);
+                         true, R_NilValue, ref_genome_ptr);
 
     uint64 n_chroms = ref_genome->size();
     uint64 total_chrom = ref_genome->total_size;
 
     Progress prog_bar(total_chrom, show_progress);
+    ProgressMonitor monitor(prog_bar, n_threads);
     std::vector<int> status_codes(n_threads, 0);
 
 
@@ -301,10 +589,23 @@ XPtr<HapSet> PhyloInfo::evolve_chroms(
         err_msg += "# chromosomes in reference genome";
         throw(Rcpp::exception(err_msg.c_str(), false));
     }
+    for (uint64 i = 0; i < n_chroms; i++) {
+        const RateMap& map(phylo_one_chroms[i].rate_map);
+        if (!map.empty() && map.total_length() != (*ref_genome)[i].size()) {
+            std::string err_msg = "\nRate map for chromosome " + std::to_string(i+1);
+            err_msg += " doesn't cover the whole chromosome";
+            throw(Rcpp::exception(err_msg.c_str(), false));
+        }
+    }
 
     // Generate seeds for random number generators (1 RNG per thread)
     const std::vector<std::vector<uint64>> seeds = mt_seeds(n_threads);
 
+    // Batches of chromosomes to evolve together:
+    const std::vector<uint64> batches = chrom_batches(ref_genome->chrom_sizes(),
+                                                      n_threads);
+    const uint64 n_batches = batches.size() - 1;
+
 #ifdef _OPENMP
 #pragma omp parallel default(shared) num_threads(n_threads) if (n_threads > 1)
 {
@@ -323,28 +624,40 @@ XPtr<HapSet> PhyloInfo::evolve_chroms(
 
     pcg64 eng = seeded_pcg(active_seeds);
 
-    // Parallelize the Loop
+    // Scratch space for mutations on this thread:
+    TreeMutator mutator(mutator_base);
+    mutator.seed_lanes(eng);
+
+    // Parallelize the Loop (no barrier at the end so the master thread can monitor)
 #ifdef _OPENMP
-#pragma omp for schedule(static)
+#pragma omp for schedule(static) nowait
 #endif
-    for (uint64 i = 0; i < n_chroms; i++) {
+    for (uint64 b = 0; b < n_batches; b++) {
+
+        for (uint64 i = batches[b]; i < batches[b+1]; i++) {
 
-        if (status_code != 0) continue;
+            if (status_code != 0) break;
 
 #ifdef __JACKALOPE_DIAGNOSTICS
-        Rcout << std::endl << ">> chrom " << i << std::endl;
+            Rcout << std::endl << ">> chrom " << i << std::endl;
 #endif
 
-        PhyloOneChrom& chrom_phylo(phylo_one_chroms[i]);
+            PhyloOneChrom& chrom_phylo(phylo_one_chroms[i]);
+
+            // Set values for haplotype info:
+            chrom_phylo.set_hap_info(*hap_set, i);
+            // For stateless rate categories:
+            mutator.subs.rate_chrom = i;
 
-        // Set values for haplotype info:
-        chrom_phylo.set_hap_info(*hap_set, i);
+            // Evolve the chromosome using the chrom_phylo object:
+            status_code = chrom_phylo.evolve(mutator, eng, monitor);
 
-        // Evolve the chromosome using the chrom_phylo object:
-        status_code = chrom_phylo.evolve(eng, prog_bar);
+        }
 
     }
 
+    monitor.finish();
+
 #ifdef _OPENMP
 }
 #endif
@@ -386,6 +699,8 @@ SEXP evolve_across_trees(
         const arma::vec& deletion_rates,
         const double& epsilon,
         const std::vector<double>& pi_tcag,
+        const bool& stateless_rates,
+        const List& rate_maps,
         uint64 n_threads,
         const bool& show_progress) {
 
@@ -397,6 +712,11 @@ SEXP evolve_across_trees(
     // Now create mutation sampler:
     TreeMutator mutator(Q, U, Ui, L, invariant,
                         insertion_rates, deletion_rates, epsilon, pi_tcag);
+    if (stateless_rates) {
+        mutator.subs.stateless = true;
+        pcg64 eng = seeded_pcg();
+        mutator.subs.rate_seed = eng();
+    }
 
 
     // Create phylogenetic tree object:
@@ -404,7 +724,7 @@ SEXP evolve_across_trees(
         throw(Rcpp::exception("\nEmpty list provided for phylogenetic information.",
                               false));
     }
-    PhyloInfo phylo_info(genome_phylo_info, mutator);
+    PhyloInfo phylo_info(genome_phylo_info, mutator, rate_maps);
 
     /*
      Now that we have tree(s) and mutator info, we can create haplotypes:
@@ -25,8 +25,10 @@
 #endif
 
 #include "jackalope_types.h"  // integer types
+#include "progress_monitor.h"  // ProgressMonitor
 #include "hap_classes.h"  // Hap* classes
 #include "mutator.h"  // TreeMutator
+#include "rate_map.h"  // RateMap
 #include "alias_sampler.h" // alias sampling
 #include "pcg.h" // pcg sampler types
 
@@ -100,10 +102,89 @@ struct PhyloTree {
         n_edges = other.n_edges;
         return *this;
     }
+    PhyloTree(PhyloTree&& other) noexcept
+        : branch_lens(std::move(other.branch_lens)), edges(std::move(other.edges)),
+          tip_labels(std::move(other.tip_labels)), start(other.start),
+          end(other.end), starts(std::move(other.starts)),
+          ends(std::move(other.ends)), mut_ends(std::move(other.mut_ends)),
+          n_tips(other.n_tips), n_edges(other.n_edges) {}
+    PhyloTree& operator=(PhyloTree&& other) noexcept {
+        branch_lens = std::move(other.branch_lens);
+        edges = std::move(other.edges);
+        tip_labels = std::move(other.tip_labels);
+        start = other.start;
+        end = other.end;
+        starts = std::move(other.starts);
+        ends = std::move(other.ends);
+        mut_ends = std::move(other.mut_ends);
+        n_tips = other.n_tips;
+        n_edges = other.n_edges;
+        return *this;
+    }
 
 };
 
 
+/*
+ Samplers for evolving all edges of one tree at a single site at once
+ ("site-major" evolution), rather than evolving every site on one edge at a time.
+
+ This is only used when there are no indels, so positions never change and tips
+ start out identical to the reference.
+ For a site with nucleotide `c` and rate category `k`, the probability that it
+ changes on any edge is one minus the product of `P(t)[c,c]` over all edges.
+ Sites are skipped over until one changes, and only then are the edges sampled,
+ so the work is proportional to the number of sites that change rather than the
+ chromosome length times the number of edges.
+
+ The first edge that a site changes on is sampled from the probability that it stays
+ the same on all edges before it and changes on that one.
+ That edge is then sampled conditional on the site changing, and all later edges are
+ sampled normally.
+ */
+class SiteMajorSampler {
+
+public:
+
+    double p_max = 0;  // highest probability of a site changing on any edge
+
+    SiteMajorSampler() {}
+    // (Branch lengths are multiplied by `rate_mult`.)
+    SiteMajorSampler(const PhyloTree& tree, const SubMutator& subs,
+                     const double& rate_mult = 1);
+
+    // Probability that a site with nucleotide index `c` and rate category `k`
+    // changes on any edge:
+    inline double p_var(const uint8& c, const uint8& k) const {
+        return p_vars[k * 4U + c];
+    }
+
+    /*
+     Sample nucleotide indices for all tips at a site that changes on some edge.
+     `states` must be of length # tips and all equal to `c` beforehand.
+     */
+    void sample_site(const uint8& c,
+                     const uint8& k,
+                     std::vector<uint8>& states,
+                     pcg64& eng) const;
+
+private:
+
+    uint64 n_cats = 0;
+    uint64 n_edges = 0;
+    arma::Mat<uint64> edges;
+    std::vector<bool> zero_len;                  // whether each branch length is zero
+    std::vector<double> p_vars;                  // [k * 4 + c]
+    std::vector<AliasSampler> first_change;      // [k * 4 + c], samples edge indices
+    std::vector<FixedAliasSampler<4>> samplers;  // [(edge * n_cats + k) * 4 + c]
+    // Same as `samplers` but only for changing nucleotides:
+    std::vector<FixedAliasSampler<4>> change_samplers;
+
+};
+
+
+
+
 /*
  Phylogenetic tree info for one entire chromosome.
 
@@ -121,13 +202,18 @@ public:
     std::vector<PhyloTree> trees;
     std::vector<HapChrom*> tip_chroms;      // pointers to final HapChrom objects
     std::vector<std::deque<uint8>> rates;   // rate indices (Gammas + invariants) for tree
-    TreeMutator mutator;                    // to do the mutation additions across tree
+    RateMap rate_map;                       // relative rates along reference chromosome
+    std::vector<RateMap> rate_maps;         // rate maps for tree
+    TreeMutator* mutator;                   // per-thread mutator (set in `evolve`)
     uint64 n_tips;                          // number of tips (i.e., haplotypes)
+    bool site_major;                        // evolve site by site (only without indels)
 
 
-    PhyloOneChrom() {}
+    PhyloOneChrom() : mutator(nullptr) {}
     /*
-     Construct just tree and mutator info, when no HapSet info yet available.
+     Construct just tree info, when no HapSet info yet available.
+     The mutator is only used to check for indels, since mutators are per thread
+     (see `PhyloInfo::mutator_base`).
      Used in `fill_tree_mutator` method below.
      */
     PhyloOneChrom(
@@ -140,8 +226,11 @@ public:
         : trees(edges_.size()),
           tip_chroms(),
           rates(tip_labels_[0].size()),
-          mutator(mutator_base),
+          rate_map(),
+          rate_maps(tip_labels_[0].size()),
+          mutator(nullptr),
           n_tips(tip_labels_[0].size()),
+          site_major(mutator_base.indels.total_rate() <= 0),
           recombination(branch_lens_.size() > 1)
     {
 
@@ -188,13 +277,15 @@ public:
 
     /*
      Evolve all trees.
+     `mutator_` holds the scratch space for the thread doing this; the model inside it
+     is shared by all chromosomes.
      */
-    int evolve(pcg64& eng, Progress& prog_bar);
+    int evolve(TreeMutator& mutator_, pcg64& eng, ProgressMonitor& prog_bar);
 
 
 
     /*
-     Fill tree and mutator info from an input list and base mutator object
+     Fill tree info from an input list and base mutator object
     */
     void fill_tree_mutator(const List& genome_phylo_info, const uint64& i,
                            const TreeMutator& mutator_base);
@@ -211,7 +302,32 @@ private:
     /*
      Evolve one tree.
      */
-    int one_tree(const uint64& idx, pcg64& eng, Progress& prog_bar);
+    int one_tree(const uint64& idx, pcg64& eng, ProgressMonitor& prog_bar);
+
+    /*
+     Evolve one tree site by site (see `SiteMajorSampler`).
+     */
+    int one_tree_sites(const uint64& idx, pcg64& eng, ProgressMonitor& prog_bar);
+    int sites_range(const PhyloTree& tree,
+                    const SiteMajorSampler& sampler,
+                    const uint64& begin,
+                    const uint64& end,
+                    const std::deque<uint8>& rate_inds,
+                    std::vector<uint8>& states,
+                    pcg64& eng,
+                    ProgressMonitor& prog_bar,
+                    uint32& iters);
+    // (`R` is one of the rate policies in `SubMutator`)
+    template <typename R>
+    int sites_range_(const PhyloTree& tree,
+                     const SiteMajorSampler& sampler,
+                     const uint64& begin,
+                     const uint64& end,
+                     const std::deque<uint8>& rate_inds,
+                     std::vector<uint8>& states,
+                     pcg64& eng,
+                     ProgressMonitor& prog_bar,
+                     uint32& iters);
 
 
     /*
@@ -219,7 +335,7 @@ private:
      */
     int reset(const PhyloTree& tree,
               pcg64& eng,
-              Progress& prog_bar);
+              ProgressMonitor& prog_bar);
 
 };
 
@@ -237,9 +353,12 @@ class PhyloInfo {
 public:
 
     std::vector<PhyloOneChrom> phylo_one_chroms;
+    // Copied once per thread (the model inside is shared, not copied):
+    TreeMutator mutator_base;
 
     PhyloInfo(const List& genome_phylo_info,
-              const TreeMutator& mutator_base);
+              const TreeMutator& mutator_base,
+              const List& rate_maps);
 
     XPtr<HapSet> evolve_chroms(SEXP& ref_genome_ptr,
                                const uint64& n_threads,
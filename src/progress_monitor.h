@@ -0,0 +1,159 @@
+#ifndef __JACKALOPE_PROGRESS_MONITOR_H
+#define __JACKALOPE_PROGRESS_MONITOR_H
+
+
+/*
+ ********************************************************
+
+ Progress bar and user-interrupt checks for parallel loops, without having
+ worker threads synchronize with each other.
+
+ ********************************************************
+ */
+
+
+#include "jackalope_config.h" // controls debugging and diagnostics output
+
+#include <RcppArmadillo.h>
+#include <vector>  // vector class
+#include <algorithm>  // max
+#include <atomic>  // atomic
+#include <chrono>  // steady_clock
+#include <thread>  // this_thread::sleep_for
+#include <progress.hpp>  // for the progress bar
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
+
+#include "jackalope_types.h"  // integer types
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Wraps a `Progress` object for use inside an OpenMP parallel region.
+
+ Each thread adds progress to its own counter and only reads one shared abort flag.
+ R can only be called from the thread it runs on, which is the master thread,
+ so that thread does the monitoring: at most once every `interval` seconds,
+ it adds up all the counters, updates the progress bar, and checks for user
+ interrupts (setting the abort flag if there was one).
+ Once it runs out of work itself, the master thread keeps monitoring until the other
+ threads are done (see `finish`), so loops should use `nowait` if they're followed
+ by a call to `finish`.
+
+ `increment`, `is_aborted`, and `check_abort` work like those for `Progress`.
+ */
+class ProgressMonitor {
+
+public:
+
+    ProgressMonitor(Progress& prog_bar_,
+                    const uint64& n_threads,
+                    const double& interval_ = 0.1)
+        : prog_bar(prog_bar_),
+          counters(std::max(n_threads, static_cast<uint64>(1))),
+          reported(0),
+          n_finished(0),
+          aborted(prog_bar_.is_aborted()),
+          interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double>(interval_))),
+          last_check(std::chrono::steady_clock::now()) {}
+
+    // Add progress for the current thread:
+    inline void increment(const uint64& amount = 1) {
+        std::atomic<uint64>& n(counters[thread_num()].n);
+        n.store(n.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        return;
+    }
+
+    inline bool is_aborted() const {
+        return aborted.load(std::memory_order_relaxed);
+    }
+
+    /*
+     Returns whether to abort.
+     For the master thread, it first monitors progress if it's been long enough.
+     */
+    inline bool check_abort() {
+        if (thread_num() == 0) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if ((now - last_check) >= interval) {
+                last_check = now;
+                monitor();
+            }
+        }
+        return is_aborted();
+    }
+
+    /*
+     Each thread in the parallel region should call this once it's done.
+     The master thread then monitors until all others have called it, and does a
+     last update of the progress bar.
+     */
+    inline void finish() {
+        if (thread_num() > 0) {
+            n_finished.fetch_add(1, std::memory_order_release);
+            return;
+        }
+#ifdef _OPENMP
+        const uint64 n_others = omp_get_num_threads() - 1;
+#else
+        const uint64 n_others = 0;
+#endif
+        while (n_finished.load(std::memory_order_acquire) < n_others) {
+            monitor();
+            std::this_thread::sleep_for(interval);
+        }
+        monitor();
+        return;
+    }
+
+private:
+
+    // Padded so threads don't share cache lines when they update their counters:
+    struct Counter {
+        std::atomic<uint64> n;
+        char pad[64 - sizeof(std::atomic<uint64>)];
+        Counter() : n(0) {}
+    };
+
+    Progress& prog_bar;
+    std::vector<Counter> counters;
+    uint64 reported;  // total progress already given to `prog_bar`
+    std::atomic<uint64> n_finished;
+    std::atomic<bool> aborted;
+    const std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point last_check;
+
+    inline static uint64 thread_num() {
+#ifdef _OPENMP
+        return omp_get_thread_num();
+#else
+        return 0;
+#endif
+    }
+
+    // Only called from the master thread:
+    inline void monitor() {
+        uint64 total = 0;
+        for (const Counter& c : counters) total += c.n.load(std::memory_order_relaxed);
+        if (total > reported) {
+            prog_bar.increment(total - reported);
+            reported = total;
+        }
+        if (prog_bar.is_aborted() || prog_bar.check_abort()) {
+            aborted.store(true, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+};
+
+
+
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef __JACKALOPE_RATE_MAP_H
+#define __JACKALOPE_RATE_MAP_H
+
+
+/*
+ ********************************************************
+
+ Maps of relative mutation rates along a chromosome.
+
+ ********************************************************
+ */
+
+
+#include "jackalope_config.h" // controls debugging and diagnostics output
+
+#include <RcppArmadillo.h>
+#include <vector>  // vector class
+#include <algorithm>  // min
+#include <pcg/pcg_random.hpp> // pcg prng
+
+#include "jackalope_types.h" // integer types
+#include "pcg.h"  // runif_01
+
+
+using namespace Rcpp;
+
+
+
+
+/*
+ Fenwick (binary indexed) tree of non-negative values.
+ Changing a value, getting the sum of values before an index, and finding where
+ a cumulative sum is reached all take O(log n).
+ */
+template <typename T>
+class FenwickTree {
+
+public:
+
+    FenwickTree() : tree(1, 0), total_(0) {}
+    FenwickTree(const std::vector<T>& values)
+        : tree(values.size() + 1, 0), total_(0) {
+        // Linear-time construction:
+        for (uint64 i = 0; i < values.size(); i++) {
+            tree[i+1] += values[i];
+            total_ += values[i];
+            uint64 j = (i+1) + ((i+1) & (~(i+1) + 1));
+            if (j < tree.size()) tree[j] += tree[i+1];
+        }
+    }
+
+    inline uint64 size() const { return tree.size() - 1; }
+    inline const T& total() const { return total_; }
+
+    // Add `delta` to the value at index `i`:
+    inline void add(uint64 i, const T& delta) {
+        total_ += delta;
+        for (++i; i < tree.size(); i += (i & (~i + 1))) tree[i] += delta;
+        return;
+    }
+
+    // Sum of values before index `i`:
+    inline T prefix(uint64 i) const {
+        T out = 0;
+        for (; i > 0; i -= (i & (~i + 1))) out += tree[i];
+        return out;
+    }
+
+    /*
+     First index where the cumulative sum (including that index) is > `target`.
+     `target` is changed to the amount remaining past the sum before that index.
+     Returns `size()` if `target >= total()`.
+     */
+    inline uint64 search(T& target) const {
+        uint64 pos = 0;
+        uint64 step = 1;
+        while ((step << 1) < tree.size()) step <<= 1;
+        for (; step > 0; step >>= 1) {
+            uint64 next = pos + step;
+            if (next < tree.size() && tree[next] <= target) {
+                pos = next;
+                target -= tree[next];
+            }
+        }
+        return pos;
+    }
+
+private:
+
+    std::vector<T> tree;  // 1-based
+    T total_;
+
+};
+
+
+
+
+
+/*
+ Piecewise-constant rate multipliers along a chromosome region.
+
+ Segments are stored in order as lengths and multipliers, with Fenwick trees over
+ the lengths and the weights (length * multiplier).
+ Finding the segment at a position, sampling a position by weight, and adjusting
+ segments for indels all take O(log # segments).
+ Like `rate_inds`, positions are relative to the start of the region.
+ Inserted bases get the multiplier of the segment they're inserted into.
+ An empty map means every site has a multiplier of 1.
+ */
+class RateMap {
+
+public:
+
+    RateMap() {}
+    RateMap(const std::vector<uint64>& lens_, const std::vector<double>& mults_)
+        : lens(lens_), mults(mults_), len_tree(), weight_tree() {
+        if (lens.size() != mults.size()) {
+            stop("rate map lengths and multipliers must be the same length");
+        }
+        std::vector<double> weights(lens.size());
+        for (uint64 i = 0; i < lens.size(); i++) {
+            if (mults[i] < 0) stop("rate map multipliers cannot be negative");
+            weights[i] = static_cast<double>(lens[i]) * mults[i];
+        }
+        len_tree = FenwickTree<uint64>(lens);
+        weight_tree = FenwickTree<double>(weights);
+    }
+
+    inline bool empty() const { return mults.empty(); }
+    inline uint64 size() const { return mults.size(); }
+    inline const uint64& length(const uint64& i) const { return lens[i]; }
+    inline const double& mult(const uint64& i) const { return mults[i]; }
+    inline uint64 total_length() const { return len_tree.total(); }
+    inline double total_weight() const { return weight_tree.total(); }
+
+
+    // Index to the segment containing position `pos`, and set that segment's start:
+    inline uint64 segment(const uint64& pos, uint64& seg_start) const {
+        uint64 target = pos;
+        uint64 i = len_tree.search(target);
+        seg_start = pos - target;
+        return i;
+    }
+
+    /*
+     Sample a position, weighted by multipliers.
+     Callers shouldn't sample when all multipliers are zero, but positions are
+     equally likely if they do.
+     */
+    template <typename E>
+    inline uint64 sample(E& eng) const {
+        if (weight_tree.total() <= 0) {
+            return static_cast<uint64>(runif_01(eng) * len_tree.total());
+        }
+        double target = runif_01(eng) * weight_tree.total();
+        uint64 i = weight_tree.search(target);
+        /*
+         Rounding error can put it past the end or on a segment without weight.
+         Then it uses the end of the last segment before it with weight, or
+         (if there isn't one) the start of the first one after it.
+         */
+        if (i >= mults.size() || !has_weight(i)) {
+            uint64 j = std::min(i, mults.size());
+            while (j > 0 && !has_weight(j - 1)) j--;
+            if (j > 0) {
+                i = j - 1;
+                target = static_cast<double>(lens[i]) * mults[i];
+            } else {
+                while (!has_weight(i)) i++;
+                target = 0;
+            }
+        }
+        uint64 offset = static_cast<uint64>(target / mults[i]);
+        if (offset >= lens[i]) offset = lens[i] - 1;
+        return len_tree.prefix(i) + offset;
+    }
+
+    /*
+     Get part of this map, from `start` to `end` (non-inclusive).
+     */
+    RateMap slice(const uint64& start, const uint64& end) const {
+        std::vector<uint64> lens_;
+        std::vector<double> mults_;
+        uint64 seg_start = 0;
+        for (uint64 i = 0; i < lens.size() && seg_start < end; i++) {
+            uint64 seg_end = seg_start + lens[i];
+            if (seg_end > start) {
+                lens_.push_back(std::min(seg_end, end) - std::max(seg_start, start));
+                mults_.push_back(mults[i]);
+            }
+            seg_start = seg_end;
+        }
+        return RateMap(lens_, mults_);
+    }
+
+    // Adjust for an insertion of `size` bases after position `pos`:
+    inline void insertion_adjust(const uint64& size, const uint64& pos) {
+        if (empty()) return;
+        uint64 seg_start;
+        uint64 i = segment(pos, seg_start);
+        if (i >= lens.size()) i = lens.size() - 1;
+        change_length(i, static_cast<sint64>(size));
+        return;
+    }
+
+    // Adjust for a deletion of `size` bases starting at position `pos`:
+    inline void deletion_adjust(uint64 size, const uint64& pos) {
+        if (empty()) return;
+        while (size > 0) {
+            uint64 seg_start;
+            uint64 i = segment(pos, seg_start);
+            if (i >= lens.size()) break;
+            uint64 n = std::min(size, seg_start + lens[i] - pos);
+            change_length(i, -1 * static_cast<sint64>(n));
+            size -= n;
+        }
+        return;
+    }
+
+private:
+
+    std::vector<uint64> lens;
+    std::vector<double> mults;
+    FenwickTree<uint64> len_tree;
+    FenwickTree<double> weight_tree;
+
+    inline bool has_weight(const uint64& i) const {
+        return lens[i] > 0 && mults[i] > 0;
+    }
+
+    inline void change_length(const uint64& i, const sint64& delta) {
+        lens[i] += delta;
+        len_tree.add(i, static_cast<uint64>(delta));
+        weight_tree.add(i, static_cast<double>(delta) * mults[i]);
+        return;
+    }
+
+};
+
+
+
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "jackalope_types.h"  // integer types
 #include "util.h"  // clear_memory, get_width
+#include "memory_usage.h"  // MemoryUsage
 
 using namespace Rcpp;
 
@@ -91,6 +92,13 @@ struct RefChrom {
     bool operator > (const RefChrom& other) const noexcept {
         return size() > other.size();
     }
+    // Heap memory used by this chromosome
+    MemoryUsage memory_usage() const {
+        MemoryUsage out;
+        out.add_string(nucleos, out.sequence);
+        out.add_string(name, out.names);
+        return out;
+    }
 
     /*
      ------------------
@@ -182,6 +190,21 @@ struct RefGenome {
         for (uint64 i = 0; i < out.size(); i++) out[i] = chromosomes[i].size();
         return out;
     }
+    // Name of one chromosome
+    const std::string& chrom_name(const uint64& idx) const {
+        return chromosomes[idx].name;
+    }
+    // Memory used by this genome
+    MemoryUsage memory_usage() const {
+        MemoryUsage out;
+        out.overhead += sizeof(RefGenome);
+        out.add_deque<RefChrom>(chromosomes, out.overhead);
+        for (const RefChrom& rc : chromosomes) out += rc.memory_usage();
+        out.add_deque<std::string>(old_names, out.overhead);
+        for (const std::string& on : old_names) out.add_string(on, out.names);
+        out.add_string(name, out.names);
+        return out;
+    }
     // For printing reference genome info
     void print() const {
 
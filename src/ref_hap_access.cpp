@@ -25,6 +25,9 @@
 #include "hap_classes.h"  // Hap* classes
 #include "pcg.h"  // pcg seeding
 #include "phylogenomics.h"  // match_ and template functions
+#include "memory_usage.h"  // MemoryUsage, mem_usage namespace
+#include "util.h"  // thread_check
+#include "lazy_seqs.h"  // lazy_*_chroms, detach_lazy_chroms
 
 
 
@@ -126,8 +129,10 @@ SEXP make_ref_genome(const std::vector<std::string>& chroms) {
 //[[Rcpp::export]]
 SEXP make_hap_set(SEXP ref_genome_ptr, const uint64& n_haps) {
     XPtr<RefGenome> ref_genome(ref_genome_ptr);
-    // FYI, `n_haps` can be zero:
-    XPtr<HapSet> hap_set(new HapSet(*ref_genome, n_haps), true);
+    // FYI, `n_haps` can be zero.
+    // The reference pointer is protected by this one so it lives at least as long:
+    XPtr<HapSet> hap_set(new HapSet(*ref_genome, n_haps), true, R_NilValue,
+                         ref_genome_ptr);
     return hap_set;
 }
 
@@ -232,25 +237,23 @@ IntegerVector view_hap_genome_chrom_sizes(SEXP hap_set_ptr,
 
 
 //[[Rcpp::export]]
-std::string view_ref_genome_chrom(SEXP ref_genome_ptr, const uint64& chrom_ind) {
-    XPtr<RefGenome> ref_genome(ref_genome_ptr);
-    std::string out = (*ref_genome)[chrom_ind].nucleos;
+SEXP view_ref_genome_chrom(SEXP ref_genome_ptr, const uint64& chrom_ind) {
+    SEXP out = lazy_ref_chroms(ref_genome_ptr, chrom_ind, 1);
     return out;
 }
 
 
 //' Function to piece together the strings for one chromosome in a HapGenome.
 //'
+//' The string is only pieced together once R accesses it.
+//'
 //' @noRd
 //'
 //[[Rcpp::export]]
-std::string view_hap_genome_chrom(SEXP hap_set_ptr,
-                               const uint64& hap_ind,
-                               const uint64& chrom_ind) {
-
-    XPtr<HapSet> hap_set(hap_set_ptr);
-    const HapChrom& hap_chrom((*hap_set)[hap_ind][chrom_ind]);
-    std::string out = hap_chrom.get_chrom_full();
+SEXP view_hap_genome_chrom(SEXP hap_set_ptr,
+                           const uint64& hap_ind,
+                           const uint64& chrom_ind) {
+    SEXP out = lazy_hap_chroms(hap_set_ptr, hap_ind, chrom_ind, 1);
     return out;
 }
 
@@ -269,32 +272,25 @@ std::string view_hap_genome_chrom(SEXP hap_set_ptr,
 
 
 //[[Rcpp::export]]
-std::vector<std::string> view_ref_genome(SEXP ref_genome_ptr) {
+SEXP view_ref_genome(SEXP ref_genome_ptr) {
     XPtr<RefGenome> ref_genome(ref_genome_ptr);
-    std::vector<std::string> out(ref_genome->size(), "");
-    for (uint64 i = 0; i < ref_genome->size(); i++) {
-        const RefChrom& ref_chrom((*ref_genome)[i]);
-        out[i] = ref_chrom.nucleos;
-    }
+    SEXP out = lazy_ref_chroms(ref_genome_ptr, 0, ref_genome->size());
     return out;
 }
 
 //' Function to piece together the strings for all chromosomes in a HapGenome.
 //'
+//' Each chromosome's string is only pieced together once R accesses it.
+//'
 //' @noRd
 //'
 //[[Rcpp::export]]
-std::vector<std::string> view_hap_genome(SEXP hap_set_ptr,
-                                        const uint64& hap_ind) {
+SEXP view_hap_genome(SEXP hap_set_ptr,
+                     const uint64& hap_ind) {
 
     XPtr<HapSet> hap_set(hap_set_ptr);
-    const HapGenome& hap_genome((*hap_set)[hap_ind]);
-
-    std::vector<std::string> out(hap_genome.size(), "");
-    for (uint64 i = 0; i < hap_genome.size(); i++) {
-        const HapChrom& hap_chrom(hap_genome[i]);
-        out[i] = hap_chrom.get_chrom_full();
-    }
+    if (hap_ind >= hap_set->size()) stop("haplotype index out of bounds");
+    SEXP out = lazy_hap_chroms(hap_set_ptr, hap_ind, 0, (*hap_set)[hap_ind].size());
     return out;
 }
 
@@ -422,6 +418,145 @@ double view_hap_set_nt_content(SEXP hap_set_ptr,
 
 
 
+/*
+ ========================================================================================
+ ========================================================================================
+
+ Memory usage
+
+ ========================================================================================
+ ========================================================================================
+ */
+
+
+//' Memory used by a `RefGenome` or `HapSet` object, in bytes.
+//'
+//' Output is a named numeric vector with bytes used for full sequences,
+//' mutation positions, nucleotides inside mutations, names,
+//' overhead (containers, pointers, and allocator bookkeeping), and the total.
+//' Numbers for `HapSet` objects don't include the reference genome.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+NumericVector view_ref_genome_memory(SEXP ref_genome_ptr) {
+    XPtr<RefGenome> ref_genome(ref_genome_ptr);
+    MemoryUsage mu = ref_genome->memory_usage();
+    return mu.to_R();
+}
+//[[Rcpp::export]]
+NumericVector view_hap_set_memory(SEXP hap_set_ptr) {
+    XPtr<HapSet> hap_set(hap_set_ptr);
+    MemoryUsage mu = hap_set->memory_usage();
+    return mu.to_R();
+}
+
+
+//' Estimate memory a `HapSet` will use before creating it.
+//'
+//' @param n_haps Number of haplotypes.
+//' @param n_muts Expected number of mutations per haplotype.
+//' @param mut_nts Mean number of nucleotides stored per mutation
+//'     (1 for substitutions, insertion length + 1 for insertions, 0 for deletions).
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+NumericVector estimate_hap_set_memory(SEXP ref_genome_ptr,
+                                      const uint64& n_haps,
+                                      const double& n_muts,
+                                      const double& mut_nts) {
+
+    XPtr<RefGenome> ref_genome(ref_genome_ptr);
+    const RefGenome& ref(*ref_genome);
+
+    // Bytes allocated for each mutation's string of nucleotides (incl. '\0'):
+    uint64 nts_alloc = 0;
+    if (mut_nts > 0) {
+        nts_alloc = mem_usage::malloc_chunk(static_cast<uint64>(std::ceil(mut_nts)) + 1);
+    }
+
+    // One haplotype:
+    MemoryUsage one_hap;
+    one_hap.add_vector(ref.size(), ref.size(), sizeof(HapChrom), one_hap.overhead);
+    double total_size = std::max(static_cast<double>(ref.total_size), 1.0);
+    for (const RefChrom& rc : ref.chromosomes) {
+        double chrom_muts = n_muts * static_cast<double>(rc.size()) / total_size;
+        uint64 n = static_cast<uint64>(std::round(chrom_muts));
+        one_hap.add_deque(n, sizeof(uint64), one_hap.positions);
+        one_hap.add_deque(n, sizeof(uint64), one_hap.positions);
+        one_hap.add_deque(n, sizeof(char*), one_hap.overhead);
+        if (nts_alloc > 0) {
+            one_hap.nucleos += static_cast<uint64>(std::round(chrom_muts * mut_nts));
+            one_hap.overhead += n * nts_alloc -
+                static_cast<uint64>(std::round(chrom_muts * mut_nts));
+        }
+    }
+    one_hap *= n_haps;
+
+    MemoryUsage out;
+    out.overhead += sizeof(HapSet);
+    out.add_vector(n_haps, n_haps, sizeof(HapGenome), out.overhead);
+    out += one_hap;
+    // Default haplotype names:
+    for (uint64 i = 0; i < n_haps; i++) {
+        uint64 name_size = 3ULL + std::to_string(i).size();
+        out.add_string(name_size, name_size, out.names);
+    }
+
+    return out.to_R();
+}
+
+
+//' Estimate peak memory used to simulate reads, in bytes.
+//'
+//' @param n_haps Number of haplotypes. Use `0` for sequencing the reference.
+//' @param read_length Mean read length.
+//' @param n_read_ends Number of read ends (2 for paired-end reads, 1 otherwise).
+//' @param n_quals Number of possible quality values per read position.
+//' @param read_pool_size Number of reads per thread before writing to file.
+//' @param n_threads Number of threads.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+double estimate_read_sim_memory(SEXP ref_genome_ptr,
+                                const uint64& n_haps,
+                                const uint64& read_length,
+                                const uint64& n_read_ends,
+                                const uint64& n_quals,
+                                const uint64& read_pool_size,
+                                uint64 n_threads) {
+
+    XPtr<RefGenome> ref_genome(ref_genome_ptr);
+    const RefGenome& ref(*ref_genome);
+
+    thread_check(n_threads);
+
+    uint64 max_name = 0;
+    uint64 max_chrom = 0;
+    for (const RefChrom& rc : ref.chromosomes) {
+        if (rc.name.size() > max_name) max_name = rc.name.size();
+        if (rc.size() > max_chrom) max_chrom = rc.size();
+    }
+    // Read names are "<genome>-<chromosome>-<position>-<R or F>[/<read end>]":
+    uint64 name_length = max_name + 32ULL;
+
+    // Only haplotypes store whole chromosomes (one per thread) while sequencing:
+    if (n_haps == 0) max_chrom = 0;
+
+    uint64 read_bytes = mem_usage::fastq_read(name_length, read_length);
+    uint64 one_thread = mem_usage::read_sim_thread(read_pool_size, read_bytes,
+                                                   max_chrom);
+    // Quality samplers are shared by all threads and haplotypes:
+    uint64 shared = mem_usage::illumina_samplers(n_read_ends, read_length, n_quals);
+
+    return static_cast<double>(shared + one_thread * n_threads);
+}
+
+
+
+
 /*
  ========================================================================================
  ========================================================================================
@@ -506,6 +641,7 @@ void remove_ref_genome_chroms(
         std::vector<uint64> chrom_inds) {
 
     XPtr<RefGenome> ref_genome(ref_genome_ptr);
+    detach_lazy_chroms(ref_genome_ptr);
     std::deque<RefChrom>& chromosomes(ref_genome->chromosomes);
 
     // Checking for duplicates:
@@ -539,6 +675,7 @@ void remove_hap_set_haps(
         std::vector<uint64> hap_inds) {
 
     XPtr<HapSet> hap_set(hap_set_ptr);
+    detach_lazy_chroms(hap_set_ptr);
     std::vector<HapGenome>& haplotypes(hap_set->haplotypes);
 
     // Checking for duplicates:
@@ -818,6 +955,7 @@ void add_substitution(SEXP hap_set_ptr, const uint64& hap_ind,
                       const char& nucleo_,
                       const uint64& new_pos_) {
     XPtr<HapSet> hap_set(hap_set_ptr);
+    detach_lazy_chroms(hap_set_ptr);
     HapGenome& hap_genome((*hap_set)[hap_ind]);
     HapChrom& hap_chrom(hap_genome[chrom_ind]);
     hap_chrom.add_substitution(nucleo_, new_pos_);
@@ -837,6 +975,7 @@ void add_insertion(SEXP hap_set_ptr, const uint64& hap_ind,
                    const std::string& nucleos_,
                    const uint64& new_pos_) {
     XPtr<HapSet> hap_set(hap_set_ptr);
+    detach_lazy_chroms(hap_set_ptr);
     HapGenome& hap_genome((*hap_set)[hap_ind]);
     HapChrom& hap_chrom(hap_genome[chrom_ind]);
     hap_chrom.add_insertion(nucleos_, new_pos_);
@@ -857,6 +996,7 @@ void add_deletion(SEXP hap_set_ptr,
                   const uint64& size_,
                   const uint64& new_pos_) {
     XPtr<HapSet> hap_set(hap_set_ptr);
+    detach_lazy_chroms(hap_set_ptr);
     HapGenome& hap_genome((*hap_set)[hap_ind]);
     HapChrom& hap_chrom(hap_genome[chrom_ind]);
     hap_chrom.add_deletion(size_, new_pos_);
@@ -864,3 +1004,113 @@ void add_deletion(SEXP hap_set_ptr,
 }
 
 
+
+//' Add many mutations at once.
+//'
+//' This avoids crossing between R and C++ for every mutation, and it can add
+//' mutations to different chromosomes in parallel.
+//' Positions all refer to the haplotype chromosomes before any of these mutations are
+//' added. Mutations are sorted and added from the back of each chromosome so that
+//' adding one never moves the position of one that's yet to be added.
+//' Mutations at the same position are added in the order they're provided.
+//'
+//' @inheritParams add_mutations
+//' @param hap_inds Integer indices to the desired haplotypes. Uses 0-based indexing!
+//' @param chrom_inds Integer indices to the desired chromosomes. Uses 0-based indexing!
+//' @param new_pos Integer indices to the desired mutation locations.
+//'     Uses 0-based indexing!
+//' @param types Type of each mutation: `0` for substitutions, `1` for insertions,
+//'     and `2` for deletions.
+//' @param nucleos Nucleotide(s) to substitute or insert. Ignored for deletions.
+//' @param sizes Sizes of deletions. Ignored for substitutions and insertions.
+//' @param n_threads Number of threads to use.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+void add_many_mutations(SEXP hap_set_ptr,
+                        const std::vector<uint64>& hap_inds,
+                        const std::vector<uint64>& chrom_inds,
+                        const std::vector<uint64>& new_pos,
+                        const std::vector<uint64>& types,
+                        const std::vector<std::string>& nucleos,
+                        const std::vector<uint64>& sizes,
+                        uint64 n_threads) {
+
+    XPtr<HapSet> hap_set(hap_set_ptr);
+    detach_lazy_chroms(hap_set_ptr);
+
+    const uint64 n_muts = new_pos.size();
+    if (hap_inds.size() != n_muts || chrom_inds.size() != n_muts ||
+        types.size() != n_muts || nucleos.size() != n_muts || sizes.size() != n_muts) {
+        stop("In `add_many_mutations`, all input vectors must be the same length");
+    }
+
+    // Check that # threads isn't too high and change to 1 if not using OpenMP:
+    thread_check(n_threads);
+
+    // Checking everything before changing anything:
+    for (uint64 i = 0; i < n_muts; i++) {
+        if (hap_inds[i] >= hap_set->size()) {
+            stop("In `add_many_mutations`, one or more `hap_inds` is too large");
+        }
+        const HapGenome& hap_genome((*hap_set)[hap_inds[i]]);
+        if (chrom_inds[i] >= hap_genome.size()) {
+            stop("In `add_many_mutations`, one or more `chrom_inds` is too large");
+        }
+        if (new_pos[i] >= hap_genome[chrom_inds[i]].size()) {
+            stop("In `add_many_mutations`, one or more `new_pos` is too large");
+        }
+        if (types[i] > 2) {
+            stop("In `add_many_mutations`, `types` must only contain 0, 1, or 2");
+        }
+        if (types[i] == 0 && nucleos[i].size() != 1) {
+            stop("In `add_many_mutations`, substitutions need exactly one nucleotide");
+        }
+    }
+
+    // Mutation indices sorted by haplotype, chromosome, then position (backward):
+    std::vector<uint64> order(n_muts);
+    for (uint64 i = 0; i < n_muts; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](const uint64& a, const uint64& b) {
+                         if (hap_inds[a] != hap_inds[b]) return hap_inds[a] < hap_inds[b];
+                         if (chrom_inds[a] != chrom_inds[b]) {
+                             return chrom_inds[a] < chrom_inds[b];
+                         }
+                         return new_pos[a] > new_pos[b];
+                     });
+
+    // Where each chromosome's mutations start in `order`:
+    std::vector<uint64> starts;
+    for (uint64 k = 0; k < n_muts; k++) {
+        uint64 i = order[k];
+        if (k == 0 || hap_inds[i] != hap_inds[order[k-1]] ||
+            chrom_inds[i] != chrom_inds[order[k-1]]) {
+            starts.push_back(k);
+        }
+    }
+    const uint64 n_chroms = starts.size();
+    starts.push_back(n_muts);
+
+    // Each chromosome is only changed by one thread:
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(n_threads) if (n_threads > 1)
+#endif
+    for (uint64 j = 0; j < n_chroms; j++) {
+        uint64 i = order[starts[j]];
+        HapChrom& hap_chrom((*hap_set)[hap_inds[i]][chrom_inds[i]]);
+        for (uint64 k = starts[j]; k < starts[j+1]; k++) {
+            i = order[k];
+            if (types[i] == 0) {
+                hap_chrom.add_substitution(nucleos[i][0], new_pos[i]);
+            } else if (types[i] == 1) {
+                hap_chrom.add_insertion(nucleos[i], new_pos[i]);
+            } else hap_chrom.add_deletion(sizes[i], new_pos[i]);
+        }
+    }
+
+    return;
+}
+
+
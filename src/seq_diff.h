@@ -0,0 +1,279 @@
+#ifndef __JACKALOPE_SEQ_DIFF_H
+#define __JACKALOPE_SEQ_DIFF_H
+
+
+/*
+ ********************************************************
+
+ Finding the mutations that turn a reference chromosome into a haplotype's
+ full sequence (e.g., one read from a FASTA file).
+
+ ********************************************************
+ */
+
+
+#include "jackalope_config.h" // controls debugging and diagnostics output
+
+#include <RcppArmadillo.h>
+#include <string>  // string class
+#include <cstring>  // memcpy
+#include <algorithm>  // min, search
+
+#include "jackalope_types.h"  // integer types
+#include "hap_classes.h"  // HapChrom, AllMutations
+
+
+using namespace Rcpp;
+
+
+
+namespace seq_diff {
+
+// Number of matching bases required after a difference to say it's ended:
+const uint64 seed = 32;
+// Maximum number of bases per sequence checked for the end of a difference:
+const uint64 band = 64;
+// Maximum size of indels found by searching for a seed past a difference:
+const uint64 max_gap = 100000;
+
+}
+
+
+
+/*
+ Number of bases matching between `a` and `b` before the first difference,
+ checking up to `n` of them.
+ Bases are compared 8 at a time until a word differs.
+ */
+inline uint64 match_length(const char* a, const char* b, const uint64& n) {
+    uint64 i = 0;
+    uint64 wa, wb;
+    for (; (i + 8) <= n; i += 8) {
+        std::memcpy(&wa, a + i, 8);
+        std::memcpy(&wb, b + i, 8);
+        if (wa != wb) break;
+    }
+    while (i < n && a[i] == b[i]) i++;
+    return i;
+}
+
+
+
+/*
+ Adds mutations to an empty `AllMutations` object in order of reference position,
+ merging insertions into the preceding mutation when they're at the same position.
+ It calculates new positions as it goes and updates the chromosome size at the end.
+ */
+class DiffWriter {
+
+public:
+
+    DiffWriter(HapChrom& hap_chrom_)
+        : hap_chrom(hap_chrom_), size_mod(0), has_mut(false), old_pos(0), nts(),
+          del_size(0) {}
+
+    // Replace reference base `pos` with `nts_` (a substitution if it's one base):
+    inline void replace(const uint64& pos, const std::string& nts_) {
+        if (has_mut && pos == old_pos && del_size == 0) {
+            nts += nts_.substr(1);
+            return;
+        }
+        flush();
+        has_mut = true;
+        old_pos = pos;
+        nts = nts_;
+        return;
+    }
+
+    inline void deletion(const uint64& pos, const uint64& size) {
+        flush();
+        has_mut = true;
+        old_pos = pos;
+        del_size = size;
+        return;
+    }
+
+    // Add the last mutation and update the chromosome size:
+    inline void finish() {
+        flush();
+        hap_chrom.chrom_size += size_mod;
+        return;
+    }
+
+private:
+
+    HapChrom& hap_chrom;
+    sint64 size_mod;  // total size change from mutations already added
+    bool has_mut;
+    uint64 old_pos;
+    std::string nts;
+    uint64 del_size;  // size of deletion (or 0 if it's not one)
+
+    inline void flush() {
+        if (!has_mut) return;
+        AllMutations& mutations(hap_chrom.mutations);
+        uint64 new_pos = old_pos + size_mod;
+        if (del_size > 0) {
+            mutations.push_back(old_pos, new_pos, nullptr);
+            size_mod -= static_cast<sint64>(del_size);
+        } else {
+            mutations.push_back(old_pos, new_pos, nts.c_str());
+            size_mod += static_cast<sint64>(nts.size()) - 1;
+        }
+        has_mut = false;
+        del_size = 0;
+        return;
+    }
+
+};
+
+
+
+
+/*
+ Sets the mutations in `hap_chrom` (which shouldn't have any yet) so that its
+ sequence is `hap`.
+
+ Matching stretches are skipped using `match_length`.
+ At each difference, it looks for the nearest point after which the next `seed`
+ bases match again (or both sequences end), skipping up to `band` bases in each.
+ Points that skip the same number in both are checked first, so isolated
+ substitutions only take one check.
+ If there isn't one, it searches up to `max_gap` bases ahead for the next
+ `seed` bases of one sequence in the other, which finds long indels.
+ If that fails too, the next `band` bases are replaced and it tries again.
+ Differences not separated by matching bases are combined, then each is converted
+ into substitutions followed by one insertion or deletion, as for VCF files.
+
+ This doesn't find the fewest mutations possible, but the resulting sequence is
+ always the same as `hap`.
+ */
+inline void diff_hap_chrom(HapChrom& hap_chrom, const std::string& hap) {
+
+    const std::string& ref(hap_chrom.ref_chrom->nucleos);
+    const uint64 n_ref = ref.size();
+    const uint64 n_hap = hap.size();
+    const char* r = ref.c_str();
+    const char* h = hap.c_str();
+
+    // (Callers should check that a haplotype for an empty chromosome is also empty.)
+    if (n_ref == 0) return;
+
+    DiffWriter writer(hap_chrom);
+
+    // Whether the sequences match for `seed` bases starting at `i` and `j`:
+    auto anchored = [&](const uint64& i, const uint64& j) {
+        if (i > n_ref || j > n_hap) return false;
+        uint64 m = std::min(seq_diff::seed, std::min(n_ref - i, n_hap - j));
+        if (match_length(r + i, h + j, m) < m) return false;
+        return m == seq_diff::seed || ((i + m) == n_ref && (j + m) == n_hap);
+    };
+
+    // Add mutations for reference bases [i0, i1) becoming haplotype bases [j0, j1):
+    auto add_block = [&](const uint64& i0, const uint64& i1,
+                         const uint64& j0, const uint64& j1) {
+        const uint64 ref_len = i1 - i0;
+        const uint64 hap_len = j1 - j0;
+        if (ref_len == 0) {
+            // Insertion after the previous base, or before the first one
+            if (i0 > 0) {
+                writer.replace(i0 - 1, ref[i0-1] + hap.substr(j0, hap_len));
+            } else writer.replace(0, hap.substr(j0, hap_len) + ref[0]);
+            return;
+        }
+        uint64 n_subs = std::min(ref_len, hap_len);
+        if (hap_len > ref_len) n_subs--;
+        for (uint64 k = 0; k < n_subs; k++) {
+            if (ref[i0+k] != hap[j0+k]) writer.replace(i0 + k, std::string(1, hap[j0+k]));
+        }
+        if (hap_len > ref_len) {
+            writer.replace(i0 + n_subs, hap.substr(j0 + n_subs, hap_len - n_subs));
+        } else if (ref_len > hap_len) {
+            writer.deletion(i0 + n_subs, ref_len - n_subs);
+        }
+        return;
+    };
+
+    uint64 i = 0, j = 0;
+    // Start of a difference that hasn't been added yet:
+    uint64 i0 = 0, j0 = 0;
+    bool in_diff = false;
+
+    while (true) {
+
+        uint64 m = match_length(r + i, h + j, std::min(n_ref - i, n_hap - j));
+        if (m > 0 && in_diff) {
+            add_block(i0, i, j0, j);
+            in_diff = false;
+        }
+        i += m;
+        j += m;
+        if (i == n_ref && j == n_hap) break;
+
+        if (!in_diff) {
+            i0 = i;
+            j0 = j;
+            in_diff = true;
+        }
+        if (i == n_ref || j == n_hap) {
+            i = n_ref;
+            j = n_hap;
+            continue;
+        }
+
+        // Nearest point where they match again, by the most bases skipped in either:
+        bool found = false;
+        uint64 a = 0, b = 0;
+        for (uint64 c = 1; c <= seq_diff::band && !found; c++) {
+            for (uint64 d = 0; d <= c && !found; d++) {
+                if (anchored(i + c, j + c - d)) {
+                    a = c;
+                    b = c - d;
+                    found = true;
+                } else if (d > 0 && anchored(i + c - d, j + c)) {
+                    a = c - d;
+                    b = c;
+                    found = true;
+                }
+            }
+        }
+
+        // Long insertion or deletion:
+        if (!found && (n_ref - i) >= seq_diff::seed && (n_hap - j) >= seq_diff::seed) {
+            const char* r_end = r + std::min(n_ref, i + seq_diff::max_gap);
+            const char* h_end = h + std::min(n_hap, j + seq_diff::max_gap);
+            const char* r_match = std::search(r + i + 1, r_end, h + j,
+                                              h + j + seq_diff::seed);
+            const char* h_match = std::search(h + j + 1, h_end, r + i,
+                                              r + i + seq_diff::seed);
+            if (r_match != r_end && (h_match == h_end || (r_match - r - i) <=
+                (h_match - h - j))) {
+                a = r_match - r - i;
+                found = true;
+            } else if (h_match != h_end) {
+                b = h_match - h - j;
+                found = true;
+            }
+        }
+
+        if (!found) {
+            a = std::min(seq_diff::band, n_ref - i);
+            b = std::min(seq_diff::band, n_hap - j);
+        }
+
+        i += a;
+        j += b;
+
+    }
+
+    if (in_diff) add_block(i0, i, j0, j);
+
+    writer.finish();
+
+    return;
+}
+
+
+
+
+#endif
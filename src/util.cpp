@@ -5,6 +5,11 @@
 #include <string>
 
 #include "jackalope_types.h"  // integer types
+#include "pcg.h"  // seeded_engine, runif_01, xoshiro*
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
 
 
 using namespace Rcpp;
@@ -18,4 +23,60 @@ bool using_openmp() {
     return out;
 }
 
+// Max number of threads that functions with an `n_threads` argument can use
+//[[Rcpp::export]]
+int max_threads() {
+    int out = 1;
+#ifdef _OPENMP
+    out = omp_get_max_threads();
+#endif
+    return out;
+}
+
+/*
+ Compression methods available in this build, named by method, with the library
+ each one uses (`configure` looks for libdeflate and zstd)
+ */
+//[[Rcpp::export]]
+CharacterVector comp_methods() {
+    std::vector<std::string> methods = {"gzip", "bgzip"};
+    std::vector<std::string> libs = {"zlib"};
+#ifdef __JACKALOPE_LIBDEFLATE
+    libs.push_back("libdeflate");
+#else
+    libs.push_back("htslib");
+#endif
+#ifdef __JACKALOPE_ZSTD
+    methods.push_back("zstd");
+    libs.push_back("zstd");
+#endif
+    CharacterVector out = wrap(libs);
+    out.names() = methods;
+    return out;
+}
+
+
+
 
+/*
+ Uniform numbers from one of the RNG engines that can be chosen from R.
+ This is only used to test their statistical quality.
+ */
+template <typename E>
+std::vector<double> rng_unifs_(const uint64& n) {
+    std::vector<uint64> sub_seeds = as<std::vector<uint64>>(Rcpp::runif(8,0,4294967296));
+    E eng = seeded_engine<E>(sub_seeds);
+    std::vector<double> out(n);
+    for (double& x : out) x = runif_01(eng);
+    return out;
+}
+
+//[[Rcpp::export]]
+std::vector<double> rng_unifs(const uint64& n, const std::string& rng) {
+    if (rng == "pcg64") return rng_unifs_<pcg64>(n);
+    if (rng == "pcg64_fast") return rng_unifs_<pcg64_fast>(n);
+    if (rng == "xoshiro256pp") return rng_unifs_<xoshiro256pp>(n);
+    if (rng == "xoshiro256pp_x4") return rng_unifs_<xoshiro256pp_x4>(n);
+    stop("\nUnrecognized RNG engine.");
+    return std::vector<double>(0);
+}
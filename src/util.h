@@ -16,6 +16,7 @@
 #include <RcppArmadillo.h>
 #include <vector>
 #include <string>
+#include <algorithm>  // max
 #include <pcg/pcg_random.hpp> // pcg prng
 #include <progress.hpp>  // for the progress bar
 
@@ -25,6 +26,7 @@
 
 
 #include "jackalope_types.h"  // integer types
+#include "progress_monitor.h"  // ProgressMonitor
 #include "pcg.h"  // runif_* methods
 
 
@@ -77,8 +79,8 @@ void clear_memory(U& x) {
 /*
  Shuffles a vector or deque more quickly than the default std::shuffle
  */
-template <typename T>
-void jlp_shuffle(T& input, pcg64& eng) {
+template <typename T, typename E>
+void jlp_shuffle(T& input, E& eng) {
     for (uint32 i = input.size(); i > 1; i--) {
         uint32 j = runif_01(eng) * i;
         std::swap(input[i-1], input[j]);
@@ -221,7 +223,7 @@ inline void thread_check(uint64& n_threads) {
 
 // For checking for user interrupts every N iterations:
 inline bool interrupt_check(uint32& iters,
-                            Progress& prog_bar,
+                            ProgressMonitor& prog_bar,
                             const uint32& N = 1000) {
     ++iters;
     if (iters > N) {
@@ -238,6 +240,44 @@ inline bool interrupt_check(uint32& iters,
 
 
 
+/*
+ Split chromosomes into consecutive batches of similar total size for parallel loops.
+
+ Loops over chromosomes go over these batches instead of one chromosome at a time,
+ so draft assemblies with many thousands of small contigs don't spend most of their
+ time on per-iteration overhead (scheduling and checking for user interrupts),
+ and threads get similar amounts of sequence rather than similar numbers
+ of chromosomes.
+ The output has the index of the first chromosome in each batch, followed by
+ the number of chromosomes, so batch `i` is from `out[i]` to `out[i+1] - 1`.
+ */
+inline std::vector<uint64> chrom_batches(const std::vector<uint64>& chrom_sizes,
+                                         const uint64& n_threads,
+                                         const uint64& batches_per_thread = 8) {
+
+    uint64 total = 0;
+    for (const uint64& s : chrom_sizes) total += s;
+    uint64 n_batches = std::max(n_threads, static_cast<uint64>(1)) * batches_per_thread;
+    uint64 target = std::max(total / n_batches, static_cast<uint64>(1));
+
+    std::vector<uint64> out;
+    out.reserve(n_batches + 2);
+    uint64 batch_size = target;
+    for (uint64 i = 0; i < chrom_sizes.size(); i++) {
+        if (batch_size >= target) {
+            out.push_back(i);
+            batch_size = 0;
+        }
+        batch_size += chrom_sizes[i];
+    }
+    out.push_back(chrom_sizes.size());
+
+    return out;
+}
+
+
+
+
 //' Split integer `x` into `n` chunks that are as even as possible.
 //'
 //' @noRd